@@ -0,0 +1,134 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_COMMON_ALIGNED_BUFFER_POOL_H
+#define CEPH_COMMON_ALIGNED_BUFFER_POOL_H
+
+#include <stdlib.h>
+
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "include/buffer.h"
+#include "include/intarith.h"
+#include "include/mempool.h"
+#include "common/deleter.h"
+
+namespace ceph {
+
+// A pool of page aligned chunks to read large message payloads into.
+//
+// Large posix_memalign() allocations are mmap()ed, so every 4MB write
+// would otherwise map, fault in, zero and unmap fresh pages.  Buffers
+// handed out by fill() return their chunk to the pool when the last
+// reference goes away, up to max_cached bytes; beyond that chunks are
+// freed.  Buffers may outlive the pool object they came from.
+//
+// Only whole chunks come from the pool; fill() allocates the remainder
+// to size, so a buffer never pins more memory than it holds.  Chunks,
+// cached or in use, are accounted to the given mempool.
+
+class aligned_buffer_pool
+  : public std::enable_shared_from_this<aligned_buffer_pool> {
+  const unsigned chunk_size;
+  const uint64_t max_cached;
+  const int mempool;
+
+  std::mutex lock;
+  std::vector<char*> free_chunks;
+
+  aligned_buffer_pool(unsigned chunk_size, uint64_t max_cached, int mempool)
+    : chunk_size(ROUND_UP_TO(chunk_size, CEPH_PAGE_SIZE)),
+      max_cached(max_cached),
+      mempool(mempool) {}
+
+  void _account_cached(ssize_t items) {
+    mempool::get_pool(mempool::pool_index_t(mempool)).adjust_count(
+      items, items * (ssize_t)chunk_size);
+  }
+
+  char *_get_chunk() {
+    {
+      std::lock_guard<std::mutex> l(lock);
+      if (!free_chunks.empty()) {
+	char *p = free_chunks.back();
+	free_chunks.pop_back();
+	_account_cached(-1);
+	return p;
+      }
+    }
+    void *p = nullptr;
+    if (::posix_memalign(&p, CEPH_PAGE_SIZE, chunk_size) != 0)
+      throw std::bad_alloc();
+    return (char*)p;
+  }
+
+  void _put_chunk(char *p) {
+    {
+      std::lock_guard<std::mutex> l(lock);
+      if ((free_chunks.size() + 1) * chunk_size <= max_cached) {
+	free_chunks.push_back(p);
+	_account_cached(1);
+	return;
+      }
+    }
+    ::free(p);
+  }
+
+public:
+  static std::shared_ptr<aligned_buffer_pool> create(
+    unsigned chunk_size,
+    uint64_t max_cached,
+    int mempool = mempool::mempool_buffer_anon) {
+    return std::shared_ptr<aligned_buffer_pool>(
+      new aligned_buffer_pool(chunk_size, max_cached, mempool));
+  }
+
+  ~aligned_buffer_pool() {
+    _account_cached(-(ssize_t)free_chunks.size());
+    for (auto p : free_chunks)
+      ::free(p);
+  }
+
+  aligned_buffer_pool(const aligned_buffer_pool&) = delete;
+  aligned_buffer_pool& operator=(const aligned_buffer_pool&) = delete;
+
+  unsigned get_chunk_size() const {
+    return chunk_size;
+  }
+
+  /// append len bytes of buffers to data, page aligned relative to off
+  void fill(bufferlist *data, unsigned len, unsigned off) {
+    bufferlist bl;
+    unsigned left = len;
+    if (off & ~CEPH_PAGE_MASK) {
+      // unaligned head
+      unsigned head = MIN(CEPH_PAGE_SIZE - (off & ~CEPH_PAGE_MASK), left);
+      bl.push_back(buffer::create(head));
+      left -= head;
+    }
+    unsigned middle = left & CEPH_PAGE_MASK;
+    left -= middle;
+    auto self = shared_from_this();
+    while (middle >= chunk_size) {
+      char *p = _get_chunk();
+      bl.push_back(buffer::claim_buffer(
+	chunk_size, p, make_deleter([self, p] { self->_put_chunk(p); })));
+      middle -= chunk_size;
+    }
+    if (middle) {
+      bl.push_back(buffer::create_page_aligned(middle));
+    }
+    if (left) {
+      bl.push_back(buffer::create(left));
+    }
+    bl.reassign_to_mempool(mempool);
+    data->claim_append(bl);
+  }
+};
+
+} // namespace ceph
+
+#endif // CEPH_COMMON_ALIGNED_BUFFER_POOL_H
@@ -230,13 +230,43 @@ OPTION(ms_async_set_affinity, OPT_BOOL, true)
 // example: ms_async_affinity_cores = 0,1
 // The number of coreset is expected to equal to ms_async_op_threads, otherwise
 // extra op threads will loop ms_async_affinity_cores again.
-// If ms_async_affinity_cores is empty, all threads will be bind to current running
-// core
+// If ms_async_affinity_cores is empty, workers are not pinned (posix stack)
 OPTION(ms_async_affinity_cores, OPT_STR, "")
+// after handling events, keep polling without sleeping for up to this
+// long (adapted between 1/16 and all of it by how often spinning pays
+// off) before blocking in epoll_wait; 0 disables
+OPTION(ms_async_busy_poll_us, OPT_U32, 0)
+// every interval seconds, move one busy connection off the async worker
+// carrying the most traffic if it exceeds the average by more than the
+// threshold (posix stack only); 0 disables
+OPTION(ms_async_rebalance_interval, OPT_DOUBLE, 0)
+OPTION(ms_async_rebalance_threshold, OPT_DOUBLE, .25)
+// small messages queued behind each other are written with one writev
+// until cork_max_bytes accumulate; with cork_us > 0 a small batch is
+// also held back up to that long waiting for more (adds latency)
+OPTION(ms_async_cork_us, OPT_U32, 0)
+OPTION(ms_async_cork_max_bytes, OPT_U32, 64 << 10)
+OPTION(ms_tcp_busy_poll_us, OPT_U32, 0)  // SO_BUSY_POLL for sockets (linux); 0 disables
+// compress message data segments of at least ms_async_compress_min_size
+// bytes with this compressor plugin (e.g. lz4, zstd) when the peer can
+// decompress them; "none" disables
+OPTION(ms_async_compress_algorithm, OPT_STR, "none")
+OPTION(ms_async_compress_min_size, OPT_U32, 8192)
+OPTION(ms_async_decompress_max_size, OPT_U64, 256<<20)  // refuse compressed data claiming more
+// encrypt message payloads with the cephx session key on connections
+// that have one; peers that cannot decrypt them are refused
+OPTION(ms_async_encrypt, OPT_BOOL, false)
+// send with MSG_ZEROCOPY (linux 4.14+, posix stack only); sends smaller
+// than ms_async_zero_copy_send_min bytes are still copied
+OPTION(ms_async_zero_copy_send, OPT_BOOL, false)
+OPTION(ms_async_zero_copy_send_min, OPT_U32, 64 << 10)
 OPTION(ms_async_rdma_device_name, OPT_STR, "")
 OPTION(ms_async_rdma_enable_hugepage, OPT_BOOL, false)
 OPTION(ms_async_rdma_buffer_size, OPT_INT, 128 << 10)
 OPTION(ms_async_rdma_send_buffers, OPT_U32, 1024)
+// registered send memory may grow on demand, in steps of
+// ms_async_rdma_send_buffers buffers, up to this many bytes
+OPTION(ms_async_rdma_send_buffers_max_bytes, OPT_U64, 512<<20)
 OPTION(ms_async_rdma_receive_buffers, OPT_U32, 1024)
 OPTION(ms_async_rdma_port_num, OPT_U32, 1)
 OPTION(ms_async_rdma_polling_us, OPT_U32, 1000)
@@ -272,6 +302,8 @@ OPTION(mon_osd_cache_size, OPT_INT, 10)  // the size of osdmaps cache, not to re
 
 OPTION(mon_cpu_threads, OPT_INT, 4)
 OPTION(mon_osd_mapping_pgs_per_chunk, OPT_INT, 4096)
+OPTION(mon_osd_mapping_incremental, OPT_BOOL, true) // only remap pgs touched by each osdmap incremental
+OPTION(mon_osd_mapping_incremental_check, OPT_BOOL, false) // compare incremental mappings to a full recompute (slow; for testing)
 OPTION(mon_osd_max_creating_pgs, OPT_INT, 1024)
 OPTION(mon_tick_interval, OPT_INT, 5)
 OPTION(mon_session_timeout, OPT_INT, 300)    // must send keepalive or subscribe
@@ -489,6 +521,7 @@ OPTION(objecter_tick_interval, OPT_DOUBLE, 5.0)
 OPTION(objecter_timeout, OPT_DOUBLE, 10.0)    // before we ask for a map
 OPTION(objecter_inflight_op_bytes, OPT_U64, 1024*1024*100) // max in-flight data (both directions)
 OPTION(objecter_inflight_ops, OPT_U64, 1024)               // max in-flight ios
+OPTION(objecter_pg_mapping_cache_size, OPT_U64, 65536)     // pg mappings to remember between osdmap epochs (0 to disable)
 OPTION(objecter_completion_locks_per_session, OPT_U64, 32) // num of completion locks per each session, for serializing same object responses
 OPTION(objecter_inject_no_watch_ping, OPT_BOOL, false)   // suppress watch pings
 OPTION(objecter_retry_writes_after_first_reply, OPT_BOOL, false)   // ignore the first reply for each write, and resend the osd op instead
@@ -682,6 +715,12 @@ OPTION(osd_os_flags, OPT_U32, 0)
 OPTION(osd_max_write_size, OPT_INT, 90)
 OPTION(osd_max_pgls, OPT_U64, 1024) // max number of pgls entries to return
 OPTION(osd_client_message_size_cap, OPT_U64, 500*1024L*1024L) // client data allowed in-memory (in bytes)
+// read write payloads of at least osd_rx_buffer_pool_min_len bytes into
+// pooled page aligned chunks instead of fresh allocations
+OPTION(osd_rx_buffer_pool, OPT_BOOL, true)
+OPTION(osd_rx_buffer_pool_min_len, OPT_U32, 256<<10)  // no use below one chunk
+OPTION(osd_rx_buffer_pool_chunk_size, OPT_U32, 256<<10)
+OPTION(osd_rx_buffer_pool_max_cached, OPT_U64, 256<<20)  // bytes kept for reuse
 OPTION(osd_client_message_cap, OPT_U64, 100)              // num client messages allowed in-memory
 OPTION(osd_pg_bits, OPT_INT, 6)  // bits per osd
 OPTION(osd_pgp_bits, OPT_INT, 6)  // bits per osd
@@ -756,7 +795,10 @@ OPTION(osd_max_markdown_period , OPT_INT, 600)
 OPTION(osd_max_markdown_count, OPT_INT, 5)
 
 OPTION(osd_peering_wq_threads, OPT_INT, 2)
+OPTION(osd_load_pgs_threads, OPT_INT, 4) // threads reading pg state at startup (<= 1 for serial)
 OPTION(osd_peering_wq_batch_size, OPT_U64, 20)
+OPTION(osd_peering_msg_batch_max_pgs, OPT_U32, 1000) // send batched peering messages once this many pgs are pending (0 = every batch)
+OPTION(osd_peering_msg_batch_max_delay, OPT_DOUBLE, .05) // max seconds to hold batched peering messages
 OPTION(osd_op_pq_max_tokens_per_priority, OPT_U64, 4194304)
 OPTION(osd_op_pq_min_cost, OPT_U64, 65536)
 OPTION(osd_disk_threads, OPT_INT, 1)
@@ -778,6 +820,9 @@ OPTION(osd_ignore_stale_divergent_priors, OPT_BOOL, false) // do not assert on d
 // If set to true even after reading enough shards to
 // decode the object, any error will be reported.
 OPTION(osd_read_ec_check_for_errors, OPT_BOOL, false) // return error if any ec shard has an error
+OPTION(osd_read_ec_hedge, OPT_BOOL, false) // read extra shards when an ec client read is slower than usual
+OPTION(osd_read_ec_hedge_percentile, OPT_DOUBLE, 95) // shard latency percentile after which a read is hedged
+OPTION(osd_read_ec_hedge_min_delay, OPT_DOUBLE, .005) // never hedge an ec read sooner than this (seconds)
 
 // Only use clone_overlap for recovery if there are fewer than
 // osd_recover_clone_overlap_limit entries in the overlap set
@@ -785,12 +830,23 @@ OPTION(osd_recover_clone_overlap_limit, OPT_INT, 10)
 
 OPTION(osd_backfill_scan_min, OPT_INT, 64)
 OPTION(osd_backfill_scan_max, OPT_INT, 512)
+// backfill a stale copy by fetching its block digests and pushing only the
+// blocks that differ.  only used once require_osd_release is luminous.
+OPTION(osd_backfill_delta, OPT_BOOL, false)
+OPTION(osd_backfill_delta_min_size, OPT_U64, 1<<20) // smaller objects are pushed whole
+OPTION(osd_backfill_delta_block_size, OPT_U32, 64<<10)
 OPTION(osd_op_thread_timeout, OPT_INT, 15)
 OPTION(osd_op_thread_suicide_timeout, OPT_INT, 150)
 OPTION(osd_recovery_thread_timeout, OPT_INT, 30)
 OPTION(osd_recovery_thread_suicide_timeout, OPT_INT, 300)
 OPTION(osd_recovery_sleep, OPT_FLOAT, 0.01)         // seconds to sleep between recovery ops
 OPTION(osd_snap_trim_sleep, OPT_DOUBLE, 0)
+// OSD-wide snap trim rate (objects/sec, 0 = unlimited), reduced while
+// client op latency is above osd_snap_trim_client_latency_target
+OPTION(osd_snap_trim_rate_hdd, OPT_U64, 100)
+OPTION(osd_snap_trim_rate_ssd, OPT_U64, 2000)
+OPTION(osd_snap_trim_client_latency_target, OPT_DOUBLE, .05)  // seconds
+OPTION(osd_snap_trim_io_budget_interval, OPT_FLOAT, 1) // seconds between rate adjustments
 OPTION(osd_scrub_invalid_stats, OPT_BOOL, true)
 OPTION(osd_remove_thread_timeout, OPT_INT, 60*60)
 OPTION(osd_remove_thread_suicide_timeout, OPT_INT, 10*60*60)
@@ -836,6 +892,8 @@ OPTION(osd_copyfrom_max_chunk, OPT_U64, 8<<20)   // max size of a COPYFROM chunk
 OPTION(osd_push_per_object_cost, OPT_U64, 1000)  // push cost per object
 OPTION(osd_max_push_cost, OPT_U64, 8<<20)  // max size of push message
 OPTION(osd_max_push_objects, OPT_U64, 10)  // max objects in single push op
+OPTION(osd_recovery_small_object_size, OPT_U64, 64<<10) // objects (without omap) up to this size are recovered in batches; 0 to disable
+OPTION(osd_recovery_small_object_batch, OPT_U64, 32) // small objects that share one recovery op (and push message)
 OPTION(osd_recovery_forget_lost_objects, OPT_BOOL, false)   // off for now
 OPTION(osd_max_scrubs, OPT_INT, 1)
 OPTION(osd_scrub_during_recovery, OPT_BOOL, false) // Allow new scrubs to start while recovery is active on the OSD
@@ -849,6 +907,12 @@ OPTION(osd_scrub_backoff_ratio, OPT_DOUBLE, .66)   // the probability to back of
 OPTION(osd_scrub_chunk_min, OPT_INT, 5)
 OPTION(osd_scrub_chunk_max, OPT_INT, 25)
 OPTION(osd_scrub_sleep, OPT_FLOAT, 0)   // sleep between [deep]scrub ops
+// deep scrub read budget (bytes/sec, shared by all pgs; 0 = unlimited),
+// backed off while client op latency is above the target (0 = don't adapt)
+OPTION(osd_scrub_io_budget_hdd, OPT_U64, 32<<20)
+OPTION(osd_scrub_io_budget_ssd, OPT_U64, 512<<20)
+OPTION(osd_scrub_client_latency_target, OPT_FLOAT, .05)
+OPTION(osd_scrub_io_budget_interval, OPT_FLOAT, 1) // seconds between budget adjustments
 OPTION(osd_scrub_auto_repair, OPT_BOOL, false)   // whether auto-repair inconsistencies upon deep-scrubbing
 OPTION(osd_scrub_auto_repair_num_errors, OPT_U32, 5)   // only auto-repair when number of errors is below this threshold
 OPTION(osd_deep_scrub_interval, OPT_FLOAT, 60*60*24*7) // once a week
@@ -875,6 +939,7 @@ OPTION(osd_min_pg_log_entries, OPT_U32, 3000)  // number of entries to keep in t
 OPTION(osd_max_pg_log_entries, OPT_U32, 10000) // max entries, say when degraded, before we trim
 OPTION(osd_force_recovery_pg_log_entries_factor, OPT_FLOAT, 1.3) // max entries factor before force recovery
 OPTION(osd_pg_log_trim_min, OPT_U32, 100)
+OPTION(osd_pg_log_dups_tracked, OPT_U32, 3000) // how many reqids past the log tail to track for dup detection
 OPTION(osd_op_complaint_time, OPT_FLOAT, 30) // how many seconds old makes an op complaint-worthy
 OPTION(osd_command_max_records, OPT_INT, 256)
 OPTION(osd_max_pg_blocked_by, OPT_U32, 16)    // max peer osds to report that are blocking our progress
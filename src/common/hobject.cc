@@ -101,18 +101,34 @@ string hobject_t::to_str() const
   return out;
 }
 
-void hobject_t::encode(bufferlist& bl) const
+template<typename P>
+void hobject_t::_encode(P& p) const
+{
+  DENC_START(4, 3, p);
+  denc(key, p);
+  denc(oid.name, p);
+  denc(snap, p);
+  denc(hash, p);
+  denc(max, p);
+  denc(nspace, p);
+  denc(pool, p);
+  DENC_FINISH(p);
+}
+
+void hobject_t::bound_encode(size_t& p) const
+{
+  _encode(p);
+}
+
+void hobject_t::encode(bufferlist::contiguous_appender& p) const
 {
-  ENCODE_START(4, 3, bl);
-  ::encode(key, bl);
-  ::encode(oid, bl);
-  ::encode(snap, bl);
-  ::encode(hash, bl);
-  ::encode(max, bl);
-  ::encode(nspace, bl);
-  ::encode(pool, bl);
   assert(!max || (*this == hobject_t(hobject_t::get_max())));
-  ENCODE_FINISH(bl);
+  _encode(p);
+}
+
+void hobject_t::encode(bufferlist& bl) const
+{
+  denc_encode(*this, bl);
 }
 
 void hobject_t::decode(bufferlist::iterator& bl)
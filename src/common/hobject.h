@@ -274,6 +274,9 @@ public:
   bool parse(const string& s);
 
   void encode(bufferlist& bl) const;
+  // same encoding, for callers building a contiguous (denc) encoding
+  void bound_encode(size_t& p) const;
+  void encode(bufferlist::contiguous_appender& p) const;
   void decode(bufferlist::iterator& bl);
   void decode(json_spirit::Value& v);
   void dump(Formatter *f) const;
@@ -294,6 +297,11 @@ public:
   friend bool operator==(const hobject_t&, const hobject_t&);
   friend bool operator!=(const hobject_t&, const hobject_t&);
   friend struct ghobject_t;
+
+private:
+  DENC_HELPERS
+  template<typename P>
+  void _encode(P& p) const;
 };
 WRITE_CLASS_ENCODER(hobject_t)
 
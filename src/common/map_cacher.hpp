@@ -59,6 +59,26 @@ public:
     pair<K, V> *next    ///< [out] first key after key
     ) = 0; ///< @return 0 on success, -ENOENT if there is no next
 
+  /// Returns up to max keys after key, in order
+  virtual int get_next_batch(
+    const K &key,                  ///< [in] key after which to start
+    unsigned max,                  ///< [in] max keys to return
+    std::vector<pair<K, V> > *out  ///< [out] keys following key
+    ) {
+    K pos = key;
+    while (out->size() < max) {
+      pair<K, V> next;
+      int r = get_next(pos, &next);
+      if (r == -ENOENT)
+	break;
+      if (r < 0)
+	return r;
+      pos = next.first;
+      out->push_back(next);
+    }
+    return 0;
+  } ///< @return error value, 0 on success (fewer than max means no more)
+
   virtual ~StoreDriver() {}
 };
 
@@ -120,6 +140,49 @@ public:
     return -EINVAL;
   } ///< @return error value, 0 on success, -ENOENT if no more entries
 
+  /// Fetch up to max key/value pairs after specified key
+  int get_next_batch(
+    K key,                         ///< [in] key after which to start
+    unsigned max,                  ///< [in] max keys to return
+    std::vector<pair<K, V> > *out  ///< [out] keys following key
+    ) {
+    std::vector<pair<K, V> > store;
+    size_t pos = 0;
+    bool store_done = false;
+    while (out->size() < max) {
+      if (pos == store.size() && !store_done) {
+	store.clear();
+	pos = 0;
+	unsigned want = max - out->size();
+	int r = driver->get_next_batch(key, want, &store);
+	if (r < 0)
+	  return r;
+	store_done = store.size() < want;
+      }
+
+      pair<K, boost::optional<V> > cached;
+      bool got_cached = in_progress.get_next(key, &cached);
+      bool got_store = pos < store.size();
+
+      if (!got_cached && !got_store) {
+	break;
+      } else if (
+	got_cached &&
+	(!got_store || store[pos].first >= cached.first)) {
+	// cached value shadows the store, and may mark the key removed
+	if (got_store && store[pos].first == cached.first)
+	  ++pos;
+	key = cached.first;
+	if (cached.second)
+	  out->push_back(make_pair(cached.first, cached.second.get()));
+      } else {
+	key = store[pos].first;
+	out->push_back(store[pos++]);
+      }
+    }
+    return out->empty() ? -ENOENT : 0;
+  } ///< @return error value, 0 on success, -ENOENT if no more entries
+
   /// Adds operation setting keys to Transaction
   void set_keys(
     const map<K, V> &keys,  ///< [in] keys/values to set
@@ -0,0 +1,139 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_COMMON_SHARDED_SHARED_MUTEX_H
+#define CEPH_COMMON_SHARDED_SHARED_MUTEX_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+namespace ceph {
+
+// A shared mutex for data that is read on every operation and
+// written rarely (e.g., the Objecter's OSDMap).
+//
+// boost::shared_mutex (and std::shared_mutex) keep their reader count
+// in a single word protected by an internal mutex, so every
+// lock_shared() from every thread bounces the same cache line, and
+// with enough submitting threads that line is the bottleneck even
+// though nobody ever takes the lock exclusively.  Here each reader
+// only touches the counter for its own slot; a writer raises a flag
+// and waits for every slot to drain.
+//
+// Writers are expected to be rare and are correspondingly slow.
+// Like boost::shared_mutex, a pending writer blocks new readers, so
+// a thread must not take a shared lock it already holds.  A shared
+// lock must be released by the thread that acquired it.
+//
+// Meets the Lockable and SharedLockable requirements, so it can be
+// used with std::unique_lock, boost::shared_lock and
+// ceph::shunique_lock.
+
+class sharded_shared_mutex {
+  static constexpr unsigned num_slots = 32;
+
+  struct alignas(64) slot_t {
+    std::atomic<unsigned> readers = {0};
+  };
+  slot_t slots[num_slots];
+
+  std::atomic<bool> writer = {false};
+  std::mutex writer_lock;   ///< serializes writers
+  std::mutex wait_lock;     ///< protects sleeping on cond
+  std::condition_variable cond;
+
+  static slot_t& _my_slot(slot_t *slots) {
+    static std::atomic<unsigned> next = {0};
+    static thread_local unsigned slot = next++ % num_slots;
+    return slots[slot];
+  }
+
+  bool _drained() const {
+    for (auto& s : slots) {
+      if (s.readers.load()) {
+	return false;
+      }
+    }
+    return true;
+  }
+
+  void _wake() {
+    std::lock_guard<std::mutex> l(wait_lock);
+    cond.notify_all();
+  }
+
+public:
+  sharded_shared_mutex() = default;
+  sharded_shared_mutex(const sharded_shared_mutex&) = delete;
+  sharded_shared_mutex& operator=(const sharded_shared_mutex&) = delete;
+
+  void lock_shared() {
+    slot_t& s = _my_slot(slots);
+    while (true) {
+      s.readers.fetch_add(1);
+      if (!writer.load()) {
+	return;
+      }
+      // back off and let the writer in
+      s.readers.fetch_sub(1);
+      std::unique_lock<std::mutex> l(wait_lock);
+      cond.notify_all();
+      while (writer.load()) {
+	cond.wait(l);
+      }
+    }
+  }
+
+  bool try_lock_shared() {
+    slot_t& s = _my_slot(slots);
+    s.readers.fetch_add(1);
+    if (!writer.load()) {
+      return true;
+    }
+    s.readers.fetch_sub(1);
+    _wake();
+    return false;
+  }
+
+  void unlock_shared() {
+    _my_slot(slots).readers.fetch_sub(1);
+    if (writer.load()) {
+      _wake();
+    }
+  }
+
+  void lock() {
+    writer_lock.lock();
+    writer.store(true);
+    std::unique_lock<std::mutex> l(wait_lock);
+    while (!_drained()) {
+      cond.wait(l);
+    }
+  }
+
+  bool try_lock() {
+    if (!writer_lock.try_lock()) {
+      return false;
+    }
+    writer.store(true);
+    if (_drained()) {
+      return true;
+    }
+    unlock();
+    return false;
+  }
+
+  void unlock() {
+    {
+      std::lock_guard<std::mutex> l(wait_lock);
+      writer.store(false);
+      cond.notify_all();
+    }
+    writer_lock.unlock();
+  }
+};
+
+} // namespace ceph
+
+#endif // CEPH_COMMON_SHARDED_SHARED_MUTEX_H
@@ -65,6 +65,10 @@ public:
   // this is a bit weird but we need non-const iterator to be in
   // alignment with decode methods
   virtual int decompress(ceph::bufferlist::iterator &p, size_t compressed_len, ceph::bufferlist &out) = 0;
+  // as above, but fail with -EMSGSIZE instead of producing more than
+  // max_len bytes; for input that comes from an untrusted peer
+  virtual int decompress(ceph::bufferlist::iterator &p, size_t compressed_len, ceph::bufferlist &out,
+			 size_t max_len) = 0;
 
   static CompressorRef create(CephContext *cct, const std::string &type);
   static CompressorRef create(CephContext *cct, int alg);
@@ -67,16 +67,25 @@ class LZ4Compressor : public Compressor {
   int decompress(bufferlist::iterator &p,
 		 size_t compressed_len,
 		 bufferlist &dst) override {
+    return decompress(p, compressed_len, dst, SIZE_MAX);
+  }
+
+  int decompress(bufferlist::iterator &p,
+		 size_t compressed_len,
+		 bufferlist &dst,
+		 size_t max_len) override {
     uint32_t count;
     std::vector<std::pair<uint32_t, uint32_t> > compressed_pairs;
     ::decode(count, p);
     compressed_pairs.resize(count);
-    uint32_t total_origin = 0;
+    uint64_t total_origin = 0;
     for (unsigned i = 0; i < count; ++i) {
       ::decode(compressed_pairs[i].first, p);
       ::decode(compressed_pairs[i].second, p);
       total_origin += compressed_pairs[i].first;
     }
+    if (total_origin > max_len)
+      return -EMSGSIZE;
     compressed_len -= (sizeof(uint32_t) + sizeof(uint32_t) * count * 2);
 
     bufferptr dstptr(total_origin);
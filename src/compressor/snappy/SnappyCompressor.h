@@ -76,11 +76,21 @@ class SnappyCompressor : public Compressor {
   int decompress(bufferlist::iterator &p,
 		 size_t compressed_len,
 		 bufferlist &dst) override {
+    return decompress(p, compressed_len, dst, SIZE_MAX);
+  }
+
+  int decompress(bufferlist::iterator &p,
+		 size_t compressed_len,
+		 bufferlist &dst,
+		 size_t max_len) override {
     snappy::uint32 res_len = 0;
     BufferlistSource source_1(p, compressed_len);
     if (!snappy::GetUncompressedLength(&source_1, &res_len)) {
       return -1;
     }
+    if (res_len > max_len) {
+      return -EMSGSIZE;
+    }
     BufferlistSource source_2(p, compressed_len);
     bufferptr ptr(res_len);
     if (snappy::RawUncompress(&source_2, ptr.c_str())) {
@@ -174,8 +174,15 @@ int ZlibCompressor::compress(const bufferlist &in, bufferlist &out)
 }
 
 int ZlibCompressor::decompress(bufferlist::iterator &p, size_t compressed_size, bufferlist &out)
+{
+  return decompress(p, compressed_size, out, SIZE_MAX);
+}
+
+int ZlibCompressor::decompress(bufferlist::iterator &p, size_t compressed_size, bufferlist &out,
+			       size_t max_len)
 {
   int ret;
+  size_t total = 0;
   unsigned have;
   z_stream strm;
   const char* c_in;
@@ -217,6 +224,13 @@ int ZlibCompressor::decompress(bufferlist::iterator &p, size_t compressed_size,
        return -1;
       }
       have = MAX_LEN - strm.avail_out;
+      total += have;
+      if (total > max_len) {
+       dout(1) << "Decompression error: output exceeds " << max_len
+            << " bytes" << dendl;
+       inflateEnd(&strm);
+       return -EMSGSIZE;
+      }
       out.append(ptr, 0, have);
     } while (strm.avail_out == 0);
   }
@@ -27,6 +27,8 @@ public:
   int compress(const bufferlist &in, bufferlist &out) override;
   int decompress(const bufferlist &in, bufferlist &out) override;
   int decompress(bufferlist::iterator &p, size_t compressed_len, bufferlist &out) override;
+  int decompress(bufferlist::iterator &p, size_t compressed_len, bufferlist &out,
+		 size_t max_len) override;
 private:
   int zlib_compress(const bufferlist &in, bufferlist &out);
   int isal_compress(const bufferlist &in, bufferlist &out);
@@ -65,12 +65,22 @@ class ZstdCompressor : public Compressor {
   int decompress(bufferlist::iterator &p,
 		 size_t compressed_len,
 		 bufferlist &dst) override {
+    return decompress(p, compressed_len, dst, SIZE_MAX);
+  }
+
+  int decompress(bufferlist::iterator &p,
+		 size_t compressed_len,
+		 bufferlist &dst,
+		 size_t max_len) override {
     if (compressed_len < 4) {
       return -1;
     }
     compressed_len -= 4;
     uint32_t dst_len;
     ::decode(dst_len, p);
+    if (dst_len > max_len) {
+      return -EMSGSIZE;
+    }
 
     bufferptr dstptr(dst_len);
     ZSTD_outBuffer_s outbuf;
@@ -634,6 +634,20 @@ int CrushTester::test()
         // create a vector to hold placement results temporarily 
         vector<int> temporary_per ( per.size() );
 
+        // map the whole batch at once
+        vector<vector<int> > crush_out;
+        if (use_crush) {
+          vector<int> real_x;
+          real_x.reserve(batch_max - batch_min + 1);
+          for (int x = batch_min; x <= batch_max; x++) {
+            if (pool_id != -1)
+              real_x.push_back(crush_hash32_2(CRUSH_HASH_RJENKINS1, x, (uint32_t)pool_id));
+            else
+              real_x.push_back(x);
+          }
+          crush.do_rule_batch(r, real_x, &crush_out, nr, weight, 0);
+        }
+
         for (int x = batch_min; x <= batch_max; x++) {
           // create a vector to hold the results of a CRUSH placement or RNG simulation
           vector<int> out;
@@ -641,11 +655,7 @@ int CrushTester::test()
           if (use_crush) {
             if (output_mappings)
 	      err << "CRUSH"; // prepend CRUSH to placement output
-            uint32_t real_x = x;
-            if (pool_id != -1) {
-              real_x = crush_hash32_2(CRUSH_HASH_RJENKINS1, x, (uint32_t)pool_id);
-            }
-            crush.do_rule(r, real_x, out, nr, weight, 0);
+            out.swap(crush_out[x - batch_min]);
           } else {
             if (output_mappings)
 	      err << "RNG"; // prepend RNG to placement output to denote simulation
@@ -1280,6 +1280,33 @@ public:
       out[i] = rawout[i];
   }
 
+  /**
+   * map each of the x values as do_rule does, sharing the crush
+   * workspace between them
+   */
+  template<typename WeightVector>
+  void do_rule_batch(int rule, const vector<int>& x,
+		     vector<vector<int>> *out, int maxout,
+		     const WeightVector& weight,
+		     uint64_t choose_args_index) const {
+    out->resize(x.size());
+    if (x.empty())
+      return;
+    vector<int> rawout(x.size() * maxout);
+    vector<int> rawlen(x.size());
+    char work[crush_work_size(crush, maxout)];
+    crush_init_workspace(crush, work);
+    crush_choose_arg_map arg_map = choose_args_get(choose_args_index);
+    crush_do_rule_batch(crush, rule, &x[0], x.size(), &rawout[0], maxout,
+			&rawlen[0], &weight[0], weight.size(), work,
+			arg_map.args);
+    for (unsigned i = 0; i < x.size(); i++) {
+      int numrep = rawlen[i] < 0 ? 0 : rawlen[i];
+      (*out)[i].assign(rawout.begin() + i * maxout,
+		       rawout.begin() + i * maxout + numrep);
+    }
+  }
+
   int _choose_type_stack(
     CephContext *cct,
     const vector<pair<int,int>>& stack,
@@ -320,47 +320,62 @@ static inline int *get_choose_arg_ids(const struct crush_bucket_straw2 *bucket,
   return arg->ids;
 }
 
+/* number of items hashed at once by bucket_straw2_choose */
+#define CRUSH_STRAW2_CHUNK 32
+
 static int bucket_straw2_choose(const struct crush_bucket_straw2 *bucket,
 				int x, int r, const struct crush_choose_arg *arg,
                                 int position)
 {
-	unsigned int i, high = 0;
-	unsigned int u;
+	unsigned int i, j, n, high = 0;
+	__u32 u[CRUSH_STRAW2_CHUNK];
 	__s64 ln, draw, high_draw = 0;
         __u32 *weights = get_choose_arg_weights(bucket, arg, position);
         int *ids = get_choose_arg_ids(bucket, arg);
-	for (i = 0; i < bucket->h.size; i++) {
-                dprintk("weight 0x%x item %d\n", weights[i], ids[i]);
-		if (weights[i]) {
-			u = crush_hash32_3(bucket->h.hash, x, ids[i], r);
-			u &= 0xffff;
-
-			/*
-			 * for some reason slightly less than 0x10000 produces
-			 * a slightly more accurate distribution... probably a
-			 * rounding effect.
-			 *
-			 * the natural log lookup table maps [0,0xffff]
-			 * (corresponding to real numbers [1/0x10000, 1] to
-			 * [0, 0xffffffffffff] (corresponding to real numbers
-			 * [-11.090355,0]).
-			 */
-			ln = crush_ln(u) - 0x1000000000000ll;
-
-			/*
-			 * divide by 16.16 fixed-point weight.  note
-			 * that the ln value is negative, so a larger
-			 * weight means a larger (less negative) value
-			 * for draw.
-			 */
-			draw = div64_s64(ln, weights[i]);
-		} else {
-			draw = S64_MIN;
-		}
+	for (i = 0; i < bucket->h.size; i += n) {
+		n = bucket->h.size - i;
+		if (n > CRUSH_STRAW2_CHUNK)
+			n = CRUSH_STRAW2_CHUNK;
+		/*
+		 * hash the whole chunk first so that the hashes can be
+		 * computed several at a time; items with a zero weight
+		 * are hashed too but their hash is not used.
+		 */
+		crush_hash32_3_vec(bucket->h.hash, x, ids + i, r, u, n);
+		for (j = 0; j < n; j++) {
+			dprintk("weight 0x%x item %d\n", weights[i + j],
+				ids[i + j]);
+			if (weights[i + j]) {
+				/*
+				 * for some reason slightly less than
+				 * 0x10000 produces a slightly more
+				 * accurate distribution... probably a
+				 * rounding effect.
+				 *
+				 * the natural log lookup table maps
+				 * [0,0xffff] (corresponding to real
+				 * numbers [1/0x10000, 1] to [0,
+				 * 0xffffffffffff] (corresponding to real
+				 * numbers [-11.090355,0]).
+				 */
+				ln = crush_ln(u[j] & 0xffff) -
+					0x1000000000000ll;
+
+				/*
+				 * divide by 16.16 fixed-point weight.
+				 * note that the ln value is negative, so
+				 * a larger weight means a larger (less
+				 * negative) value for draw.
+				 */
+				draw = div64_s64(ln, weights[i + j]);
+			} else {
+				draw = S64_MIN;
+			}
 
-		if (i == 0 || draw > high_draw) {
-			high = i;
-			high_draw = draw;
+			if (i + j == 0 || draw > high_draw) {
+				high = i + j;
+				high_draw = draw;
+			}
 		}
 	}
 
@@ -1087,3 +1102,36 @@ int crush_do_rule(const struct crush_map *map,
 
 	return result_len;
 }
+
+/**
+ * crush_do_rule_batch - calculate the mappings of several inputs
+ * @map: the crush_map
+ * @ruleno: the rule id
+ * @x: hash inputs
+ * @count: number of hash inputs
+ * @result: pointer to @count result vectors of @result_max items
+ * @result_max: maximum result size
+ * @result_len: pointer to @count result sizes
+ * @weight: weight vector (for map leaves)
+ * @weight_max: size of weight vector
+ * @cwin: Pointer to at least crush_work_size() bytes of memory
+ */
+void crush_do_rule_batch(const struct crush_map *map,
+			 int ruleno, const int *x, int count,
+			 int *result, int result_max, int *result_len,
+			 const __u32 *weight, int weight_max,
+			 void *cwin, const struct crush_choose_arg *choose_args)
+{
+	int i;
+
+	/*
+	 * the workspace only caches state that depends on x and is
+	 * reset when x changes: it is initialized once by the caller
+	 * and reused for every input.
+	 */
+	for (i = 0; i < count; i++)
+		result_len[i] = crush_do_rule(map, ruleno, x[i],
+					      result + i * result_max,
+					      result_max, weight, weight_max,
+					      cwin, choose_args);
+}
@@ -78,6 +78,36 @@ extern int crush_do_rule(const struct crush_map *map,
 			 const __u32 *weights, int weight_max,
 			 void *cwin, const struct crush_choose_arg *choose_args);
 
+/** @ingroup API
+ *
+ * Map each of the __count__ values of the __x__ array as
+ * crush_do_rule() would and store the items of the i-th mapping in
+ * __result[i * result_max, (i + 1) * result_max[__ and their number
+ * in __result_len[i]__.
+ *
+ * Mapping many values in one call is cheaper than calling
+ * crush_do_rule() for each of them because the __cwin__ workspace
+ * only has to be initialized once.
+ *
+ * @param map the crush_map
+ * @param ruleno a positive integer < __CRUSH_MAX_RULES__
+ * @param x the values to map
+ * @param count the size of the __x__ and __result_len__ arrays
+ * @param result an array of items of size __count__ * __result_max__
+ * @param result_max the maximum number of items of a mapping
+ * @param result_len an array of size __count__
+ * @param weights an array of weights of size __weight_max__
+ * @param weight_max the size of the __weights__ array
+ * @param cwin must be an char array initialized by crush_init_workspace
+ * @param choose_args weights and ids for each known bucket
+ */
+extern void crush_do_rule_batch(const struct crush_map *map,
+				int ruleno, const int *x, int count,
+				int *result, int result_max, int *result_len,
+				const __u32 *weights, int weight_max,
+				void *cwin,
+				const struct crush_choose_arg *choose_args);
+
 /* Returns the exact amount of workspace that will need to be used
    for a given combination of crush_map and result_max. The caller can
    then allocate this much on its own, either on the stack, in a
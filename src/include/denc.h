@@ -1674,6 +1674,42 @@ inline typename std::enable_if<traits::supported &&
 }
 
 
+// ----------------------------------------------------------------------
+// encode-only types
+
+// Some types cannot decode with denc because they still have to
+// understand encodings that predate DENC_START (see
+// DECODE_START_LEGACY_COMPAT_LEN), but they can implement the encode
+// half,
+//
+//   void bound_encode(size_t& p) const;
+//   void encode(bufferlist::contiguous_appender& p) const;
+//
+// typically with DENC_START/DENC_FINISH.  denc_encode() embeds such a
+// type in another contiguous encoding, or encodes it into a bufferlist
+// with a single reservation.
+
+template<typename T>
+inline void denc_encode(const T& o, size_t& p)
+{
+  o.bound_encode(p);
+}
+
+template<typename T>
+inline void denc_encode(const T& o, buffer::list::contiguous_appender& p)
+{
+  o.encode(p);
+}
+
+template<typename T>
+inline void denc_encode(const T& o, bufferlist& bl)
+{
+  size_t len = 0;
+  o.bound_encode(len);
+  auto a = bl.get_contiguous_appender(len);
+  o.encode(a);
+}
+
 
 // ----------------------------------------------------------------
 // DENC
@@ -15,6 +15,7 @@
 #ifndef _CEPH_INCLUDE_MEMPOOL_H
 #define _CEPH_INCLUDE_MEMPOOL_H
 
+#include <algorithm>
 #include <cstddef>
 #include <map>
 #include <unordered_map>
@@ -100,6 +101,14 @@ BlueStore::Onode, we need to do
 (This is just because we need to name some static variables and we
 can't use :: in a variable name.)
 
+Types that are created and destroyed at a high rate (e.g., the hot
+OSD messages) can use
+
+  MEMPOOL_DEFINE_CACHED_OBJECT_FACTORY(Foo, foo, osd);
+
+instead, which recycles freed objects through per-thread caches (see
+cached_allocator below).  Cached objects still count toward the pool.
+
 In order to use the STL containers, simply use the namespaced variant
 of the container type.  For example,
 
@@ -149,6 +158,7 @@ namespace mempool {
   f(buffer_anon)		      \
   f(buffer_meta)		      \
   f(osd)			      \
+  f(osd_msg)			      \
   f(osd_mapbl)			      \
   f(osd_pglog)			      \
   f(osdmap)			      \
@@ -375,6 +385,101 @@ public:
 };
 
 
+// A front end to pool_allocator for a single object type that keeps
+// freed objects for reuse instead of handing them back to the heap.
+//
+// Each thread caches up to 2 * batch objects.  Beyond that it hands a
+// batch to a shared depot, from which a thread whose cache has run dry
+// takes a whole batch at a time.  That way objects allocated on one
+// thread and freed on another (a message decoded by a messenger worker
+// and released by an OSD shard thread) still get recycled, and the
+// shared lock is only taken once per batch.  The depot keeps at most
+// max_batches; anything beyond that is freed.
+//
+// Meant to be a singleton per type, see
+// MEMPOOL_DEFINE_CACHED_OBJECT_FACTORY.
+template<pool_index_t pool_ix, typename T>
+class cached_allocator {
+  static constexpr size_t batch = 32;
+  static constexpr size_t max_batches = 64;
+
+  pool_allocator<pool_ix,T> alloc;
+  std::mutex lock;
+  std::vector<std::vector<T*>> depot;
+
+  struct thread_cache_t {
+    cached_allocator *owner;
+    std::vector<T*> objs;
+    explicit thread_cache_t(cached_allocator *o) : owner(o) {}
+    ~thread_cache_t() {
+      while (!objs.empty()) {
+	owner->_put_batch(objs);
+      }
+    }
+  };
+
+  thread_cache_t& _get_thread_cache() {
+    static thread_local thread_cache_t c(this);
+    return c;
+  }
+
+  // move (up to) the last batch objects of objs to the depot
+  void _put_batch(std::vector<T*>& objs) {
+    size_t n = std::min(batch, objs.size());
+    std::vector<T*> v(objs.end() - n, objs.end());
+    objs.resize(objs.size() - n);
+    {
+      std::lock_guard<std::mutex> l(lock);
+      if (depot.size() < max_batches) {
+	depot.push_back(std::move(v));
+	return;
+      }
+    }
+    for (auto p : v) {
+      alloc.deallocate(p, 1);
+    }
+  }
+
+public:
+  cached_allocator() : alloc(true) {}
+  cached_allocator(const cached_allocator&) = delete;
+  cached_allocator& operator=(const cached_allocator&) = delete;
+
+  ~cached_allocator() {
+    for (auto& v : depot) {
+      for (auto p : v) {
+	alloc.deallocate(p, 1);
+      }
+    }
+  }
+
+  T* allocate() {
+    thread_cache_t& c = _get_thread_cache();
+    if (c.objs.empty()) {
+      std::lock_guard<std::mutex> l(lock);
+      if (!depot.empty()) {
+	c.objs.swap(depot.back());
+	depot.pop_back();
+      }
+    }
+    if (c.objs.empty()) {
+      return alloc.allocate(1);
+    }
+    T *p = c.objs.back();
+    c.objs.pop_back();
+    return p;
+  }
+
+  void deallocate(T *p) {
+    thread_cache_t& c = _get_thread_cache();
+    c.objs.push_back(p);
+    if (c.objs.size() >= 2 * batch) {
+      _put_batch(c.objs);
+    }
+  }
+};
+
+
 // Namespace mempool
 
 #define P(x)								\
@@ -382,6 +487,8 @@ public:
     static const mempool::pool_index_t id = mempool::mempool_##x;	\
     template<typename v>						\
     using pool_allocator = mempool::pool_allocator<id,v>;		\
+    template<typename v>						\
+    using cached_allocator = mempool::cached_allocator<id,v>;		\
                                                                         \
     using string = std::basic_string<char,std::char_traits<char>,       \
                                      pool_allocator<char>>;             \
@@ -469,4 +576,21 @@ DEFINE_MEMORY_POOLS_HELPER(P)
     return mempool::pool::alloc_##factoryname.deallocate((obj*)p, 1);	\
   }
 
+// Like MEMPOOL_DEFINE_OBJECT_FACTORY, but recycles objects through a
+// cached_allocator.  Classes derived from obj must bring their own
+// helpers.
+#define MEMPOOL_DEFINE_CACHED_OBJECT_FACTORY(obj,factoryname,pool)	\
+  namespace mempool {							\
+    namespace pool {							\
+      cached_allocator<obj> cache_##factoryname;			\
+    }									\
+  }									\
+  void *obj::operator new(size_t size) {				\
+    assert(size == sizeof(obj));					\
+    return mempool::pool::cache_##factoryname.allocate();		\
+  }									\
+  void obj::operator delete(void *p)  {					\
+    mempool::pool::cache_##factoryname.deallocate((obj*)p);		\
+  }
+
 #endif
@@ -120,6 +120,9 @@ struct ceph_msg_connect_reply {
 } __attribute__ ((packed));
 
 #define CEPH_MSG_CONNECT_LOSSY  1  /* messages i send may be safely dropped */
+#define CEPH_MSG_CONNECT_ENCODE  2  /* i can decode compressed payloads */
+#define CEPH_MSG_CONNECT_SECURE  4  /* encrypt payloads in both directions */
+#define CEPH_MSG_CONNECT_DECRYPT 8  /* i hold a session key and can decrypt payloads */
 
 
 /*
@@ -164,6 +167,10 @@ struct ceph_msg_header {
 	__le32 crc;       /* header crc32c */
 } __attribute__ ((packed));
 
+/* ceph_msg_header.reserved; only sent to peers with CEPH_MSG_CONNECT_ENCODE */
+#define CEPH_MSG_HEADER_COMPRESSED (1<<0)  /* data segment is compressed */
+#define CEPH_MSG_HEADER_ENCRYPTED  (1<<1)  /* whole payload sealed in data */
+
 #define CEPH_MSG_PRIO_LOW     64
 #define CEPH_MSG_PRIO_DEFAULT 127
 #define CEPH_MSG_PRIO_HIGH    196
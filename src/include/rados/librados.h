@@ -3038,6 +3038,28 @@ CEPH_RADOS_API int rados_aio_write_op_operate(rados_write_op_t write_op,
                                               time_t *mtime,
 			                      int flags);
 
+/**
+ * Perform several independent write operations asynchronously
+ *
+ * Equivalent to calling rados_aio_write_op_operate() for each
+ * operation, but cheaper when writing many small objects.  Each
+ * completion is triggered (and must be released) independently.
+ *
+ * @param num_ops number of entries in write_ops, completions and oids
+ * @param write_ops operations to perform
+ * @param io the ioctx that the objects are in
+ * @param completions what to do when each operation has been attempted
+ * @param oids the object ids
+ * @param flags flags to apply to every operation (LIBRADOS_OPERATION_*)
+ * @returns 0 on success, negative error code if nothing was submitted
+ */
+CEPH_RADOS_API int rados_aio_write_op_operate_batch(size_t num_ops,
+                                                    rados_write_op_t *write_ops,
+                                                    rados_ioctx_t io,
+                                                    rados_completion_t *completions,
+                                                    const char **oids,
+                                                    int flags);
+
 /**
  * Create a new rados_read_op_t write operation. This will store all
  * actions to be performed atomically. You must call
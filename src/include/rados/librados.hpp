@@ -1109,6 +1109,26 @@ namespace librados
     int aio_operate(const std::string& oid, AioCompletion *c,
 		    ObjectReadOperation *op, bufferlist *pbl);
 
+    /**
+     * Schedule several independent async write operations
+     *
+     * This is equivalent to calling aio_operate() for each
+     * (oid, completion, op) triple, but submits them together, which
+     * is much cheaper when writing many small objects.  Each op
+     * completes, and must be waited for and released, on its own.
+     *
+     * @param oids the objects to operate on
+     * @param cs one completion per object
+     * @param ops one operation per object
+     * @param flags flags applied to every op (OPERATION_*)
+     * @returns 0 on success, -EINVAL if the vectors differ in length,
+     * other negative error code if nothing was submitted
+     */
+    int aio_operate_batch(const std::vector<std::string>& oids,
+			  const std::vector<AioCompletion*>& cs,
+			  const std::vector<ObjectWriteOperation*>& ops,
+			  int flags);
+
     int aio_operate(const std::string& oid, AioCompletion *c,
 		    ObjectReadOperation *op, snap_t snapid, int flags,
 		    bufferlist *pbl)
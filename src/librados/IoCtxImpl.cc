@@ -833,6 +833,53 @@ int librados::IoCtxImpl::aio_operate(const object_t& oid,
   return 0;
 }
 
+int librados::IoCtxImpl::aio_operate_batch(
+  const std::vector<object_t>& oids,
+  const std::vector<::ObjectOperation*>& ops,
+  const std::vector<AioCompletionImpl*>& cs,
+  const SnapContext& snap_context, int flags,
+  const blkin_trace_info *trace_info)
+{
+  FUNCTRACE();
+  if (oids.size() != ops.size() || oids.size() != cs.size())
+    return -EINVAL;
+  /* can't write to a snapshot */
+  if (snap_seq != CEPH_NOSNAP)
+    return -EROFS;
+
+  auto ut = ceph::real_clock::now();
+  vector<pair<Objecter::Op*,ceph_tid_t*>> batch;
+  vector<ZTracer::Trace> traces(ops.size());
+  batch.reserve(ops.size());
+  for (size_t i = 0; i < ops.size(); ++i) {
+    OID_EVENT_TRACE(oids[i].name.c_str(), "RADOS_WRITE_OP_BEGIN");
+    AioCompletionImpl *c = cs[i];
+    Context *oncomplete = new C_aio_Complete(c);
+#if defined(WITH_LTTNG) && defined(WITH_EVENTTRACE)
+    ((C_aio_Complete *) oncomplete)->oid = oids[i];
+#endif
+    c->io = this;
+    queue_aio_write(c);
+
+    ZTracer::Trace& trace = traces[i];
+    if (trace_info) {
+      ZTracer::Trace parent_trace("", nullptr, trace_info);
+      trace.init("rados operate", &objecter->trace_endpoint, &parent_trace);
+    }
+
+    trace.event("init root span");
+    Objecter::Op *op = objecter->prepare_mutate_op(
+      oids[i], oloc, *ops[i], snap_context, ut, flags,
+      oncomplete, &c->objver, osd_reqid_t(), &trace);
+    batch.push_back(make_pair(op, &c->tid));
+  }
+  objecter->op_submit_batch(batch);
+  for (auto& trace : traces) {
+    trace.event("rados operate op submitted");
+  }
+  return 0;
+}
+
 int librados::IoCtxImpl::aio_read(const object_t oid, AioCompletionImpl *c,
 				  bufferlist *pbl, size_t len, uint64_t off,
 				  uint64_t snapid, const blkin_trace_info *info)
@@ -161,6 +161,11 @@ struct librados::IoCtxImpl {
 		  int flags, const blkin_trace_info *trace_info = nullptr);
   int aio_operate_read(const object_t& oid, ::ObjectOperation *o,
 		       AioCompletionImpl *c, int flags, bufferlist *pbl, const blkin_trace_info *trace_info = nullptr);
+  int aio_operate_batch(const std::vector<object_t>& oids,
+			const std::vector<::ObjectOperation*>& ops,
+			const std::vector<AioCompletionImpl*>& cs,
+			const SnapContext& snap_context, int flags,
+			const blkin_trace_info *trace_info = nullptr);
 
   struct C_aio_stat_Ack : public Context {
     librados::AioCompletionImpl *c;
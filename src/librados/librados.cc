@@ -1515,6 +1515,29 @@ int librados::IoCtx::aio_operate(const std::string& oid, AioCompletion *c,
 				  translate_flags(flags));
 }
 
+int librados::IoCtx::aio_operate_batch(
+  const std::vector<std::string>& oids,
+  const std::vector<AioCompletion*>& cs,
+  const std::vector<ObjectWriteOperation*>& ops,
+  int flags)
+{
+  if (oids.size() != cs.size() || oids.size() != ops.size())
+    return -EINVAL;
+  std::vector<object_t> objs(oids.begin(), oids.end());
+  std::vector<::ObjectOperation*> oos;
+  std::vector<AioCompletionImpl*> pcs;
+  oos.reserve(ops.size());
+  for (auto o : ops) {
+    oos.push_back(&o->impl->o);
+  }
+  pcs.reserve(cs.size());
+  for (auto c : cs) {
+    pcs.push_back(c->pc);
+  }
+  return io_ctx_impl->aio_operate_batch(objs, oos, pcs, io_ctx_impl->snapc,
+					translate_flags(flags));
+}
+
 int librados::IoCtx::aio_operate(const std::string& oid, AioCompletion *c,
 				 librados::ObjectWriteOperation *o,
 				 snap_t snap_seq, std::vector<snap_t>& snaps)
@@ -5630,6 +5653,32 @@ extern "C" int rados_aio_write_op_operate(rados_write_op_t write_op,
   return retval;
 }
 
+extern "C" int rados_aio_write_op_operate_batch(size_t num_ops,
+						rados_write_op_t *write_ops,
+						rados_ioctx_t io,
+						rados_completion_t *completions,
+						const char **oids,
+						int flags)
+{
+  tracepoint(librados, rados_aio_write_op_operate_batch_enter, num_ops, io, flags);
+  librados::IoCtxImpl *ctx = (librados::IoCtxImpl *)io;
+  std::vector<object_t> objs;
+  std::vector<::ObjectOperation*> oos;
+  std::vector<librados::AioCompletionImpl*> cs;
+  objs.reserve(num_ops);
+  oos.reserve(num_ops);
+  cs.reserve(num_ops);
+  for (size_t i = 0; i < num_ops; ++i) {
+    objs.push_back(object_t(oids[i]));
+    oos.push_back((::ObjectOperation *)write_ops[i]);
+    cs.push_back((librados::AioCompletionImpl*)completions[i]);
+  }
+  int retval = ctx->aio_operate_batch(objs, oos, cs, ctx->snapc,
+				      translate_flags(flags));
+  tracepoint(librados, rados_aio_write_op_operate_batch_exit, retval);
+  return retval;
+}
+
 extern "C" rados_read_op_t rados_create_read_op()
 {
   tracepoint(librados, rados_create_read_op_enter);
@@ -23,6 +23,8 @@ class MOSDECSubOpWriteReply : public MOSDFastDispatchOp {
   static const int COMPAT_VERSION = 1;
 
 public:
+  MEMPOOL_CLASS_HELPERS();
+
   spg_t pgid;
   epoch_t map_epoch, min_epoch;
   ECSubWriteReply op;
@@ -53,6 +53,8 @@ private:
   atomic<bool> final_decode_needed;
   //
 public:
+  MEMPOOL_CLASS_HELPERS();
+
   vector<OSDOp> ops;
 private:
   snapid_t snap_seq;
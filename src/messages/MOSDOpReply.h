@@ -49,6 +49,8 @@ class MOSDOpReply : public Message {
   request_redirect_t redirect;
 
 public:
+  MEMPOOL_CLASS_HELPERS();
+
   const object_t& get_oid() const { return oid; }
   const pg_t&     get_pg() const { return pgid; }
   int      get_flags() const { return flags; }
@@ -26,11 +26,15 @@ public:
   enum {
     OP_SCAN_GET_DIGEST = 1,      // just objects and versions
     OP_SCAN_DIGEST = 2,          // result
+    OP_SCAN_GET_BLOCK_DIGEST = 3, // block digests of object begin
+    OP_SCAN_BLOCK_DIGEST = 4,    // result
   };
   const char *get_op_name(int o) const {
     switch (o) {
     case OP_SCAN_GET_DIGEST: return "get_digest";
     case OP_SCAN_DIGEST: return "digest";
+    case OP_SCAN_GET_BLOCK_DIGEST: return "get_block_digest";
+    case OP_SCAN_BLOCK_DIGEST: return "block_digest";
     default: return "???";
     }
   }
@@ -28,6 +28,8 @@ class MOSDRepOp : public MOSDFastDispatchOp {
   static const int COMPAT_VERSION = 1;
 
 public:
+  MEMPOOL_CLASS_HELPERS();
+
   epoch_t map_epoch, min_epoch;
 
   // metadata from original request
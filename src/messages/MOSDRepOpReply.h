@@ -32,6 +32,8 @@ class MOSDRepOpReply : public MOSDFastDispatchOp {
   static const int HEAD_VERSION = 2;
   static const int COMPAT_VERSION = 1;
 public:
+  MEMPOOL_CLASS_HELPERS();
+
   epoch_t map_epoch, min_epoch;
 
   // subop metadata
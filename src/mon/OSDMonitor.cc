@@ -366,6 +366,9 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
     OSDMap::Incremental inc(inc_bl);
     err = osdmap.apply_incremental(inc);
     assert(err == 0);
+    if (g_conf->mon_osd_mapping_incremental) {
+      mapping.note_incremental(osdmap, inc);
+    }
 
     if (!t)
       t.reset(new MonitorDBStore::Transaction);
@@ -399,6 +402,7 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
 	     << dendl;
 	osdmap = OSDMap();
 	osdmap.decode(orig_full_bl);
+	mapping.mark_stale();
       }
     } else {
       assert(!inc.have_crc);
@@ -496,6 +500,8 @@ void OSDMonitor::start_mapping()
     mapping_job->abort();
   }
   auto fin = new C_UpdateCreatingPGs(this, osdmap.get_epoch());
+  mapping.set_check_incremental(
+    g_conf->mon_osd_mapping_incremental_check ? cct : nullptr);
   mapping_job = mapping.start_update(osdmap, mapper,
 				     g_conf->mon_osd_mapping_pgs_per_chunk);
   dout(10) << __func__ << " started mapping job " << mapping_job.get()
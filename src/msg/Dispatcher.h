@@ -26,6 +26,7 @@ class Connection;
 class AuthAuthorizer;
 class CryptoKey;
 class CephContext;
+struct ceph_msg_header;
 
 class Dispatcher {
 public:
@@ -90,6 +91,19 @@ public:
    * @param m A message which has been received
    */
   virtual void ms_fast_preprocess(Message *m) {}
+  /**
+   * Let a fast-dispatch capable Dispatcher provide the buffers a
+   * Message's data segment is read into, e.g. pooled page-aligned
+   * memory that the ObjectStore can use for direct IO without another
+   * copy. This is called once the header is known and before any data
+   * is read, with the same constraints as ms_fast_preprocess.
+   *
+   * @param header The header of the Message being received
+   * @param data Empty bufferlist to fill with at least header.data_len bytes
+   * @returns True if data was filled; false to use the default buffers
+   */
+  virtual bool ms_get_rx_buffer(const ceph_msg_header &header,
+				bufferlist *data) { return false; }
   /**
    * The Messenger calls this function to deliver a single message.
    *
@@ -193,6 +193,18 @@ using namespace std;
 
 #define dout_subsys ceph_subsys_ms
 
+// the OSD creates and frees these at the op rate; recycle them
+MEMPOOL_DEFINE_CACHED_OBJECT_FACTORY(MOSDOp, mosdop, osd_msg);
+MEMPOOL_DEFINE_CACHED_OBJECT_FACTORY(MOSDOpReply, mosdopreply, osd_msg);
+MEMPOOL_DEFINE_CACHED_OBJECT_FACTORY(MOSDRepOp, mosdrepop, osd_msg);
+MEMPOOL_DEFINE_CACHED_OBJECT_FACTORY(MOSDRepOpReply, mosdrepopreply, osd_msg);
+MEMPOOL_DEFINE_CACHED_OBJECT_FACTORY(MOSDECSubOpWrite, mosdecsubopwrite, osd_msg);
+MEMPOOL_DEFINE_CACHED_OBJECT_FACTORY(MOSDECSubOpWriteReply, mosdecsubopwritereply,
+				     osd_msg);
+MEMPOOL_DEFINE_CACHED_OBJECT_FACTORY(MOSDECSubOpRead, mosdecsubopread, osd_msg);
+MEMPOOL_DEFINE_CACHED_OBJECT_FACTORY(MOSDECSubOpReadReply, mosdecsubopreadreply,
+				     osd_msg);
+
 void Message::encode(uint64_t features, int crcflags)
 {
   // encode and copy out of *m
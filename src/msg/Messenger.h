@@ -591,6 +591,22 @@ public:
     }
     ceph_abort();
   }
+  /**
+   * Ask our fast Dispatchers for buffers to read a Message's data into.
+   *
+   * @param header The header of the Message being received
+   * @param data Empty bufferlist to fill
+   * @returns True if a Dispatcher filled data; false otherwise
+   */
+  bool ms_get_rx_buffer(const ceph_msg_header &header, bufferlist *data) {
+    for (list<Dispatcher*>::iterator p = fast_dispatchers.begin();
+	 p != fast_dispatchers.end();
+	 ++p) {
+      if ((*p)->ms_get_rx_buffer(header, data))
+	return true;
+    }
+    return false;
+  }
   /**
    *
    */
@@ -18,6 +18,7 @@
 
 #include "include/Context.h"
 #include "common/errno.h"
+#include "common/ceph_crypto.h"
 #include "AsyncMessenger.h"
 #include "AsyncConnection.h"
 
@@ -77,6 +78,16 @@ class C_handle_write : public EventCallback {
   }
 };
 
+class C_handle_cork : public EventCallback {
+  AsyncConnectionRef conn;
+
+ public:
+  explicit C_handle_cork(AsyncConnectionRef c): conn(c) {}
+  void do_request(int fd_or_id) override {
+    conn->handle_cork();
+  }
+};
+
 class C_clean_handler : public EventCallback {
   AsyncConnectionRef conn;
  public:
@@ -129,6 +140,8 @@ AsyncConnection::AsyncConnection(CephContext *cct, AsyncMessenger *m, DispatchQu
     recv_start(0), recv_end(0),
     last_active(ceph::coarse_mono_clock::now()),
     inactive_timeout_us(cct->_conf->ms_tcp_read_timeout*1000*1000),
+    cork_us(cct->_conf->ms_async_cork_us),
+    cork_max_bytes(cct->_conf->ms_async_cork_max_bytes),
     got_bad_auth(false), authorizer(NULL), replacing(false),
     is_reset_from_peer(false), once_ready(false), state_buffer(NULL), state_offset(0),
     worker(w), center(&w->center)
@@ -137,10 +150,12 @@ AsyncConnection::AsyncConnection(CephContext *cct, AsyncMessenger *m, DispatchQu
   write_handler = new C_handle_write(this);
   wakeup_handler = new C_time_wakeup(this);
   tick_handler = new C_tick_wakeup(this);
+  cork_handler = new C_handle_cork(this);
   memset(msgvec, 0, sizeof(msgvec));
   // double recv_max_prefetch see "read_until"
   recv_buf = new char[2*recv_max_prefetch];
   state_buffer = new char[4096];
+  worker_id = w->id;
   logger->inc(l_msgr_created_connections);
 }
 
@@ -204,6 +219,10 @@ ssize_t AsyncConnection::_try_send(bool more)
   }
 
   assert(center->in_thread());
+  if (outcoming_bl.length()) {
+    ++send_syscalls;
+    logger->inc(l_msgr_send_syscalls);
+  }
   ssize_t r = cs.send(outcoming_bl, more);
   if (r < 0) {
     ldout(async_msgr->cct, 1) << __func__ << " send error: " << cpp_strerror(r) << dendl;
@@ -328,6 +347,11 @@ void AsyncConnection::process()
 #endif
   bool need_dispatch_writer = false;
   std::lock_guard<std::mutex> l(lock);
+  if (!center->in_thread()) {
+    // queued on our previous worker before we were migrated
+    center->dispatch_event_external(read_handler);
+    return;
+  }
   last_active = ceph::coarse_mono_clock::now();
   auto recv_start_time = ceph::mono_clock::now();
   do {
@@ -609,7 +633,12 @@ void AsyncConnection::process()
           if (data_len) {
             // get a buffer
             map<ceph_tid_t,pair<bufferlist,int> >::iterator p = rx_buffers.find(current_header.tid);
-            if (p != rx_buffers.end()) {
+            if (current_header.reserved) {
+              // encoded, _decode_payload() will replace it
+              ldout(async_msgr->cct,20) << __func__ << " allocating rx buffer for encoded payload" << dendl;
+              data_buf.push_back(buffer::create(data_len));
+              data_blp = data_buf.begin();
+            } else if (p != rx_buffers.end()) {
               ldout(async_msgr->cct,10) << __func__ << " seleting rx buffer v " << p->second.second
                                   << " at offset " << data_off
                                   << " len " << p->second.first.length() << dendl;
@@ -619,8 +648,12 @@ void AsyncConnection::process()
                 data_buf.push_back(buffer::create(data_len - data_buf.length()));
               data_blp = data_buf.begin();
             } else {
-              ldout(async_msgr->cct,20) << __func__ << " allocating new rx buffer at offset " << data_off << dendl;
-              alloc_aligned_buffer(data_buf, data_len, data_off);
+              if (async_msgr->ms_get_rx_buffer(current_header, &data_buf)) {
+                ldout(async_msgr->cct,20) << __func__ << " using dispatcher rx buffer at offset " << data_off << dendl;
+              } else {
+                ldout(async_msgr->cct,20) << __func__ << " allocating new rx buffer at offset " << data_off << dendl;
+                alloc_aligned_buffer(data_buf, data_len, data_off);
+              }
               data_blp = data_buf.begin();
             }
           }
@@ -690,6 +723,15 @@ void AsyncConnection::process()
             goto fail;
           }
 
+          if (current_header.reserved || encrypt_payload) {
+            r = _decode_payload();
+            if (r < 0) {
+              ldout(async_msgr->cct, 1) << __func__ << " decode payload failed: "
+                                        << cpp_strerror(r) << dendl;
+              goto fail;
+            }
+          }
+
           ldout(async_msgr->cct, 20) << __func__ << " got " << front.length() << " + " << middle.length()
                               << " + " << data.length() << " byte message" << dendl;
           Message *message = decode_message(async_msgr->cct, async_msgr->crcflags, current_header, footer,
@@ -712,6 +754,16 @@ void AsyncConnection::process()
               goto fail;
             }
           }
+          if (policy.throttler_bytes) {
+            // the policy throttle was charged with the wire size, but the
+            // message gives back its decoded size when it goes away
+            uint64_t msg_len = message->get_payload().length() +
+              message->get_middle().length() + message->get_data().length();
+            if (msg_len > cur_msg_size)
+              policy.throttler_bytes->take(msg_len - cur_msg_size);
+            else if (msg_len < cur_msg_size)
+              policy.throttler_bytes->put(cur_msg_size - msg_len);
+          }
           message->set_byte_throttler(policy.throttler_bytes);
           message->set_message_throttler(policy.throttler_messages);
 
@@ -773,6 +825,7 @@ void AsyncConnection::process()
 
           logger->inc(l_msgr_recv_messages);
           logger->inc(l_msgr_recv_bytes, cur_msg_size + sizeof(ceph_msg_header) + sizeof(ceph_msg_footer));
+          traffic += cur_msg_size + MessageTrafficCost;
 
           async_msgr->ms_fast_preprocess(message);
           auto fast_dispatch_time = ceph::mono_clock::now();
@@ -1045,6 +1098,12 @@ ssize_t AsyncConnection::_process_connection()
         connect_msg.flags = 0;
         if (policy.lossy)
           connect_msg.flags |= CEPH_MSG_CONNECT_LOSSY;  // this is fyi, actually, server decides!
+        connect_msg.flags |= CEPH_MSG_CONNECT_ENCODE;
+        if (authorizer && authorizer->session_key.get_type() == CEPH_CRYPTO_AES) {
+          connect_msg.flags |= CEPH_MSG_CONNECT_DECRYPT;
+          if (async_msgr->cct->_conf->ms_async_encrypt)
+            connect_msg.flags |= CEPH_MSG_CONNECT_SECURE;
+        }
         bl.append((char*)&connect_msg, sizeof(connect_msg));
         if (authorizer) {
           bl.append(authorizer->bl.c_str(), authorizer->bl.length());
@@ -1191,6 +1250,17 @@ ssize_t AsyncConnection::_process_connection()
           // We have no authorizer, so we shouldn't be applying security to messages in this AsyncConnection.  PLR
           session_security.reset();
         }
+        if ((connect_msg.flags & CEPH_MSG_CONNECT_SECURE) &&
+            !(connect_reply.flags & CEPH_MSG_CONNECT_SECURE)) {
+          ldout(async_msgr->cct, 0) << __func__ << " peer cannot decrypt message payloads"
+                                    << " but ms_async_encrypt is set" << dendl;
+          goto fail;
+        }
+        // the acceptor decides, but only with a key on both sides
+        _setup_payload_codec(connect_reply.flags & CEPH_MSG_CONNECT_ENCODE,
+                             (connect_msg.flags & CEPH_MSG_CONNECT_DECRYPT) &&
+                             (connect_reply.flags & CEPH_MSG_CONNECT_SECURE),
+                             true, connect_msg.global_seq, connect_reply.global_seq);
 
         if (delay_state)
           assert(delay_state->ready());
@@ -1471,6 +1541,7 @@ ssize_t AsyncConnection::handle_connect_msg(ceph_msg_connect &connect, bufferlis
   ssize_t r = 0;
   ceph_msg_connect_reply reply;
   bufferlist reply_bl;
+  bool has_session_key = false, secure = false;
 
   memset(&reply, 0, sizeof(reply));
   reply.protocol_version = async_msgr->get_proto_version(peer_type, false);
@@ -1531,6 +1602,19 @@ ssize_t AsyncConnection::handle_connect_msg(ceph_msg_connect &connect, bufferlis
     goto fail;
   }
 
+  // payloads can only be encrypted if authentication left both sides
+  // holding a session key
+  has_session_key = connect.authorizer_protocol == CEPH_AUTH_CEPHX &&
+    session_key.get_type() == CEPH_CRYPTO_AES;
+  secure = has_session_key &&
+    (async_msgr->cct->_conf->ms_async_encrypt ||
+     (connect.flags & CEPH_MSG_CONNECT_SECURE));
+  if (secure && !(connect.flags & CEPH_MSG_CONNECT_DECRYPT)) {
+    ldout(async_msgr->cct, 1) << __func__ << " peer cannot decrypt message payloads"
+                              << " but ms_async_encrypt is set" << dendl;
+    return _reply_accept(CEPH_MSGR_TAG_FEATURES, connect, reply, authorizer_reply);
+  }
+
   if (existing == this)
     existing = NULL;
   if (existing) {
@@ -1724,6 +1808,7 @@ ssize_t AsyncConnection::handle_connect_msg(ceph_msg_connect &connect, bufferlis
           new_worker->references++;
           existing->logger = new_worker->get_perf_counter();
           existing->worker = new_worker;
+          existing->worker_id = new_worker->id;
           existing->center = new_center;
           if (existing->delay_state)
             existing->delay_state->set_center(new_center);
@@ -1798,6 +1883,11 @@ ssize_t AsyncConnection::handle_connect_msg(ceph_msg_connect &connect, bufferlis
   reply.authorizer_len = authorizer_reply.length();
   if (policy.lossy)
     reply.flags = reply.flags | CEPH_MSG_CONNECT_LOSSY;
+  reply.flags = reply.flags | CEPH_MSG_CONNECT_ENCODE;
+  if (has_session_key)
+    reply.flags = reply.flags | CEPH_MSG_CONNECT_DECRYPT;
+  if (secure)
+    reply.flags = reply.flags | CEPH_MSG_CONNECT_SECURE;
 
   set_features((uint64_t)reply.features & (uint64_t)connect.features);
   ldout(async_msgr->cct, 10) << __func__ << " accept features " << get_features() << dendl;
@@ -1805,6 +1895,8 @@ ssize_t AsyncConnection::handle_connect_msg(ceph_msg_connect &connect, bufferlis
   session_security.reset(
       get_auth_session_handler(async_msgr->cct, connect.authorizer_protocol,
                                session_key, get_features()));
+  _setup_payload_codec(connect.flags & CEPH_MSG_CONNECT_ENCODE, secure,
+                       false, connect.global_seq, reply.global_seq);
 
   reply_bl.append((char*)&reply, sizeof(reply));
 
@@ -2148,7 +2240,9 @@ void AsyncConnection::_stop()
   if (delay_state)
     delay_state->flush();
 
-  ldout(async_msgr->cct, 2) << __func__ << dendl;
+  ldout(async_msgr->cct, 2) << __func__ << " sent " << sent_messages
+                            << " messages in " << send_syscalls << " syscalls"
+                            << dendl;
   std::lock_guard<std::mutex> l(write_lock);
 
   reset_recv_state();
@@ -2191,12 +2285,26 @@ ssize_t AsyncConnection::write_message(Message *m, bufferlist& bl, bool more)
   assert(center->in_thread());
   m->set_seq(++out_seq);
 
-  if (msgr->crcflags & MSG_CRC_HEADER)
-    m->calc_header_crc();
-
   ceph_msg_header& header = m->get_header();
   ceph_msg_footer& footer = m->get_footer();
 
+  // the wire header describes the encoded payload; the crcs in the
+  // footer (and so the signature) still cover the plain one
+  ceph_msg_header plain_header = header;
+  if (peer_decodes_payload || encrypt_payload) {
+    int r = _encode_payload(m, bl);
+    if (r < 0) {
+      ldout(async_msgr->cct, 1) << __func__ << " encode payload failed: "
+                                << cpp_strerror(r) << dendl;
+      header = plain_header;
+      m->put();
+      return r;
+    }
+  }
+
+  if (msgr->crcflags & MSG_CRC_HEADER)
+    m->calc_header_crc();
+
   // TODO: let sign_message could be reentry?
   // Now that we have all the crcs calculated, handle the
   // digital signature for the message, if the AsyncConnection has session
@@ -2265,11 +2373,27 @@ ssize_t AsyncConnection::write_message(Message *m, bufferlist& bl, bool more)
     outcoming_bl.append((char*)&old_footer, sizeof(old_footer));
   }
 
+  if (header.reserved) {
+    // a resend must start over from the plain payload
+    header.front_len = plain_header.front_len;
+    header.middle_len = plain_header.middle_len;
+    header.data_len = plain_header.data_len;
+    header.reserved = plain_header.reserved;
+  }
+
   m->trace.event("async writing message");
   logger->inc(l_msgr_send_bytes, outcoming_bl.length() - original_bl_len);
+  traffic += outcoming_bl.length() - original_bl_len + MessageTrafficCost;
+  ++sent_messages;
   ldout(async_msgr->cct, 20) << __func__ << " sending " << m->get_seq()
                              << " " << m << dendl;
-  ssize_t rc = _try_send(more);
+  // if more is coming, or the cork window may hold the batch, leave
+  // small messages in outcoming_bl so that they go out together in one
+  // writev.  a batch flushed at cork_max_bytes only carries MSG_MORE if
+  // another message really follows; nothing else would push it out.
+  ssize_t rc = 0;
+  if (!(more || cork_us) || outcoming_bl.length() >= cork_max_bytes)
+    rc = _try_send(more);
   if (rc < 0) {
     ldout(async_msgr->cct, 1) << __func__ << " error sending " << m << ", "
                               << cpp_strerror(rc) << dendl;
@@ -2433,6 +2557,12 @@ void AsyncConnection::handle_write()
   ssize_t r = 0;
 
   write_lock.lock();
+  if (!center->in_thread()) {
+    // queued on our previous worker before we were migrated
+    center->dispatch_event_external(write_handler);
+    write_lock.unlock();
+    return;
+  }
   if (can_write == WriteStatus::CANWRITE) {
     if (keepalive) {
       _append_keepalive_or_ack();
@@ -2470,6 +2600,11 @@ void AsyncConnection::handle_write()
     } while (can_write == WriteStatus::CANWRITE);
     write_lock.unlock();
 
+    if (_cork()) {
+      logger->tinc(l_msgr_running_send_time, ceph::mono_clock::now() - start);
+      return;
+    }
+
     uint64_t left = ack_left;
     if (left) {
       ceph_le64 s;
@@ -2518,6 +2653,356 @@ void AsyncConnection::handle_write()
   lock.unlock();
 }
 
+/*
+ * Derive the secret for one purpose and direction of this connection
+ * from the cephx session key.  The session key is shared by every
+ * connection of the session and by both directions, so it is never used
+ * on payloads directly; the global seqs of both ends and the connect_seq
+ * tie the result to this particular handshake.
+ */
+static string derive_payload_secret(const CryptoKey& session_key, const char *purpose,
+                                    bool from_initiator, uint32_t initiator_gseq,
+                                    uint32_t acceptor_gseq, uint32_t connect_seq)
+{
+  const bufferptr& secret = session_key.get_secret();
+  bufferlist in;
+  in.append(purpose);
+  ::encode((__u8)from_initiator, in);
+  ::encode(initiator_gseq, in);
+  ::encode(acceptor_gseq, in);
+  ::encode(connect_seq, in);
+  unsigned char out[CEPH_CRYPTO_HMACSHA256_DIGESTSIZE];
+  ceph::crypto::HMACSHA256 hmac((const unsigned char*)secret.c_str(), secret.length());
+  hmac.Update((const unsigned char*)in.c_str(), in.length());
+  hmac.Final(out);
+  return string((const char*)out, sizeof(out));
+}
+
+// HMAC-SHA256 of the message seq and the sealed payload
+static void payload_mac(const string& key, uint64_t seq, const bufferlist& sealed,
+                        unsigned char *out)
+{
+  ceph_le64 s;
+  s = seq;
+  ceph::crypto::HMACSHA256 hmac((const unsigned char*)key.data(), key.length());
+  hmac.Update((const unsigned char*)&s, sizeof(s));
+  for (const auto& p : sealed.buffers())
+    hmac.Update((const unsigned char*)p.c_str(), p.length());
+  hmac.Final(out);
+}
+
+void AsyncConnection::_setup_payload_codec(bool peer_decodes, bool encrypt, bool initiator,
+                                           uint32_t initiator_gseq, uint32_t acceptor_gseq)
+{
+  CephContext *cct = async_msgr->cct;
+  peer_decodes_payload = peer_decodes;
+  encrypt_payload = false;
+  payload_tx_key = CryptoKey();
+  payload_rx_key = CryptoKey();
+  payload_tx_mac.clear();
+  payload_rx_mac.clear();
+  payload_nonce = 0;
+  if (encrypt && session_security &&
+      session_security->get_key().get_type() == CEPH_CRYPTO_AES) {
+    const CryptoKey& key = session_security->get_key();
+    unsigned key_len = key.get_secret().length();
+    string tx = derive_payload_secret(key, "msgr payload key", initiator,
+                                      initiator_gseq, acceptor_gseq, connect_seq);
+    string rx = derive_payload_secret(key, "msgr payload key", !initiator,
+                                      initiator_gseq, acceptor_gseq, connect_seq);
+    bufferptr tx_secret(tx.data(), key_len), rx_secret(rx.data(), key_len);
+    utime_t now = ceph_clock_now();
+    if (payload_tx_key.set_secret(CEPH_CRYPTO_AES, tx_secret, now) == 0 &&
+        payload_rx_key.set_secret(CEPH_CRYPTO_AES, rx_secret, now) == 0) {
+      payload_tx_mac = derive_payload_secret(key, "msgr payload mac", initiator,
+                                             initiator_gseq, acceptor_gseq, connect_seq);
+      payload_rx_mac = derive_payload_secret(key, "msgr payload mac", !initiator,
+                                             initiator_gseq, acceptor_gseq, connect_seq);
+      // the first cipher block of every message is this salt and a
+      // counter, which makes it unique and unpredictable without the key
+      get_random_bytes((char*)&payload_salt, sizeof(payload_salt));
+      encrypt_payload = true;
+    } else {
+      lderr(cct) << __func__ << " unable to set up payload keys" << dendl;
+    }
+  }
+  ldout(cct, 10) << __func__ << " peer_decodes " << peer_decodes_payload
+                 << " encrypt " << encrypt_payload << dendl;
+}
+
+/*
+ * Compress the data segment and/or encrypt the payload of m for a peer
+ * that advertised CEPH_MSG_CONNECT_ENCODE.  bl holds front, middle and
+ * data and is replaced by the encoded payload; the header lengths are
+ * updated to match and CEPH_MSG_HEADER_* flags in header.reserved tell
+ * the peer how to undo it.
+ *
+ * compressed data: u8 algorithm, le32 raw length, compressed bytes
+ * encrypted: all in the data segment, AES with this direction's key of
+ *   le64 salt, le64 nonce, le64 seq, le32 front/middle/data lengths,
+ *   payload; followed by an HMAC-SHA256 of the seq and the ciphertext.
+ */
+int AsyncConnection::_encode_payload(Message *m, bufferlist &bl)
+{
+  CephContext *cct = async_msgr->cct;
+  ceph_msg_header &header = m->get_header();
+
+  CompressorRef compressor = async_msgr->compressor;
+  if (compressor && peer_decodes_payload &&
+      header.data_len >= cct->_conf->ms_async_compress_min_size) {
+    unsigned head_len = header.front_len + header.middle_len;
+    bufferlist raw, compressed;
+    raw.substr_of(bl, head_len, header.data_len);
+    // only bother if it saves at least 1/8th
+    if (compressor->compress(raw, compressed) == 0 &&
+        compressed.length() + 5 + (raw.length() >> 3) <= raw.length()) {
+      bufferlist out;
+      out.substr_of(bl, 0, head_len);
+      __u8 alg = compressor->get_type();
+      ::encode(alg, out);
+      ::encode((uint32_t)raw.length(), out);
+      out.claim_append(compressed);
+      header.data_len = out.length() - head_len;
+      header.reserved = header.reserved | CEPH_MSG_HEADER_COMPRESSED;
+      logger->inc(l_msgr_send_compressed_bytes, raw.length());
+      logger->inc(l_msgr_send_compressed_saved, raw.length() - header.data_len);
+      bl.swap(out);
+    }
+  }
+
+  if (encrypt_payload) {
+    bufferlist plain, sealed;
+    ::encode(payload_salt, plain);
+    ::encode(++payload_nonce, plain);
+    ::encode(m->get_seq(), plain);
+    ::encode((uint32_t)header.front_len, plain);
+    ::encode((uint32_t)header.middle_len, plain);
+    ::encode((uint32_t)header.data_len, plain);
+    plain.claim_append(bl);
+    string error;
+    if (payload_tx_key.encrypt(cct, plain, sealed, &error) < 0) {
+      lderr(cct) << __func__ << " encrypt failed: " << error << dendl;
+      return -EIO;
+    }
+    unsigned char mac[CEPH_CRYPTO_HMACSHA256_DIGESTSIZE];
+    payload_mac(payload_tx_mac, m->get_seq(), sealed, mac);
+    sealed.append((const char*)mac, sizeof(mac));
+    header.front_len = 0;
+    header.middle_len = 0;
+    header.data_len = sealed.length();
+    header.reserved = header.reserved | CEPH_MSG_HEADER_ENCRYPTED;
+    logger->inc(l_msgr_send_encrypted_messages);
+    bl.swap(sealed);
+  }
+  return 0;
+}
+
+// undo _encode_payload() on current_header, front, middle and data
+int AsyncConnection::_decode_payload()
+{
+  CephContext *cct = async_msgr->cct;
+
+  // the flags are not covered by the payload mac; never let them
+  // downgrade a connection to plaintext or pick an unnegotiated codec
+  if (encrypt_payload &&
+      !(current_header.reserved & CEPH_MSG_HEADER_ENCRYPTED)) {
+    ldout(cct, 1) << __func__ << " plaintext payload on an encrypted connection" << dendl;
+    return -EPERM;
+  }
+  if ((current_header.reserved & CEPH_MSG_HEADER_COMPRESSED) &&
+      !peer_decodes_payload) {
+    ldout(cct, 1) << __func__ << " compressed payload but no codec negotiated" << dendl;
+    return -EINVAL;
+  }
+
+  if (current_header.reserved & CEPH_MSG_HEADER_ENCRYPTED) {
+    if (!encrypt_payload) {
+      ldout(cct, 1) << __func__ << " encrypted payload but none negotiated" << dendl;
+      return -EINVAL;
+    }
+    unsigned char mac[CEPH_CRYPTO_HMACSHA256_DIGESTSIZE];
+    if (data.length() < sizeof(mac))
+      return -EINVAL;
+    bufferlist sealed, plain;
+    sealed.substr_of(data, 0, data.length() - sizeof(mac));
+    payload_mac(payload_rx_mac, current_header.seq, sealed, mac);
+    unsigned char diff = 0;
+    bufferlist::iterator t = data.begin();
+    t.seek(sealed.length());
+    for (unsigned i = 0; i < sizeof(mac); ++i, ++t)
+      diff |= mac[i] ^ (unsigned char)*t;
+    if (diff) {
+      ldout(cct, 1) << __func__ << " payload authentication failed" << dendl;
+      return -EBADMSG;
+    }
+    string error;
+    if (payload_rx_key.decrypt(cct, sealed, plain, &error) < 0) {
+      ldout(cct, 1) << __func__ << " decrypt failed: " << error << dendl;
+      return -EINVAL;
+    }
+    uint64_t salt, nonce, seq;
+    uint32_t front_len, middle_len, data_len;
+    bufferlist::iterator p = plain.begin();
+    try {
+      ::decode(salt, p);
+      ::decode(nonce, p);
+      ::decode(seq, p);
+      ::decode(front_len, p);
+      ::decode(middle_len, p);
+      ::decode(data_len, p);
+      // the sealed payload must belong to this header
+      if (seq != current_header.seq ||
+          p.get_remaining() != (uint64_t)front_len + middle_len + data_len)
+        return -EINVAL;
+      front.clear();
+      middle.clear();
+      data.clear();
+      p.copy(front_len, front);
+      p.copy(middle_len, middle);
+      p.copy(data_len, data);
+    } catch (buffer::error& e) {
+      return -EINVAL;
+    }
+    current_header.front_len = front_len;
+    current_header.middle_len = middle_len;
+    current_header.data_len = data_len;
+  }
+
+  if (current_header.reserved & CEPH_MSG_HEADER_COMPRESSED) {
+    __u8 alg;
+    uint32_t raw_len;
+    bufferlist raw;
+    bufferlist::iterator p = data.begin();
+    try {
+      ::decode(alg, p);
+      ::decode(raw_len, p);
+      // the raw length is the peer's word; don't let it make us inflate
+      // more than any message may carry
+      if (raw_len > cct->_conf->ms_async_decompress_max_size) {
+        ldout(cct, 1) << __func__ << " compressed data claims " << raw_len
+                      << " bytes, more than ms_async_decompress_max_size "
+                      << cct->_conf->ms_async_decompress_max_size << dendl;
+        return -EMSGSIZE;
+      }
+      if (!decompressor || decompressor->get_type() != alg)
+        decompressor = Compressor::create(cct, alg);
+      if (!decompressor) {
+        ldout(cct, 1) << __func__ << " no compressor for algorithm " << (int)alg << dendl;
+        return -EOPNOTSUPP;
+      }
+      // stop inflating as soon as it outgrows the claim
+      int r = decompressor->decompress(p, p.get_remaining(), raw, raw_len);
+      if (r < 0)
+        return r;
+    } catch (buffer::error& e) {
+      return -EINVAL;
+    }
+    if (raw.length() != raw_len)
+      return -EINVAL;
+    data.swap(raw);
+    current_header.data_len = raw_len;
+  }
+
+  current_header.reserved = current_header.reserved &
+    ~(CEPH_MSG_HEADER_COMPRESSED | CEPH_MSG_HEADER_ENCRYPTED);
+  return 0;
+}
+
+// Hold a small batch back for up to ms_async_cork_us so that messages
+// queued in the meantime share its syscall.  Returns true if the batch
+// stays corked; cork_handler flushes it when the window closes.
+bool AsyncConnection::_cork()
+{
+  assert(center->in_thread());
+  if (cork_flush || !cork_us || open_write ||
+      (!outcoming_bl.length() && !ack_left) ||
+      outcoming_bl.length() >= cork_max_bytes) {
+    cork_flush = false;
+    if (cork_timer_id) {
+      center->delete_time_event(cork_timer_id);
+      cork_timer_id = 0;
+    }
+    return false;
+  }
+  if (!cork_timer_id) {
+    ldout(async_msgr->cct, 20) << __func__ << " corking " << outcoming_bl.length()
+                               << " bytes for " << cork_us << "us" << dendl;
+    cork_timer_id = center->create_time_event(cork_us, cork_handler);
+  }
+  return true;
+}
+
+void AsyncConnection::handle_cork()
+{
+  ldout(async_msgr->cct, 20) << __func__ << dendl;
+  cork_timer_id = 0;
+  cork_flush = true;
+  handle_write();
+}
+
+void AsyncConnection::migrate_to(Worker *new_worker)
+{
+  EventCenter *c;
+  {
+    std::lock_guard<std::mutex> l(lock);
+    c = center;
+  }
+  // the handoff starts in the thread that owns us now
+  AsyncConnectionRef self(this);
+  c->submit_to(c->get_id(), [self, new_worker]() {
+      self->_migrate(new_worker);
+    }, true);
+}
+
+void AsyncConnection::_migrate(Worker *new_worker)
+{
+  std::lock_guard<std::mutex> l(lock);
+  // only move between messages, with no timers pending
+  if (!center->in_thread() || worker == new_worker || state != STATE_OPEN ||
+      delay_state || !register_time_events.empty())
+    return;
+  std::lock_guard<std::mutex> wl(write_lock);
+  if (can_write != WriteStatus::CANWRITE || cork_timer_id)
+    return;
+
+  ldout(async_msgr->cct, 10) << __func__ << " from worker " << worker->id
+                             << " to worker " << new_worker->id << dendl;
+  center->delete_file_event(cs.fd(), EVENT_READABLE|EVENT_WRITABLE);
+  open_write = false;
+  if (last_tick_id) {
+    center->delete_time_event(last_tick_id);
+    last_tick_id = 0;
+  }
+  worker->references--;
+  new_worker->references++;
+  logger = new_worker->get_perf_counter();
+  logger->inc(l_msgr_migrated_connections);
+  worker = new_worker;
+  worker_id = new_worker->id;
+  center = &new_worker->center;
+
+  // handlers already queued on the old worker forward themselves, see
+  // process() and handle_write()
+  AsyncConnectionRef self(this);
+  center->submit_to(center->get_id(), [self]() {
+      self->_migrated();
+    }, true);
+}
+
+void AsyncConnection::_migrated()
+{
+  std::lock_guard<std::mutex> l(lock);
+  // a fault during the handoff leaves the new worker to reconnect
+  if (!center->in_thread() || state < STATE_OPEN || state > STATE_WAIT_SEND)
+    return;
+  center->create_file_event(cs.fd(), EVENT_READABLE, read_handler);
+  if (!last_tick_id)
+    last_tick_id = center->create_time_event(inactive_timeout_us, tick_handler);
+  // pick up anything prefetched or queued during the handoff
+  center->dispatch_event_external(read_handler);
+  center->dispatch_event_external(write_handler);
+}
+
 void AsyncConnection::wakeup_from(uint64_t id)
 {
   lock.lock();
@@ -28,6 +28,7 @@ using namespace std;
 
 #include "auth/AuthSessionHandler.h"
 #include "common/ceph_time.h"
+#include "compressor/Compressor.h"
 #include "common/perf_counters.h"
 #include "include/buffer.h"
 #include "msg/Connection.h"
@@ -106,6 +107,11 @@ class AsyncConnection : public Connection {
       center->delete_time_event(last_tick_id);
       last_tick_id = 0;
     }
+    if (cork_timer_id) {
+      center->delete_time_event(cork_timer_id);
+      cork_timer_id = 0;
+    }
+    cork_flush = false;
     if (cs) {
       center->delete_file_event(cs.fd(), EVENT_READABLE|EVENT_WRITABLE);
       cs.shutdown();
@@ -326,6 +332,7 @@ class AsyncConnection : public Connection {
   EventCallbackRef write_handler;
   EventCallbackRef wakeup_handler;
   EventCallbackRef tick_handler;
+  EventCallbackRef cork_handler;
   struct iovec msgvec[ASYNC_IOV_MAX];
   char *recv_buf;
   uint32_t recv_max_prefetch;
@@ -336,6 +343,23 @@ class AsyncConnection : public Connection {
   uint64_t last_tick_id = 0;
   const uint64_t inactive_timeout_us;
 
+  // write coalescing, only touched from the worker thread
+  const uint64_t cork_us;
+  const uint64_t cork_max_bytes;
+  uint64_t cork_timer_id = 0;
+  bool cork_flush = false;
+  uint64_t sent_messages = 0;
+  uint64_t send_syscalls = 0;
+
+  // payload compression/encryption negotiated at connect time
+  bool peer_decodes_payload = false;
+  bool encrypt_payload = false;
+  CryptoKey payload_tx_key, payload_rx_key;
+  string payload_tx_mac, payload_rx_mac;
+  uint64_t payload_salt = 0;
+  uint64_t payload_nonce = 0;
+  CompressorRef decompressor;
+
   // Tis section are temp variables used by state transition
 
   // Open state
@@ -373,9 +397,22 @@ class AsyncConnection : public Connection {
   EventCenter *center;
   ceph::shared_ptr<AuthSessionHandler> session_security;
 
+  // worker rebalancing, see AsyncMessenger::rebalance_connections()
+  std::atomic<uint64_t> traffic{0};  ///< bytes moved plus MessageTrafficCost per message
+  uint64_t traffic_sampled = 0;      ///< protected by AsyncMessenger::lock
+  std::atomic<unsigned> worker_id;
+  void _migrate(Worker *new_worker);
+  void _migrated();
+  void _setup_payload_codec(bool peer_decodes, bool encrypt, bool initiator,
+                            uint32_t initiator_gseq, uint32_t acceptor_gseq);
+  int _encode_payload(Message *m, bufferlist &bl);
+  int _decode_payload();
+  bool _cork();
+
  public:
   // used by eventcallback
   void handle_write();
+  void handle_cork();
   void process();
   void wakeup_from(uint64_t id);
   void tick(uint64_t id);
@@ -394,6 +431,7 @@ class AsyncConnection : public Connection {
     delete write_handler;
     delete wakeup_handler;
     delete tick_handler;
+    delete cork_handler;
     if (delay_state) {
       delete delay_state;
       delay_state = NULL;
@@ -402,6 +440,21 @@ class AsyncConnection : public Connection {
   PerfCounters *get_perf_counter() {
     return logger;
   }
+
+  /// what handling one message costs a worker, in bytes of traffic
+  static const uint64_t MessageTrafficCost = 4096;
+  /// traffic since the last call; caller holds AsyncMessenger::lock
+  uint64_t sample_traffic() {
+    uint64_t t = traffic;
+    uint64_t d = t - traffic_sampled;
+    traffic_sampled = t;
+    return d;
+  }
+  unsigned get_worker_id() const {
+    return worker_id;
+  }
+  /// hand this connection over to new_worker, if it is idle and open
+  void migrate_to(Worker *new_worker);
 }; /* AsyncConnection */
 
 typedef boost::intrusive_ptr<AsyncConnection> AsyncConnectionRef;
@@ -16,7 +16,9 @@
 
 #include "acconfig.h"
 
+#include <algorithm>
 #include <iostream>
+#include <numeric>
 #include <fstream>
 
 #include "AsyncMessenger.h"
@@ -238,6 +240,16 @@ class C_handle_reap : public EventCallback {
   }
 };
 
+class C_handle_rebalance : public EventCallback {
+  AsyncMessenger *msgr;
+
+  public:
+  explicit C_handle_rebalance(AsyncMessenger *m): msgr(m) {}
+  void do_request(int id) override {
+    msgr->rebalance_connections();
+  }
+};
+
 /*******************
  * AsyncMessenger
  */
@@ -267,6 +279,14 @@ AsyncMessenger::AsyncMessenger(CephContext *cct, entity_name_t name,
   local_connection = new AsyncConnection(cct, this, &dispatch_queue, local_worker);
   init_local_connection();
   reap_handler = new C_handle_reap(this);
+  rebalance_handler = new C_handle_rebalance(this);
+  const string& alg = cct->_conf->ms_async_compress_algorithm;
+  if (!alg.empty() && alg != "none") {
+    compressor = Compressor::create(cct, alg);
+    if (!compressor)
+      lderr(cct) << __func__ << " unable to load compressor " << alg
+                 << ", message data will not be compressed" << dendl;
+  }
   unsigned processor_num = 1;
   if (stack->support_local_listen_table())
     processor_num = stack->get_num_worker();
@@ -281,6 +301,7 @@ AsyncMessenger::AsyncMessenger(CephContext *cct, entity_name_t name,
 AsyncMessenger::~AsyncMessenger()
 {
   delete reap_handler;
+  delete rebalance_handler;
   assert(!did_bind); // either we didn't bind or we shut down the Processor
   local_connection->mark_down();
   for (auto &&p : processors)
@@ -304,6 +325,16 @@ void AsyncMessenger::ready()
   for (auto &&p : processors)
     p->start();
   dispatch_queue.start();
+
+  if (cct->_conf->ms_async_rebalance_interval > 0 &&
+      stack->support_connection_migration() &&
+      stack->get_num_worker() > 1) {
+    local_worker->center.submit_to(
+      local_worker->center.get_id(), [this]() {
+	Mutex::Locker l(lock);
+	_schedule_rebalance();
+      }, true);
+  }
 }
 
 int AsyncMessenger::shutdown()
@@ -321,10 +352,72 @@ int AsyncMessenger::shutdown()
   stop_cond.Signal();
   stopped = true;
   lock.Unlock();
+  local_worker->center.submit_to(
+    local_worker->center.get_id(), [this]() {
+      if (rebalance_timer_id) {
+	local_worker->center.delete_time_event(rebalance_timer_id);
+	rebalance_timer_id = 0;
+      }
+    }, false);
   stack->drain();
   return 0;
 }
 
+void AsyncMessenger::_schedule_rebalance()
+{
+  assert(lock.is_locked());
+  if (stopped)
+    return;
+  rebalance_timer_id = local_worker->center.create_time_event(
+    cct->_conf->ms_async_rebalance_interval * 1000000, rebalance_handler);
+}
+
+void AsyncMessenger::rebalance_connections()
+{
+  Mutex::Locker l(lock);
+  rebalance_timer_id = 0;
+
+  unsigned n = stack->get_num_worker();
+  vector<double> load(n, 0);
+  vector<pair<AsyncConnectionRef, double> > traffic;
+  traffic.reserve(conns.size());
+  for (auto &p : conns) {
+    double t = p.second->sample_traffic();
+    unsigned w = p.second->get_worker_id();
+    assert(w < n);
+    load[w] += t;
+    traffic.push_back(make_pair(p.second, t));
+  }
+
+  unsigned hi = std::max_element(load.begin(), load.end()) - load.begin();
+  unsigned lo = std::min_element(load.begin(), load.end()) - load.begin();
+  double avg = std::accumulate(load.begin(), load.end(), 0.0) / n;
+  if (avg > 0 &&
+      load[hi] > avg * (1.0 + cct->_conf->ms_async_rebalance_threshold)) {
+    // the move that leaves hi and lo closest together
+    double gap = load[hi] - load[lo];
+    AsyncConnectionRef best;
+    double best_gain = 0;
+    for (auto &p : traffic) {
+      if (p.first->get_worker_id() != hi)
+	continue;
+      double gain = MIN(p.second, gap - p.second);
+      if (gain > best_gain) {
+	best = p.first;
+	best_gain = gain;
+      }
+    }
+    if (best) {
+      ldout(cct, 10) << __func__ << " worker " << hi << " load " << load[hi]
+		     << " avg " << avg << ", moving " << best
+		     << " to worker " << lo << dendl;
+      best->migrate_to(stack->get_worker(lo));
+    }
+  }
+
+  _schedule_rebalance();
+}
+
 
 int AsyncMessenger::bind(const entity_addr_t &bind_addr)
 {
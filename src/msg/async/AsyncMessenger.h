@@ -294,6 +294,11 @@ private:
 
   EventCallbackRef reap_handler;
 
+  /// periodic rebalancing, only touched in local_worker's thread
+  EventCallbackRef rebalance_handler;
+  uint64_t rebalance_timer_id = 0;
+  void _schedule_rebalance();
+
   /// internal cluster protocol version, if any, for talking to entities of the same type.
   int cluster_protocol;
 
@@ -332,6 +337,9 @@ public:
   /// con used for sending messages to ourselves
   ConnectionRef local_connection;
 
+  /// compresses outgoing message data, see ms_async_compress_algorithm
+  CompressorRef compressor;
+
   /**
    * @defgroup AsyncMessenger internals
    * @{
@@ -441,6 +449,18 @@ public:
    */
   int reap_dead();
 
+  /**
+   * Move one connection off the worker carrying the most traffic
+   *
+   * Traffic is what each connection moved since the last call.  If the
+   * busiest worker is above the average by more than
+   * ms_async_rebalance_threshold, the connection on it whose move
+   * brings it closest to the idlest worker is handed over there.  Only
+   * our own connections are counted, even if other messengers share
+   * the workers.
+   */
+  void rebalance_connections();
+
   /**
    * @} // AsyncMessenger Internals
    */
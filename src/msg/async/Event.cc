@@ -137,6 +137,11 @@ int EventCenter::init(int n, unsigned i, const std::string &t)
   file_events.resize(n);
   nevent = n;
 
+  if (t != "dpdk" && cct->_conf->ms_async_busy_poll_us) {
+    busy_poll_max = std::chrono::microseconds(cct->_conf->ms_async_busy_poll_us);
+    busy_poll_window = busy_poll_max;
+  }
+
   if (!driver->need_wakeup())
     return 0;
 
@@ -364,7 +369,20 @@ int EventCenter::process_events(int timeout_microseconds,  ceph::timespan *worki
 
   auto it = time_events.begin();
   bool blocking = pollers.empty() && !external_num_events.load();
-  // If exists external events or poller, don't block
+  bool spinning = false;
+  if (blocking && busy_polling) {
+    if (ceph::mono_clock::now() < busy_poll_until) {
+      spinning = true;
+      blocking = false;
+    } else {
+      // spun for the whole window for nothing
+      busy_poll_window = std::max(busy_poll_window / 2, busy_poll_max / 16);
+      busy_polling = false;
+      ldout(cct, 30) << __func__ << " busy poll window shrinks to "
+                     << busy_poll_window << dendl;
+    }
+  }
+  // If exists external events or poller or we are busy polling, don't block
   if (!blocking) {
     if (it != time_events.end() && now >= it->first)
       trigger_time = true;
@@ -442,6 +460,13 @@ int EventCenter::process_events(int timeout_microseconds,  ceph::timespan *worki
       numevents += pollers[i]->poll();
   }
 
+  if (numevents && busy_poll_max != ceph::timespan::zero()) {
+    if (spinning)
+      busy_poll_window = std::min(busy_poll_window * 2, busy_poll_max);
+    busy_poll_until = ceph::mono_clock::now() + busy_poll_window;
+    busy_polling = true;
+  }
+
   if (working_dur)
     *working_dur = ceph::mono_clock::now() - working_start;
   return numevents;
@@ -175,6 +175,14 @@ class EventCenter {
   unsigned idx;
   AssociatedCenters *global_centers = nullptr;
 
+  // adaptive busy polling (ms_async_busy_poll_us): after handling events
+  // we keep polling until busy_poll_until.  The window doubles when
+  // spinning finds an event and halves when it expires empty.
+  ceph::timespan busy_poll_max = ceph::timespan::zero();
+  ceph::timespan busy_poll_window = ceph::timespan::zero();
+  ceph::mono_time busy_poll_until;
+  bool busy_polling = false;
+
   int process_time_events();
   FileEvent *_get_file_event(int fd) {
     assert(fd < nevent);
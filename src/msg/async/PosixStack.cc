@@ -15,12 +15,15 @@
  */
 
 #include <sys/socket.h>
+#include <pthread.h>
+#include <sched.h>
 #include <netinet/tcp.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <errno.h>
 
 #include <algorithm>
+#include <deque>
 
 #include "PosixStack.h"
 
@@ -37,10 +40,21 @@
 #define dout_prefix *_dout << "PosixStack "
 
 class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
+  CephContext *cct;
+  PerfCounters *logger;
   NetHandler &handler;
   int _fd;
   entity_addr_t sa;
   bool connected;
+
+  // MSG_ZEROCOPY state.  The kernel numbers each successful zero copy
+  // sendmsg() call and later reports ranges of completed calls on the
+  // socket error queue; until then the pages must not be reused, so we
+  // hold the sent buffers, tagged with the number of the last call that
+  // covered them.  TCP completes calls in order.
+  bool zero_copy = false;
+  uint32_t zero_copy_next = 0;
+  std::deque<std::pair<uint32_t, bufferlist> > zero_copy_pending;
 #if !defined(MSG_NOSIGNAL) && !defined(SO_NOSIGPIPE)
   sigset_t sigpipe_mask;
   bool sigpipe_pending;
@@ -48,8 +62,14 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
 #endif
 
  public:
-  explicit PosixConnectedSocketImpl(NetHandler &h, const entity_addr_t &sa, int f, bool connected)
-      : handler(h), _fd(f), sa(sa), connected(connected) {}
+  explicit PosixConnectedSocketImpl(Worker *w, NetHandler &h, const entity_addr_t &sa, int f, bool connected)
+      : cct(w->cct), logger(w->get_perf_counter()),
+        handler(h), _fd(f), sa(sa), connected(connected) {
+  #ifdef __linux__
+    zero_copy = cct->_conf->ms_async_zero_copy_send &&
+      handler.set_zero_copy(f) == 0;
+  #endif
+  }
 
   int is_connected() override {
     if (connected)
@@ -71,6 +91,9 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   }
 
   ssize_t read(char *buf, size_t len) override {
+    // completions also wake us up as readable
+    if (!zero_copy_pending.empty())
+      reap_zero_copy();
     ssize_t r = ::read(_fd, buf, len);
     if (r < 0)
       r = -errno;
@@ -139,9 +162,40 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   #endif  /* !defined(MSG_NOSIGNAL) && !defined(SO_NOSIGPIPE) */
   }
 
+  // release buffers whose zero copy sends the kernel has finished with
+  void reap_zero_copy()
+  {
+  #ifdef __linux__
+    while (true) {
+      char control[CMSG_SPACE(sizeof(struct sock_extended_err))];
+      struct msghdr msg;
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof(control);
+      if (::recvmsg(_fd, &msg, MSG_ERRQUEUE) < 0)
+        break;  // EAGAIN: nothing more to reap
+      struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+      if (!cm)
+        break;
+      struct sock_extended_err *serr = (struct sock_extended_err*)CMSG_DATA(cm);
+      if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+        continue;
+      if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+        logger->inc(l_msgr_send_zero_copy_copied);
+      // calls [ee_info, ee_data] are done; numbers wrap at 2^32
+      uint32_t hi = serr->ee_data;
+      while (!zero_copy_pending.empty() &&
+             (int32_t)(zero_copy_pending.front().first - hi) <= 0)
+        zero_copy_pending.pop_front();
+    }
+  #endif
+  }
+
   // return the sent length
   // < 0 means error occured
-  static ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more)
+  // *calls is incremented for each successful zero copy sendmsg() call
+  static ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more,
+                            int flags = 0, uint32_t *calls = nullptr)
   {
     suppress_sigpipe();
 
@@ -149,9 +203,9 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
     while (1) {
       ssize_t r;
   #if defined(MSG_NOSIGNAL)
-      r = ::sendmsg(fd, &msg, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+      r = ::sendmsg(fd, &msg, flags | MSG_NOSIGNAL | (more ? MSG_MORE : 0));
   #else
-      r = ::sendmsg(fd, &msg, (more ? MSG_MORE : 0));
+      r = ::sendmsg(fd, &msg, flags | (more ? MSG_MORE : 0));
   #endif /* defined(MSG_NOSIGNAL) */
 
       if (r < 0) {
@@ -159,9 +213,15 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
           continue;
         } else if (errno == EAGAIN) {
           break;
+        } else if (errno == ENOBUFS && flags) {
+          // out of optmem for zero copy notifications; copy this one
+          flags = 0;
+          continue;
         }
         return -errno;
       }
+      if (calls && flags)
+        ++*calls;
 
       sent += r;
       if (len == sent) break;
@@ -184,6 +244,16 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   }
 
   ssize_t send(bufferlist &bl, bool more) override {
+    int flags = 0;
+  #ifdef __linux__
+    if (zero_copy) {
+      if (!zero_copy_pending.empty())
+        reap_zero_copy();
+      if (bl.length() >= cct->_conf->ms_async_zero_copy_send_min)
+        flags = MSG_ZEROCOPY;
+    }
+  #endif
+    uint32_t first_call = zero_copy_next;
     size_t sent_bytes = 0;
     std::list<bufferptr>::const_iterator pb = bl.buffers().begin();
     uint64_t left_pbrs = bl.buffers().size();
@@ -205,7 +275,8 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
         size--;
       }
 
-      ssize_t r = do_sendmsg(_fd, msg, msglen, left_pbrs || more);
+      ssize_t r = do_sendmsg(_fd, msg, msglen, left_pbrs || more,
+                             flags, &zero_copy_next);
       if (r < 0)
         return r;
 
@@ -222,7 +293,13 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
         bl.splice(sent_bytes, bl.length()-sent_bytes, &swapped);
         bl.swap(swapped);
       } else {
-        bl.clear();
+        swapped.swap(bl);
+      }
+      if (zero_copy_next != first_call) {
+        // hold the sent buffers until the kernel reports completion
+        logger->inc(l_msgr_send_zero_copy_bytes, sent_bytes);
+        zero_copy_pending.emplace_back(zero_copy_next - 1, bufferlist());
+        zero_copy_pending.back().second.claim(swapped);
       }
     }
 
@@ -283,7 +360,7 @@ int PosixServerSocketImpl::accept(ConnectedSocket *sock, const SocketOptions &op
   out->set_sockaddr((sockaddr*)&ss);
   handler.set_priority(sd, opt.priority, out->get_family());
 
-  std::unique_ptr<PosixConnectedSocketImpl> csi(new PosixConnectedSocketImpl(handler, *out, sd, true));
+  std::unique_ptr<PosixConnectedSocketImpl> csi(new PosixConnectedSocketImpl(w, handler, *out, sd, true));
   *sock = ConnectedSocket(std::move(csi));
   return 0;
 }
@@ -351,7 +428,7 @@ int PosixWorker::connect(const entity_addr_t &addr, const SocketOptions &opts, C
 
   net.set_priority(sd, opts.priority, addr.get_family());
   *socket = ConnectedSocket(
-      std::unique_ptr<PosixConnectedSocketImpl>(new PosixConnectedSocketImpl(net, addr, sd, !opts.nonblock)));
+      std::unique_ptr<PosixConnectedSocketImpl>(new PosixConnectedSocketImpl(this, net, addr, sd, !opts.nonblock)));
   return 0;
 }
 
@@ -369,3 +446,22 @@ PosixNetworkStack::PosixNetworkStack(CephContext *c, const string &t)
       lderr(cct) << __func__ << " failed to parse " << corestr << " in " << cct->_conf->ms_async_affinity_cores << dendl;
   }
 }
+
+void PosixNetworkStack::set_worker_affinity(unsigned i)
+{
+#ifdef __linux__
+  int cpuid = get_cpuid(i);
+  if (!cct->_conf->ms_async_set_affinity || cpuid < 0 || cpuid >= CPU_SETSIZE)
+    return;
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  CPU_SET(cpuid, &cpuset);
+  int r = pthread_setaffinity_np(threads[i].native_handle(), sizeof(cpuset), &cpuset);
+  if (r) {
+    lderr(cct) << __func__ << " failed to pin worker " << i << " to cpu "
+               << cpuid << ": " << cpp_strerror(r) << dendl;
+  } else {
+    ldout(cct, 10) << __func__ << " pinned worker " << i << " to cpu " << cpuid << dendl;
+  }
+#endif
+}
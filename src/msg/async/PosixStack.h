@@ -39,9 +39,14 @@ class PosixNetworkStack : public NetworkStack {
   vector<int> coreids;
   vector<std::thread> threads;
 
+  /// pin worker i to its ms_async_affinity_cores entry, if any
+  void set_worker_affinity(unsigned i);
+
  public:
   explicit PosixNetworkStack(CephContext *c, const string &t);
 
+  bool support_connection_migration() const override { return true; }
+
   int get_cpuid(int id) const {
     if (coreids.empty())
       return -1;
@@ -50,6 +55,7 @@ class PosixNetworkStack : public NetworkStack {
   void spawn_worker(unsigned i, std::function<void ()> &&func) override {
     threads.resize(i+1);
     threads[i] = std::thread(func);
+    set_worker_affinity(i);
   }
   void join_worker(unsigned i) override {
     assert(threads.size() > i && threads[i].joinable());
@@ -189,6 +189,7 @@ enum {
   l_msgr_first = 94000,
   l_msgr_recv_messages,
   l_msgr_send_messages,
+  l_msgr_send_syscalls,
   l_msgr_recv_bytes,
   l_msgr_send_bytes,
   l_msgr_created_connections,
@@ -199,6 +200,15 @@ enum {
   l_msgr_running_recv_time,
   l_msgr_running_fast_dispatch_time,
 
+  l_msgr_send_zero_copy_bytes,
+  l_msgr_send_zero_copy_copied,
+
+  l_msgr_migrated_connections,
+
+  l_msgr_send_compressed_bytes,
+  l_msgr_send_compressed_saved,
+  l_msgr_send_encrypted_messages,
+
   l_msgr_last,
 };
 
@@ -229,6 +239,7 @@ class Worker {
 
     plb.add_u64_counter(l_msgr_recv_messages, "msgr_recv_messages", "Network received messages");
     plb.add_u64_counter(l_msgr_send_messages, "msgr_send_messages", "Network sent messages");
+    plb.add_u64_counter(l_msgr_send_syscalls, "msgr_send_syscalls", "Network send calls, messages are coalesced into fewer of these");
     plb.add_u64_counter(l_msgr_recv_bytes, "msgr_recv_bytes", "Network received bytes");
     plb.add_u64_counter(l_msgr_send_bytes, "msgr_send_bytes", "Network received bytes");
     plb.add_u64_counter(l_msgr_active_connections, "msgr_active_connections", "Active connection number");
@@ -239,6 +250,13 @@ class Worker {
     plb.add_time(l_msgr_running_recv_time, "msgr_running_recv_time", "The total time of message receiving");
     plb.add_time(l_msgr_running_fast_dispatch_time, "msgr_running_fast_dispatch_time", "The total time of fast dispatch");
 
+    plb.add_u64_counter(l_msgr_send_zero_copy_bytes, "msgr_send_zero_copy_bytes", "Bytes sent with MSG_ZEROCOPY");
+    plb.add_u64_counter(l_msgr_send_zero_copy_copied, "msgr_send_zero_copy_copied", "MSG_ZEROCOPY sends the kernel copied anyway");
+    plb.add_u64_counter(l_msgr_send_compressed_bytes, "msgr_send_compressed_bytes", "Message data bytes sent compressed");
+    plb.add_u64_counter(l_msgr_send_compressed_saved, "msgr_send_compressed_saved", "Bytes saved by compressing message data");
+    plb.add_u64_counter(l_msgr_send_encrypted_messages, "msgr_send_encrypted_messages", "Messages sent encrypted");
+    plb.add_u64_counter(l_msgr_migrated_connections, "msgr_migrated_connections", "Connections moved to this worker by rebalancing");
+
     perf_logger = plb.create_perf_counters();
     cct->get_perfcounters_collection()->add(perf_logger);
   }
@@ -321,6 +339,9 @@ class NetworkStack : public CephContext::ForkWatcher {
   // need to let each thread do binding port.
   virtual bool support_local_listen_table() const { return false; }
   virtual bool nonblock_connect_need_writable_event() const { return true; }
+  // backend need to override this method if a connected socket may be
+  // driven by a different worker than the one that created it
+  virtual bool support_connection_migration() const { return false; }
 
   void start();
   void stop();
@@ -22,6 +22,7 @@
 #include <arpa/inet.h>
 
 #include "net_handler.h"
+#include "include/sock_compat.h"
 #include "common/errno.h"
 #include "common/debug.h"
 
@@ -118,6 +119,17 @@ int NetHandler::set_socket_options(int sd, bool nodelay, int size)
     }
   }
 
+#ifdef SO_BUSY_POLL
+  int busy_poll = cct->_conf->ms_tcp_busy_poll_us;
+  if (busy_poll) {
+    // best effort, raising it past net.core.busy_read needs CAP_NET_ADMIN
+    if (::setsockopt(sd, SOL_SOCKET, SO_BUSY_POLL, (void*)&busy_poll, sizeof(busy_poll)) < 0) {
+      int err = errno;
+      ldout(cct, 0) << "couldn't set SO_BUSY_POLL to " << busy_poll << ": " << cpp_strerror(err) << dendl;
+    }
+  }
+#endif
+
   // block ESIGPIPE
 #ifdef SO_NOSIGPIPE
   int val = 1;
@@ -130,6 +142,22 @@ int NetHandler::set_socket_options(int sd, bool nodelay, int size)
   return -r;
 }
 
+int NetHandler::set_zero_copy(int sd)
+{
+#ifdef SO_ZEROCOPY
+  int val = 1;
+  int r = ::setsockopt(sd, SOL_SOCKET, SO_ZEROCOPY, (void*)&val, sizeof(val));
+  if (r < 0) {
+    r = errno;
+    ldout(cct, 1) << "couldn't set SO_ZEROCOPY: " << cpp_strerror(r) << dendl;
+    return -r;
+  }
+  return 0;
+#else
+  return -EOPNOTSUPP;
+#endif
+}
+
 void NetHandler::set_priority(int sd, int prio, int domain)
 {
 #ifdef SO_PRIORITY
@@ -41,6 +41,8 @@ namespace ceph {
     int reconnect(const entity_addr_t &addr, int sd);
     int nonblock_connect(const entity_addr_t &addr, const entity_addr_t& bind_addr);
     void set_priority(int sd, int priority, int domain);
+    /// enable MSG_ZEROCOPY sends on sd; @return 0 or -errno if unsupported
+    int set_zero_copy(int sd);
   };
 }
 
@@ -98,7 +98,39 @@ Port::Port(CephContext *cct, struct ibv_context* ictxt, uint8_t ipn): ctxt(ictxt
   }
 
   lid = port_attr->lid;
-  r = ibv_query_gid(ctxt, port_num, 0, &gid);
+
+  // without the experimental verbs we can't filter on the GID type, but
+  // a soft-RoCE (rxe) port still needs its IPv4 mapped GID picked out of
+  // the table, so honor ms_async_rdma_local_gid by value.
+  union ibv_gid cgid;
+  gid_idx = 0;
+  r = sscanf(cct->_conf->ms_async_rdma_local_gid.c_str(),
+	     "%02hhx%02hhx:%02hhx%02hhx:%02hhx%02hhx:%02hhx%02hhx"
+	     ":%02hhx%02hhx:%02hhx%02hhx:%02hhx%02hhx:%02hhx%02hhx",
+	     &cgid.raw[ 0], &cgid.raw[ 1],
+	     &cgid.raw[ 2], &cgid.raw[ 3],
+	     &cgid.raw[ 4], &cgid.raw[ 5],
+	     &cgid.raw[ 6], &cgid.raw[ 7],
+	     &cgid.raw[ 8], &cgid.raw[ 9],
+	     &cgid.raw[10], &cgid.raw[11],
+	     &cgid.raw[12], &cgid.raw[13],
+	     &cgid.raw[14], &cgid.raw[15]);
+  if (r == 16) {
+    for (gid_idx = 0; gid_idx < port_attr->gid_tbl_len; gid_idx++) {
+      r = ibv_query_gid(ctxt, port_num, gid_idx, &gid);
+      if (r == 0 && memcmp(&gid, &cgid, 16) == 0) {
+        ldout(cct, 1) << __func__ << " found local GID at index " << gid_idx << dendl;
+        break;
+      }
+    }
+    if (gid_idx == port_attr->gid_tbl_len) {
+      lderr(cct) << __func__ << " Requested local GID was not found in GID table" << dendl;
+      ceph_abort();
+    }
+  } else {
+    ldout(cct, 1) << __func__ << " malformed or no GID supplied, using GID index 0" << dendl;
+  }
+  r = ibv_query_gid(ctxt, port_num, gid_idx, &gid);
   if (r) {
     lderr(cct) << __func__  << " query gid failed  " << cpp_strerror(errno) << dendl;
     ceph_abort();
@@ -482,7 +514,6 @@ Infiniband::MemoryManager::Chunk::Chunk(ibv_mr* m, uint32_t len, char* b)
 
 Infiniband::MemoryManager::Chunk::~Chunk()
 {
-  assert(ibv_dereg_mr(mr) == 0);
 }
 
 void Infiniband::MemoryManager::Chunk::set_offset(uint32_t o)
@@ -568,41 +599,72 @@ Infiniband::MemoryManager::Cluster::Cluster(MemoryManager& m, uint32_t s)
 
 Infiniband::MemoryManager::Cluster::~Cluster()
 {
-  const auto chunk_end = chunk_base + num_chunk;
-  for (auto chunk = chunk_base; chunk != chunk_end; chunk++) {
-    chunk->~Chunk();
-  }
+  unsigned n = num_regions.load();
+  for (unsigned i = 0; i < n; ++i) {
+    Region &r = regions[i];
+    const auto chunk_end = r.chunk_base + r.num_chunk;
+    for (auto chunk = r.chunk_base; chunk != chunk_end; chunk++) {
+      chunk->~Chunk();
+    }
+    assert(ibv_dereg_mr(r.mr) == 0);
 
-  ::free(chunk_base);
-  if (manager.enabled_huge_page)
-    manager.free_huge_pages(base);
-  else
-    ::free(base);
+    ::free(r.chunk_base);
+    if (manager.enabled_huge_page)
+      manager.free_huge_pages(r.base);
+    else
+      ::free(r.base);
+  }
 }
 
+/**
+ * Add a region of num chunks to the cluster. The whole region is
+ * registered with one ibv_reg_mr(), which is much cheaper than one
+ * registration per chunk and keeps the HCA's translation tables small.
+ *
+ * \return
+ *      0 on success, -ENOSPC if the cluster can't take another region,
+ *      or -ENOMEM/-errno if allocating or registering the memory failed.
+ */
 int Infiniband::MemoryManager::Cluster::fill(uint32_t num)
 {
-  assert(!base);
-  num_chunk = num;
-  uint32_t bytes = buffer_size * num;
+  unsigned n = num_regions.load();
+  if (n == MAX_REGIONS)
+    return -ENOSPC;
+  Region &r = regions[n];
+  size_t bytes = (size_t)buffer_size * num;
   if (manager.enabled_huge_page) {
-    base = (char*)manager.malloc_huge_pages(bytes);
+    r.base = (char*)manager.malloc_huge_pages(bytes);
   } else {
-    base = (char*)memalign(CEPH_PAGE_SIZE, bytes);
+    r.base = (char*)memalign(CEPH_PAGE_SIZE, bytes);
   }
-  end = base + bytes;
-  assert(base);
-  chunk_base = static_cast<Chunk*>(::malloc(sizeof(Chunk) * num));
-  memset(chunk_base, 0, sizeof(Chunk) * num);
-  free_chunks.reserve(num);
-  Chunk* chunk = chunk_base;
-  for (uint32_t offset = 0; offset < bytes; offset += buffer_size){
-    ibv_mr* m = ibv_reg_mr(manager.pd->pd, base+offset, buffer_size, IBV_ACCESS_REMOTE_WRITE | IBV_ACCESS_LOCAL_WRITE);
-    assert(m);
-    new(chunk) Chunk(m, buffer_size, base+offset);
-    free_chunks.push_back(chunk);
+  if (!r.base)
+    return -ENOMEM;
+  r.mr = ibv_reg_mr(manager.pd->pd, r.base, bytes, IBV_ACCESS_REMOTE_WRITE | IBV_ACCESS_LOCAL_WRITE);
+  if (!r.mr) {
+    int err = errno;
+    if (manager.enabled_huge_page)
+      manager.free_huge_pages(r.base);
+    else
+      ::free(r.base);
+    r.base = nullptr;
+    return -err;
+  }
+  r.end = r.base + bytes;
+  r.num_chunk = num;
+  r.chunk_base = static_cast<Chunk*>(::malloc(sizeof(Chunk) * num));
+  memset(r.chunk_base, 0, sizeof(Chunk) * num);
+  Chunk* chunk = r.chunk_base;
+  for (size_t offset = 0; offset < bytes; offset += buffer_size) {
+    new(chunk) Chunk(r.mr, buffer_size, r.base+offset);
     chunk++;
   }
+  num_regions.store(n + 1, std::memory_order_release);
+
+  Mutex::Locker l(lock);
+  num_chunk += num;
+  free_chunks.reserve(num_chunk);
+  for (chunk = r.chunk_base; chunk != r.chunk_base + num; chunk++)
+    free_chunks.push_back(chunk);
   return 0;
 }
 
@@ -643,8 +705,8 @@ int Infiniband::MemoryManager::Cluster::get_buffers(std::vector<Chunk*> &chunks,
 }
 
 
-Infiniband::MemoryManager::MemoryManager(Device *d, ProtectionDomain *p, bool hugepage)
-  : device(d), pd(p)
+Infiniband::MemoryManager::MemoryManager(CephContext *c, Device *d, ProtectionDomain *p, bool hugepage)
+  : cct(c), grow_lock("Infiniband::MemoryManager::grow_lock"), device(d), pd(p)
 {
   enabled_huge_page = hugepage;
 }
@@ -687,10 +749,65 @@ void Infiniband::MemoryManager::register_rx_tx(uint32_t size, uint32_t rx_num, u
   assert(device);
   assert(pd);
   channel = new Cluster(*this, size);
-  channel->fill(rx_num);
+  int r = channel->fill(rx_num);
+  assert(r == 0);
 
   send = new Cluster(*this, size);
-  send->fill(tx_num);
+  r = send->fill(tx_num);
+  assert(r == 0);
+  send_grow_num = tx_num;
+}
+
+/**
+ * Whether grow_send_buffers() could still add send buffers.
+ */
+bool Infiniband::MemoryManager::can_grow_send_buffers() const
+{
+  return !send_grow_failed &&
+    get_tx_registered_bytes() + send->buffer_size <=
+      cct->_conf->ms_async_rdma_send_buffers_max_bytes;
+}
+
+/**
+ * Register another batch of send buffers, as long as the registered
+ * send memory stays within ms_async_rdma_send_buffers_max_bytes.
+ * Registering pins and maps a lot of memory at once, so this must not
+ * be called from an event loop; see RDMADispatcher::grow_tx_pool().
+ *
+ * \return
+ *      true if there are free send buffers to retry with.
+ */
+bool Infiniband::MemoryManager::grow_send_buffers()
+{
+  Mutex::Locker l(grow_lock);
+  // someone may have returned or added buffers while we waited
+  if (send->has_free_chunks())
+    return true;
+  if (!can_grow_send_buffers())
+    return false;
+
+  uint64_t max_bytes = cct->_conf->ms_async_rdma_send_buffers_max_bytes;
+  uint64_t cur_bytes = get_tx_registered_bytes();
+  uint32_t num = std::min<uint64_t>(send_grow_num,
+                                    (max_bytes - cur_bytes) / send->buffer_size);
+  int r = send->fill(num);
+  if (r == -ENOSPC) {
+    lderr(cct) << __func__ << " send pool already has the most regions it can hold, "
+               << "not growing it past " << cur_bytes << " bytes" << dendl;
+    send_grow_failed = true;
+    return false;
+  } else if (r < 0) {
+    // ibv_reg_mr() fails with ENOMEM once RLIMIT_MEMLOCK is exhausted
+    lderr(cct) << __func__ << " failed to register " << num << " more send buffers: "
+               << cpp_strerror(r)
+               << (r == -ENOMEM ? ", the memlock limit (ulimit -l) may be too low" : "")
+               << dendl;
+    send_grow_failed = true;
+    return false;
+  }
+  ldout(cct, 1) << __func__ << " registered " << num << " more send buffers, now "
+                << get_tx_registered_bytes() << " bytes" << dendl;
+  return true;
 }
 
 void Infiniband::MemoryManager::return_tx(std::vector<Chunk*> &chunks)
@@ -750,7 +867,7 @@ void Infiniband::init()
   ldout(cct, 1) << __func__ << " device allow " << device->device_attr->max_cqe
                 << " completion entries" << dendl;
 
-  memory_manager = new MemoryManager(device, pd,
+  memory_manager = new MemoryManager(cct, device, pd,
                                      cct->_conf->ms_async_rdma_enable_hugepage);
   memory_manager->register_rx_tx(
       cct->_conf->ms_async_rdma_buffer_size, max_recv_wr, max_send_wr);
@@ -829,22 +946,44 @@ Infiniband::QueuePair* Infiniband::create_queue_pair(CephContext *cct, Completio
 
 int Infiniband::post_chunk(Chunk* chunk)
 {
-  ibv_sge isge;
-  isge.addr = reinterpret_cast<uint64_t>(chunk->buffer);
-  isge.length = chunk->bytes;
-  isge.lkey = chunk->mr->lkey;
-  ibv_recv_wr rx_work_request;
-
-  memset(&rx_work_request, 0, sizeof(rx_work_request));
-  rx_work_request.wr_id = reinterpret_cast<uint64_t>(chunk);// stash descriptor ptr
-  rx_work_request.next = NULL;
-  rx_work_request.sg_list = &isge;
-  rx_work_request.num_sge = 1;
-
-  ibv_recv_wr *badWorkRequest;
-  int ret = ibv_post_srq_recv(srq, &rx_work_request, &badWorkRequest);
-  if (ret)
-    return -errno;
+  std::vector<Chunk*> chunks(1, chunk);
+  return post_chunks(chunks);
+}
+
+/**
+ * Give receive buffers back to the shared receive queue. The work
+ * requests are chained so each batch costs a single doorbell.
+ *
+ * \return
+ *      0 on success, -errno if a batch failed to post.
+ */
+int Infiniband::post_chunks(std::vector<Chunk*> &chunks)
+{
+  static const unsigned SRQ_POST_BATCH = 32;
+  ibv_sge isge[SRQ_POST_BATCH];
+  ibv_recv_wr rx_work_request[SRQ_POST_BATCH];
+
+  size_t i = 0;
+  while (i < chunks.size()) {
+    unsigned n = std::min<size_t>(SRQ_POST_BATCH, chunks.size() - i);
+    memset(rx_work_request, 0, sizeof(rx_work_request[0]) * n);
+    for (unsigned j = 0; j < n; ++j, ++i) {
+      Chunk *chunk = chunks[i];
+      isge[j].addr = reinterpret_cast<uint64_t>(chunk->buffer);
+      isge[j].length = chunk->bytes;
+      isge[j].lkey = chunk->mr->lkey;
+
+      rx_work_request[j].wr_id = reinterpret_cast<uint64_t>(chunk);// stash descriptor ptr
+      rx_work_request[j].next = j + 1 < n ? &rx_work_request[j + 1] : NULL;
+      rx_work_request[j].sg_list = &isge[j];
+      rx_work_request[j].num_sge = 1;
+    }
+
+    ibv_recv_wr *badWorkRequest;
+    int ret = ibv_post_srq_recv(srq, rx_work_request, &badWorkRequest);
+    if (ret)
+      return -ret;
+  }
   return 0;
 }
 
@@ -853,10 +992,8 @@ int Infiniband::post_channel_cluster()
   vector<Chunk*> free_chunks;
   int r = memory_manager->get_channel_buffers(free_chunks, 0);
   assert(r > 0);
-  for (vector<Chunk*>::iterator iter = free_chunks.begin(); iter != free_chunks.end(); ++iter) {
-    r = post_chunk(*iter);
-    assert(r == 0);
-  }
+  r = post_chunks(free_chunks);
+  assert(r == 0);
   return 0;
 }
 
@@ -17,6 +17,7 @@
 #ifndef CEPH_INFINIBAND_H
 #define CEPH_INFINIBAND_H
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -155,7 +156,7 @@ class Infiniband {
       void post_srq(Infiniband *ib);
 
      public:
-      ibv_mr* mr;
+      ibv_mr* mr;  // shared by all chunks of a region
       uint32_t bytes;
       uint32_t bound;
       uint32_t offset;
@@ -171,25 +172,51 @@ class Infiniband {
       void take_back(std::vector<Chunk*> &ck);
       int get_buffers(std::vector<Chunk*> &chunks, size_t bytes);
       Chunk *get_chunk_by_buffer(const char *c) {
-        uint32_t idx = (c - base) / buffer_size;
-        Chunk *chunk = chunk_base + idx;
-        return chunk;
+        const Region *r = find_region(c);
+        assert(r);
+        uint32_t idx = (c - r->base) / buffer_size;
+        return r->chunk_base + idx;
       }
       bool is_my_buffer(const char *c) const {
-        return c >= base && c < end;
+        return find_region(c) != nullptr;
+      }
+      bool has_free_chunks() {
+        Mutex::Locker l(lock);
+        return !free_chunks.empty();
       }
 
       MemoryManager& manager;
       uint32_t buffer_size;
-      uint32_t num_chunk;
+      std::atomic<uint32_t> num_chunk = {0};
       Mutex lock;
       std::vector<Chunk*> free_chunks;
-      char *base = nullptr;
-      char *end = nullptr;
-      Chunk* chunk_base = nullptr;
+
+     private:
+      // every fill() adds a region registered as a single memory region.
+      // regions are never moved or freed before the cluster, so lookups
+      // only need to see the published region count.
+      struct Region {
+        char *base = nullptr;
+        char *end = nullptr;
+        Chunk *chunk_base = nullptr;
+        uint32_t num_chunk = 0;
+        ibv_mr *mr = nullptr;
+      };
+      static const unsigned MAX_REGIONS = 64;
+      Region regions[MAX_REGIONS];
+      std::atomic<unsigned> num_regions = {0};
+
+      const Region *find_region(const char *c) const {
+        unsigned n = num_regions.load(std::memory_order_acquire);
+        for (unsigned i = 0; i < n; ++i) {
+          if (c >= regions[i].base && c < regions[i].end)
+            return &regions[i];
+        }
+        return nullptr;
+      }
     };
 
-    MemoryManager(Device *d, ProtectionDomain *p, bool hugepage);
+    MemoryManager(CephContext *c, Device *d, ProtectionDomain *p, bool hugepage);
     ~MemoryManager();
 
     void* malloc_huge_pages(size_t size);
@@ -198,6 +225,8 @@ class Infiniband {
     void return_tx(std::vector<Chunk*> &chunks);
     int get_send_buffers(std::vector<Chunk*> &c, size_t bytes);
     int get_channel_buffers(std::vector<Chunk*> &chunks, size_t bytes);
+    bool can_grow_send_buffers() const;
+    bool grow_send_buffers();
     bool is_tx_buffer(const char* c) { return send->is_my_buffer(c); }
     bool is_rx_buffer(const char* c) { return channel->is_my_buffer(c); }
     Chunk *get_tx_chunk_by_buffer(const char *c) {
@@ -206,12 +235,19 @@ class Infiniband {
     uint32_t get_tx_buffer_size() const {
       return send->buffer_size;
     }
+    uint64_t get_tx_registered_bytes() const {
+      return (uint64_t)send->num_chunk * send->buffer_size;
+    }
 
     bool enabled_huge_page;
 
    private:
-    Cluster* channel;//RECV
-    Cluster* send;// SEND
+    CephContext *cct;
+    Cluster* channel = nullptr;//RECV
+    Cluster* send = nullptr;// SEND
+    Mutex grow_lock;  // serializes growing `send`
+    uint32_t send_grow_num = 0;
+    std::atomic<bool> send_grow_failed = {false};
     Device *device;
     ProtectionDomain *pd;
   };
@@ -362,6 +398,7 @@ class Infiniband {
   QueuePair* create_queue_pair(CephContext *c, CompletionQueue*, CompletionQueue*, ibv_qp_type type);
   ibv_srq* create_shared_receive_queue(uint32_t max_wr, uint32_t max_sge);
   int post_chunk(Chunk* chunk);
+  int post_chunks(std::vector<Chunk*> &chunks);
   int post_channel_cluster();
   int get_tx_buffers(std::vector<Chunk*> &c, size_t bytes);
   CompletionChannel *create_comp_channel(CephContext *c);
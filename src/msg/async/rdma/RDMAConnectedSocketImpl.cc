@@ -51,17 +51,23 @@ RDMAConnectedSocketImpl::~RDMAConnectedSocketImpl()
   if (tcp_fd >= 0)
     ::close(tcp_fd);
   error = ECONNRESET;
-  int ret = 0;
-  for (unsigned i=0; i < wc.size(); ++i) {
-    ret = infiniband->post_chunk(reinterpret_cast<Chunk*>(wc[i].wr_id));
-    assert(ret == 0);
-    dispatcher->perf_logger->dec(l_msgr_rdma_inqueue_rx_chunks);
-  }
-  for (unsigned i=0; i < buffers.size(); ++i) {
-    ret = infiniband->post_chunk(buffers[i]);
-    assert(ret == 0);
-    dispatcher->perf_logger->dec(l_msgr_rdma_inqueue_rx_chunks);
-  }
+  for (unsigned i=0; i < wc.size(); ++i)
+    buffers.push_back(reinterpret_cast<Chunk*>(wc[i].wr_id));
+  post_rx_chunks(buffers);
+}
+
+/**
+ * Hand consumed receive chunks back to the shared receive queue in one
+ * batch and clear the vector.
+ */
+void RDMAConnectedSocketImpl::post_rx_chunks(std::vector<Chunk*> &chunks)
+{
+  if (chunks.empty())
+    return;
+  int ret = infiniband->post_chunks(chunks);
+  assert(ret == 0);
+  dispatcher->perf_logger->dec(l_msgr_rdma_inqueue_rx_chunks, chunks.size());
+  chunks.clear();
 }
 
 void RDMAConnectedSocketImpl::pass_wc(std::vector<ibv_wc> &&v)
@@ -259,13 +265,16 @@ ssize_t RDMAConnectedSocketImpl::read(char* buf, size_t len)
   if (error)
     return -error;
   ssize_t read = 0;
+  std::vector<Chunk*> done;
   if (!buffers.empty())
-    read = read_buffers(buf,len);
+    read = read_buffers(buf, len, done);
 
   std::vector<ibv_wc> cqe;
   get_wc(cqe);
-  if (cqe.empty())
+  if (cqe.empty()) {
+    post_rx_chunks(done);
     return read == 0 ? -EAGAIN : read;
+  }
 
   ldout(cct, 20) << __func__ << " poll queue got " << cqe.size() << " responses. QP: " << my_msg.qpn << dendl;
   for (size_t i = 0; i < cqe.size(); ++i) {
@@ -281,8 +290,7 @@ ssize_t RDMAConnectedSocketImpl::read(char* buf, size_t len)
         error = ECONNRESET;
         ldout(cct, 20) << __func__ << " got remote close msg..." << dendl;
       }
-      assert(infiniband->post_chunk(chunk) == 0);
-      dispatcher->perf_logger->dec(l_msgr_rdma_inqueue_rx_chunks);
+      done.push_back(chunk);
     } else {
       if (read == (ssize_t)len) {
         buffers.push_back(chunk);
@@ -293,11 +301,11 @@ ssize_t RDMAConnectedSocketImpl::read(char* buf, size_t len)
         ldout(cct, 25) << __func__ << " buffers add a chunk: " << chunk->get_offset() << ":" << chunk->get_bound() << dendl;
       } else {
         read += chunk->read(buf+read, response->byte_len);
-        assert(infiniband->post_chunk(chunk) == 0);
-        dispatcher->perf_logger->dec(l_msgr_rdma_inqueue_rx_chunks);
+        done.push_back(chunk);
       }
     }
   }
+  post_rx_chunks(done);
 
   worker->perf_logger->inc(l_msgr_rdma_rx_chunks, cqe.size());
   if (is_server && connected == 0) {
@@ -312,7 +320,7 @@ ssize_t RDMAConnectedSocketImpl::read(char* buf, size_t len)
   return read == 0 ? -EAGAIN : read;
 }
 
-ssize_t RDMAConnectedSocketImpl::read_buffers(char* buf, size_t len)
+ssize_t RDMAConnectedSocketImpl::read_buffers(char* buf, size_t len, std::vector<Chunk*> &done)
 {
   size_t read = 0, tmp = 0;
   auto c = buffers.begin();
@@ -321,8 +329,7 @@ ssize_t RDMAConnectedSocketImpl::read_buffers(char* buf, size_t len)
     read += tmp;
     ldout(cct, 25) << __func__ << " this iter read: " << tmp << " bytes." << " offset: " << (*c)->get_offset() << " ,bound: " << (*c)->get_bound()  << ". Chunk:" << *c  << dendl;
     if ((*c)->over()) {
-      assert(infiniband->post_chunk(*c) == 0);
-      dispatcher->perf_logger->dec(l_msgr_rdma_inqueue_rx_chunks);
+      done.push_back(*c);
       ldout(cct, 25) << __func__ << " one chunk over." << dendl;
     }
     if (read == len) {
@@ -53,13 +53,16 @@ RDMADispatcher::~RDMADispatcher()
 
 RDMADispatcher::RDMADispatcher(CephContext* c, RDMAStack* s)
   : cct(c), async_handler(new C_handle_cq_async(this)), lock("RDMADispatcher::lock"),
-  w_lock("RDMADispatcher::for worker pending list"), stack(s)
+  w_lock("RDMADispatcher::for worker pending list"), stack(s),
+  tx_grow_thread(this), tx_grow_lock("RDMADispatcher::tx_grow_lock")
 {
   PerfCountersBuilder plb(cct, "AsyncMessenger::RDMADispatcher", l_msgr_rdma_dispatcher_first, l_msgr_rdma_dispatcher_last);
 
   plb.add_u64_counter(l_msgr_rdma_polling, "polling", "Whether dispatcher thread is polling");
   plb.add_u64_counter(l_msgr_rdma_inflight_tx_chunks, "inflight_tx_chunks", "The number of inflight tx chunks");
   plb.add_u64_counter(l_msgr_rdma_inqueue_rx_chunks, "inqueue_rx_chunks", "The number of inqueue rx chunks");
+  plb.add_u64(l_msgr_rdma_tx_registered_bytes, "tx_registered_bytes", "The bytes of registered tx memory");
+  plb.add_u64_counter(l_msgr_rdma_tx_pool_grow, "tx_pool_grow", "The count of tx buffer pool growth");
 
   plb.add_u64_counter(l_msgr_rdma_tx_total_wc, "tx_total_wc", "The number of tx work comletions");
   plb.add_u64_counter(l_msgr_rdma_tx_total_wc_errors, "tx_total_wc_errors", "The number of tx errors");
@@ -95,12 +98,20 @@ void RDMADispatcher::polling_start()
   assert(rx_cq);
 
   t = std::thread(&RDMADispatcher::polling, this);
+  tx_grow_thread.create("ms_rdma_grow");
 }
 
 void RDMADispatcher::polling_stop()
 {
   if (t.joinable())
     t.join();
+  if (tx_grow_thread.is_started()) {
+    tx_grow_lock.Lock();
+    tx_grow_stop = true;
+    tx_grow_cond.Signal();
+    tx_grow_lock.Unlock();
+    tx_grow_thread.join();
+  }
 }
 
 void RDMADispatcher::handle_async_event()
@@ -146,6 +157,7 @@ void RDMADispatcher::polling()
   ibv_wc wc[MAX_COMPLETIONS];
 
   std::map<RDMAConnectedSocketImpl*, std::vector<ibv_wc> > polled;
+  std::vector<Chunk*> orphaned;
   std::vector<ibv_wc> tx_cqe;
   ldout(cct, 20) << __func__ << " going to poll tx cq: " << tx_cq << " rx cq: " << rx_cq << dendl;
   RDMAConnectedSocketImpl *conn = nullptr;
@@ -179,9 +191,8 @@ void RDMADispatcher::polling()
           conn = get_conn_lockless(response->qp_num);
           if (!conn) {
             assert(global_infiniband->is_rx_buffer(chunk->buffer));
-            r = global_infiniband->post_chunk(chunk);
-            ldout(cct, 1) << __func__ << " csi with qpn " << response->qp_num << " may be dead. chunk " << chunk << " will be back ? " << r << dendl;
-            assert(r == 0);
+            ldout(cct, 1) << __func__ << " csi with qpn " << response->qp_num << " may be dead. chunk " << chunk << " will be back" << dendl;
+            orphaned.push_back(chunk);
           } else {
             polled[conn].push_back(*response);
           }
@@ -191,11 +202,7 @@ void RDMADispatcher::polling()
               << ") status(" << response->status << ":"
               << global_infiniband->wc_status_to_string(response->status) << ")" << dendl;
           assert(global_infiniband->is_rx_buffer(chunk->buffer));
-          r = global_infiniband->post_chunk(chunk);
-          if (r) {
-            ldout(cct, 0) << __func__ << " post chunk failed, error: " << cpp_strerror(r) << dendl;
-            assert(r == 0);
-          }
+          orphaned.push_back(chunk);
 
           conn = get_conn_lockless(response->qp_num);
           if (conn && conn->is_connected())
@@ -208,6 +215,15 @@ void RDMADispatcher::polling()
         i.first->pass_wc(std::move(i.second));
       }
       polled.clear();
+
+      if (!orphaned.empty()) {
+        r = global_infiniband->post_chunks(orphaned);
+        if (r) {
+          ldout(cct, 0) << __func__ << " post chunk failed, error: " << cpp_strerror(r) << dendl;
+          assert(r == 0);
+        }
+        orphaned.clear();
+      }
     }
 
     if (!tx_ret && !rx_ret) {
@@ -217,6 +233,8 @@ void RDMADispatcher::polling()
       // Additionally, don't delete qp while outstanding_buffers isn't empty,
       // because we need to check qp's state before sending
       perf_logger->set(l_msgr_rdma_inflight_tx_chunks, inflight);
+      perf_logger->set(l_msgr_rdma_tx_registered_bytes,
+                       global_infiniband->get_memory_manager()->get_tx_registered_bytes());
       if (num_dead_queue_pair) {
         Mutex::Locker l(lock); // FIXME reuse dead qp because creating one qp costs 1 ms
         while (!dead_queue_pairs.empty()) {
@@ -286,6 +304,48 @@ void RDMADispatcher::notify_pending_workers() {
   }
 }
 
+/**
+ * Ask the grow thread to register more send buffers. Callers put
+ * themselves on the pending list first, so they can't miss the wakeup
+ * once the buffers are there.
+ */
+void RDMADispatcher::grow_tx_pool()
+{
+  Mutex::Locker l(tx_grow_lock);
+  if (!tx_grow_wanted) {
+    tx_grow_wanted = true;
+    tx_grow_cond.Signal();
+  }
+}
+
+void RDMADispatcher::tx_grow_entry()
+{
+  ldout(cct, 10) << __func__ << " start" << dendl;
+  Infiniband::MemoryManager *mm = global_infiniband->get_memory_manager();
+  tx_grow_lock.Lock();
+  while (!tx_grow_stop) {
+    if (!tx_grow_wanted) {
+      tx_grow_cond.Wait(tx_grow_lock);
+      continue;
+    }
+    // a request made while we register gets another pass, which returns
+    // right away if the buffers are already there
+    tx_grow_wanted = false;
+    tx_grow_lock.Unlock();
+
+    uint64_t registered = mm->get_tx_registered_bytes();
+    bool ready = mm->grow_send_buffers();
+    if (mm->get_tx_registered_bytes() != registered)
+      perf_logger->inc(l_msgr_rdma_tx_pool_grow);
+    if (ready)
+      notify_pending_workers();
+
+    tx_grow_lock.Lock();
+  }
+  tx_grow_lock.Unlock();
+  ldout(cct, 10) << __func__ << " done" << dendl;
+}
+
 int RDMADispatcher::register_qp(QueuePair *qp, RDMAConnectedSocketImpl* csi)
 {
   int fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
@@ -474,7 +534,7 @@ int RDMAWorker::get_reged_mem(RDMAConnectedSocketImpl *o, std::vector<Chunk*> &c
   size_t got = global_infiniband->get_memory_manager()->get_tx_buffer_size() * r;
   ldout(cct, 30) << __func__ << " need " << bytes << " bytes, reserve " << got << " registered  bytes, inflight " << dispatcher->inflight << dendl;
   stack->get_dispatcher()->inflight += r;
-  if (got == bytes)
+  if (got >= bytes)
     return r;
 
   if (o) {
@@ -482,6 +542,8 @@ int RDMAWorker::get_reged_mem(RDMAConnectedSocketImpl *o, std::vector<Chunk*> &c
       pending_sent_conns.push_back(o);
     dispatcher->make_pending_worker(this);
   }
+  if (global_infiniband->get_memory_manager()->can_grow_send_buffers())
+    dispatcher->grow_tx_pool();
   return r;
 }
 
@@ -26,6 +26,8 @@
 #include "common/ceph_context.h"
 #include "common/debug.h"
 #include "common/errno.h"
+#include "common/Cond.h"
+#include "common/Thread.h"
 #include "msg/async/Stack.h"
 #include "Infiniband.h"
 
@@ -40,6 +42,8 @@ enum {
   l_msgr_rdma_polling,
   l_msgr_rdma_inflight_tx_chunks,
   l_msgr_rdma_inqueue_rx_chunks,
+  l_msgr_rdma_tx_registered_bytes,
+  l_msgr_rdma_tx_pool_grow,
 
   l_msgr_rdma_tx_total_wc,
   l_msgr_rdma_tx_total_wc_errors,
@@ -104,6 +108,26 @@ class RDMADispatcher {
   std::list<RDMAWorker*> pending_workers;
   RDMAStack* stack;
 
+  /**
+   * Registers more send buffers when the workers run out, so that the
+   * event loops never block on ibv_reg_mr().
+   */
+  class TxGrowThread : public Thread {
+    RDMADispatcher *dispatcher;
+   public:
+    explicit TxGrowThread(RDMADispatcher *d) : dispatcher(d) {}
+    void *entry() override {
+      dispatcher->tx_grow_entry();
+      return 0;
+    }
+  } tx_grow_thread;
+  Mutex tx_grow_lock; // protect `tx_grow_wanted`, `tx_grow_stop`
+  Cond tx_grow_cond;
+  bool tx_grow_wanted = false;
+  bool tx_grow_stop = false;
+
+  void tx_grow_entry();
+
   class C_handle_cq_async : public EventCallback {
     RDMADispatcher *dispatcher;
    public:
@@ -139,6 +163,7 @@ class RDMADispatcher {
   Infiniband::CompletionQueue* get_tx_cq() const { return tx_cq; }
   Infiniband::CompletionQueue* get_rx_cq() const { return rx_cq; }
   void notify_pending_workers();
+  void grow_tx_pool();
   void handle_tx_event(ibv_wc *cqe, int n);
   void post_tx_buffer(std::vector<Chunk*> &chunks);
 
@@ -231,7 +256,8 @@ class RDMAConnectedSocketImpl : public ConnectedSocketImpl {
   bool active;// qp is active ?
 
   void notify();
-  ssize_t read_buffers(char* buf, size_t len);
+  ssize_t read_buffers(char* buf, size_t len, std::vector<Chunk*> &done);
+  void post_rx_chunks(std::vector<Chunk*> &chunks);
   int post_work_request(std::vector<Chunk*>&);
 
  public:
@@ -118,7 +118,7 @@ public:
 
   static void generate_test_instances(list<entity_name_t*>& o);
 };
-WRITE_CLASS_DENC(entity_name_t)
+WRITE_CLASS_DENC_BOUNDED(entity_name_t)
 
 inline bool operator== (const entity_name_t& l, const entity_name_t& r) { 
   return (l.type() == r.type()) && (l.num() == r.num()); }
@@ -1715,6 +1715,38 @@ public:
      return read(c->get_cid(), oid, offset, len, bl, op_flags, allow_eio);
    }
 
+  /**
+   * read_digest -- crc32c a byte range of data from an object
+   *
+   * Equivalent to read() followed by bufferlist::crc32c(*crc), but a
+   * store that keeps its own crc32c checksums may verify the data
+   * against them and compose the result from them instead of hashing
+   * the data a second time.
+   *
+   * @param c collection for object
+   * @param oid oid of object
+   * @param offset location offset of first byte to be read
+   * @param len number of bytes to be read
+   * @param crc [in,out] crc32c seed, updated with the data read
+   * @param op_flags is CEPH_OSD_OP_FLAG_*
+   * @param allow_eio if false, assert on -EIO operation failure
+   * @returns number of bytes covered on success, or negative error code
+   */
+  virtual int read_digest(
+    CollectionHandle &c,
+    const ghobject_t& oid,
+    uint64_t offset,
+    size_t len,
+    uint32_t *crc,
+    uint32_t op_flags = 0,
+    bool allow_eio = false) {
+    bufferlist bl;
+    int r = read(c, oid, offset, len, bl, op_flags, allow_eio);
+    if (r >= 0)
+      *crc = bl.crc32c(*crc);
+    return r;
+  }
+
   /**
    * fiemap -- get extent map of data of an object
    *
@@ -23,6 +23,7 @@
 #include "os/kv.h"
 #include "include/compat.h"
 #include "include/intarith.h"
+#include "include/crc32c.h"
 #include "include/stringify.h"
 #include "common/errno.h"
 #include "common/safe_io.h"
@@ -6393,6 +6394,156 @@ int BlueStore::_do_read(
   return r;
 }
 
+int BlueStore::read_digest(
+  CollectionHandle &c_,
+  const ghobject_t& oid,
+  uint64_t offset,
+  size_t length,
+  uint32_t *crc,
+  uint32_t op_flags,
+  bool allow_eio)
+{
+  utime_t start = ceph_clock_now();
+  Collection *c = static_cast<Collection *>(c_.get());
+  const coll_t &cid = c->get_cid();
+  dout(15) << __func__ << " " << cid << " " << oid
+	   << " 0x" << std::hex << offset << "~" << length << std::dec
+	   << dendl;
+  if (!c->exists)
+    return -ENOENT;
+
+  int r;
+  {
+    RWLock::RLocker l(c->lock);
+    OnodeRef o = c->get_onode(oid, false);
+    if (!o || !o->exists) {
+      r = -ENOENT;
+      goto out;
+    }
+    r = _do_read_digest(c, o, offset, length, crc, op_flags);
+  }
+
+ out:
+  assert(allow_eio || r != -EIO);
+  if (r >= 0 && _debug_data_eio(oid)) {
+    r = -EIO;
+    derr << __func__ << " " << c->cid << " " << oid << " INJECT EIO" << dendl;
+  }
+  dout(10) << __func__ << " " << cid << " " << oid
+	   << " 0x" << std::hex << offset << "~" << length << std::dec
+	   << " = " << r << dendl;
+  logger->tinc(l_bluestore_read_lat, ceph_clock_now() - start);
+  return r;
+}
+
+/*
+ * Like _do_read() + crc32c, but for whole crc32c csum chunks of
+ * uncompressed blobs we fold in the stored csum instead of hashing the
+ * data again; verifying the csum already touched every byte.  crc32c
+ * is linear, so for a chunk B of length n and csum seed -1
+ *
+ *   crc(s, B) = crc(s, 0^n) ^ crc(-1, 0^n) ^ crc(-1, B)
+ *
+ * Anything cached (possibly not yet on disk), compressed, or without
+ * crc32c csums goes through _do_read().
+ */
+int BlueStore::_do_read_digest(
+  Collection *c,
+  OnodeRef o,
+  uint64_t offset,
+  size_t length,
+  uint32_t *crc,
+  uint32_t op_flags)
+{
+  if (offset >= o->onode.size) {
+    return 0;
+  }
+  if (offset + length > o->onode.size) {
+    length = o->onode.size - offset;
+  }
+  o->extent_map.fault_range(db, offset, length);
+
+  uint64_t pos = offset;
+  uint64_t left = length;
+  auto lp = o->extent_map.seek_lextent(offset);
+  while (left > 0) {
+    if (lp == o->extent_map.extent_map.end() || pos < lp->logical_offset) {
+      uint64_t hole = left;
+      if (lp != o->extent_map.extent_map.end()) {
+	hole = std::min<uint64_t>(hole, lp->logical_offset - pos);
+      }
+      *crc = ceph_crc32c(*crc, NULL, hole);
+      pos += hole;
+      left -= hole;
+      continue;
+    }
+    BlobRef bptr = lp->blob;
+    const bluestore_blob_t& blob = bptr->get_blob();
+    uint64_t b_off = pos - lp->logical_offset + lp->blob_offset;
+    uint64_t b_len = std::min<uint64_t>(left,
+					lp->logical_end() - pos);
+
+    bool use_csum = !blob.is_compressed() &&
+      blob.csum_type == Checksummer::CSUM_CRC32C;
+    if (use_csum) {
+      ready_regions_t cache_res;
+      interval_set<uint32_t> cache_interval;
+      bptr->shared_blob->bc.read(
+	bptr->shared_blob->get_cache(), b_off, b_len, cache_res,
+	cache_interval);
+      use_csum = cache_interval.empty();
+    }
+
+    if (!use_csum) {
+      bufferlist bl;
+      int r = _do_read(c, o, pos, b_len, bl, op_flags);
+      if (r < 0) {
+	return r;
+      }
+      *crc = bl.crc32c(*crc);
+    } else {
+      uint64_t chunk_size = blob.get_csum_chunk_size();
+      uint64_t read_align = blob.get_chunk_size(block_size);
+      uint64_t r_off = P2ALIGN(b_off, read_align);
+      uint64_t r_len = P2ROUNDUP(b_off + b_len, read_align) - r_off;
+      bufferlist bl;
+      IOContext ioc(cct, NULL);
+      int r = blob.map(
+	r_off, r_len,
+	[&](uint64_t offset, uint64_t length) {
+	  return bdev->read(offset, length, &bl, &ioc, false);
+	});
+      if (r < 0) {
+	return r;
+      }
+      assert(bl.length() == r_len);
+      if (_verify_csum(o, &blob, r_off, bl,
+		       pos - (b_off - r_off)) < 0) {
+	return -EIO;
+      }
+      uint64_t x = b_off;
+      uint64_t end = b_off + b_len;
+      while (x < end) {
+	uint64_t l = std::min(end, P2ALIGN(x, chunk_size) + chunk_size) - x;
+	if (l == chunk_size) {
+	  uint32_t stored = blob.get_csum_item(x / chunk_size);
+	  *crc = ceph_crc32c(*crc, NULL, l) ^
+	    ceph_crc32c(-1, NULL, l) ^ stored;
+	} else {
+	  bufferlist part;
+	  part.substr_of(bl, x - r_off, l);
+	  *crc = part.crc32c(*crc);
+	}
+	x += l;
+      }
+    }
+    pos += b_len;
+    left -= b_len;
+    ++lp;
+  }
+  return length;
+}
+
 int BlueStore::_verify_csum(OnodeRef& o,
 			    const bluestore_blob_t* blob, uint64_t blob_xoffset,
 			    const bufferlist& bl,
@@ -2204,6 +2204,21 @@ public:
     size_t len,
     bufferlist& bl,
     uint32_t op_flags = 0);
+  int read_digest(
+    CollectionHandle &c,
+    const ghobject_t& oid,
+    uint64_t offset,
+    size_t len,
+    uint32_t *crc,
+    uint32_t op_flags = 0,
+    bool allow_eio = false) override;
+  int _do_read_digest(
+    Collection *c,
+    OnodeRef o,
+    uint64_t offset,
+    size_t len,
+    uint32_t *crc,
+    uint32_t op_flags = 0);
 
 private:
   int _fiemap(CollectionHandle &c_, const ghobject_t& oid,
@@ -117,7 +117,8 @@ ostream &operator<<(ostream &lhs, const ECBackend::ReadOp &rhs)
 	     << ", priority=" << rhs.priority
 	     << ", obj_to_source=" << rhs.obj_to_source
 	     << ", source_to_obj=" << rhs.source_to_obj
-	     << ", in_progress=" << rhs.in_progress << ")";
+	     << ", in_progress=" << rhs.in_progress
+	     << (rhs.hedged ? ", hedged" : "") << ")";
 }
 
 void ECBackend::ReadOp::dump(Formatter *f) const
@@ -132,6 +133,7 @@ void ECBackend::ReadOp::dump(Formatter *f) const
   f->dump_stream("obj_to_source") << obj_to_source;
   f->dump_stream("source_to_obj") << source_to_obj;
   f->dump_stream("in_progress") << in_progress;
+  f->dump_bool("hedged", hedged);
 }
 
 ostream &operator<<(ostream &lhs, const ECBackend::Op &rhs)
@@ -1123,6 +1125,14 @@ void ECBackend::handle_sub_read_reply(
     return;
   }
   ReadOp &rop = iter->second;
+  if (!rop.for_recovery) {
+    map<pg_shard_t, utime_t>::iterator sent = rop.sent_stamp.find(from);
+    if (sent != rop.sent_stamp.end()) {
+      utime_t latency = ceph_clock_now() - sent->second;
+      shard_latency[from].add(latency);
+      get_parent()->get_logger()->tinc(l_osd_ec_sub_read_lat, latency);
+    }
+  }
   for (auto i = op.buffers_read.begin();
        i != op.buffers_read.end();
        ++i) {
@@ -1181,10 +1191,12 @@ void ECBackend::handle_sub_read_reply(
   assert(rop.in_progress.count(from));
   rop.in_progress.erase(from);
   unsigned is_complete = 0;
-  // For redundant reads check for completion as each shard comes in,
-  // or in a non-recovery read check for completion once all the shards read.
+  // For redundant or hedged reads check for completion as each shard
+  // comes in, or in a non-recovery read check for completion once all
+  // the shards read.
   // TODO: It would be nice if recovery could send more reads too
-  if (rop.do_redundant_reads || (!rop.for_recovery && rop.in_progress.empty())) {
+  if (rop.do_redundant_reads || rop.hedged ||
+      (!rop.for_recovery && rop.in_progress.empty())) {
     for (map<hobject_t, read_result_t>::const_iterator iter =
         rop.complete.begin();
       iter != rop.complete.end();
@@ -1266,6 +1278,23 @@ void ECBackend::complete_read_op(ReadOp &rop, RecoveryMessages *m)
       reqiter->second.cb = NULL;
     }
   }
+  // redundant and hedged reads complete before all the shards replied,
+  // the late replies are dropped by handle_sub_read_reply.  What we
+  // waited for them so far is a lower bound of their latency.
+  utime_t now = ceph_clock_now();
+  for (set<pg_shard_t>::iterator i = rop.in_progress.begin();
+       i != rop.in_progress.end();
+       ++i) {
+    if (!rop.for_recovery && rop.sent_stamp.count(*i))
+      shard_latency[*i].add(now - rop.sent_stamp[*i]);
+    map<pg_shard_t, set<ceph_tid_t> >::iterator siter =
+      shard_to_read_map.find(*i);
+    if (siter == shard_to_read_map.end())
+      continue;
+    siter->second.erase(rop.tid);
+    if (siter->second.empty())
+      shard_to_read_map.erase(siter);
+  }
   tid_to_read_map.erase(rop.tid);
 }
 
@@ -1627,6 +1656,119 @@ void ECBackend::start_read_op(
     op.trace.event("start ec read");
   }
   do_read_op(op);
+  if (!for_recovery && !do_redundant_reads &&
+      cct->_conf->osd_read_ec_hedge)
+    schedule_read_hedge(op);
+}
+
+const unsigned ECBackend::shard_latency_t::min_samples;
+const unsigned ECBackend::shard_latency_t::max_samples;
+
+double ECBackend::shard_latency_t::get_percentile(double p) const
+{
+  if (samples.empty())
+    return 0;
+  if (p != cached_p) {
+    vector<double> sorted(samples);
+    unsigned n = std::min<unsigned>(sorted.size() - 1,
+				    p * sorted.size() / 100);
+    std::nth_element(sorted.begin(), sorted.begin() + n, sorted.end());
+    cached_percentile = sorted[n];
+    cached_p = p;
+  }
+  return cached_percentile;
+}
+
+void ECBackend::schedule_read_hedge(ReadOp &rop)
+{
+  // wait for the slowest of the shards we know enough about
+  double delay = 0;
+  for (set<pg_shard_t>::iterator i = rop.in_progress.begin();
+       i != rop.in_progress.end();
+       ++i) {
+    map<pg_shard_t, shard_latency_t>::iterator j = shard_latency.find(*i);
+    if (j == shard_latency.end() ||
+	j->second.samples.size() < shard_latency_t::min_samples)
+      continue;
+    delay = std::max(
+      delay,
+      j->second.get_percentile(cct->_conf->osd_read_ec_hedge_percentile));
+  }
+  if (delay == 0) {
+    dout(20) << __func__ << " tid " << rop.tid
+	     << " not enough latency samples" << dendl;
+    return;
+  }
+  delay = std::max(delay, cct->_conf->osd_read_ec_hedge_min_delay);
+  dout(20) << __func__ << " tid " << rop.tid << " in " << delay << "s" << dendl;
+  ceph_tid_t tid = rop.tid;
+  get_parent()->schedule_read_hedge(
+    delay,
+    new FunctionContext([this, tid](int r) {
+	hedge_read_op(tid);
+      }));
+}
+
+void ECBackend::hedge_read_op(ceph_tid_t tid)
+{
+  map<ceph_tid_t, ReadOp>::iterator iter = tid_to_read_map.find(tid);
+  if (iter == tid_to_read_map.end()) {
+    dout(20) << __func__ << " tid " << tid << " already complete" << dendl;
+    return;
+  }
+  ReadOp &rop = iter->second;
+  if (rop.hedged || rop.in_progress.empty())
+    return;
+  rop.hedged = true;
+
+  map<hobject_t, read_request_t> hedge_reads;
+  for (map<hobject_t, read_request_t>::iterator i = rop.to_read.begin();
+       i != rop.to_read.end();
+       ++i) {
+    set<int> already_read;
+    unsigned pending = 0;
+    for (auto &&shard : rop.obj_to_source[i->first]) {
+      already_read.insert(shard.shard);
+      if (rop.in_progress.count(shard))
+	++pending;
+    }
+    if (!pending)
+      continue;
+    set<pg_shard_t> remaining;
+    int r = get_remaining_shards(i->first, already_read, &remaining);
+    if (r < 0)
+      continue;
+    // one extra shard for each reply we are still waiting for
+    set<pg_shard_t> extra;
+    for (set<pg_shard_t>::iterator j = remaining.begin();
+	 j != remaining.end() && extra.size() < pending;
+	 ++j) {
+      if (!rop.in_progress.count(*j))
+	extra.insert(*j);
+    }
+    if (extra.empty())
+      continue;
+    hedge_reads.insert(
+      make_pair(
+	i->first,
+	read_request_t(
+	  i->second.to_read,
+	  extra,
+	  false,
+	  i->second.cb)));
+  }
+  if (hedge_reads.empty()) {
+    dout(10) << __func__ << " no other shard to read for " << rop << dendl;
+    return;
+  }
+
+  dout(10) << __func__ << " hedging " << rop << " with " << hedge_reads << dendl;
+  get_parent()->get_logger()->inc(l_osd_ec_read_hedged);
+  rop.trace.event("ec read hedged");
+  // only send the extra reads, the callbacks stay with rop.to_read
+  rop.to_read.swap(hedge_reads);
+  do_read_op(rop);
+  rop.to_read.swap(hedge_reads);
 }
 
 void ECBackend::do_read_op(ReadOp &op)
@@ -1670,10 +1812,12 @@ void ECBackend::do_read_op(ReadOp &op)
     }
   }
 
+  utime_t now = ceph_clock_now();
   for (map<pg_shard_t, ECSubRead>::iterator i = messages.begin();
        i != messages.end();
        ++i) {
     op.in_progress.insert(i->first);
+    op.sent_stamp[i->first] = now;
     shard_to_read_map[i->first].insert(op.tid);
     i->second.tid = tid;
     MOSDECSubOpRead *msg = new MOSDECSubOpRead;
@@ -2385,7 +2529,7 @@ void ECBackend::be_deep_scrub(
   uint32_t seed,
   ScrubMap::object &o,
   ThreadPool::TPHandle &handle) {
-  bufferhash h(-1); // we always used -1
+  uint32_t crc = -1; // we always used -1
   int r;
   uint64_t stride = cct->_conf->osd_deep_scrub_stride;
   if (stride % sinfo.get_chunk_size())
@@ -2395,23 +2539,21 @@ void ECBackend::be_deep_scrub(
   uint32_t fadvise_flags = CEPH_OSD_OP_FLAG_FADVISE_SEQUENTIAL | CEPH_OSD_OP_FLAG_FADVISE_DONTNEED;
 
   while (true) {
-    bufferlist bl;
     handle.reset_tp_timeout();
-    r = store->read(
+    r = store->read_digest(
       ch,
       ghobject_t(
 	poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
       pos,
-      stride, bl,
+      stride, &crc,
       fadvise_flags, true);
     if (r < 0)
       break;
-    if (bl.length() % sinfo.get_chunk_size()) {
+    if (r % sinfo.get_chunk_size()) {
       r = -EIO;
       break;
     }
     pos += r;
-    h << bl;
     if ((unsigned)r < stride)
       break;
   }
@@ -2438,7 +2580,7 @@ void ECBackend::be_deep_scrub(
 	return;
       }
 
-      if (hinfo->get_chunk_hash(get_parent()->whoami_shard().shard) != h.digest()) {
+      if (hinfo->get_chunk_hash(get_parent()->whoami_shard().shard) != crc) {
 	dout(0) << "_scan_list  " << poid << " got incorrect hash on read" << dendl;
 	o.ec_hash_mismatch = true;
 	return;
@@ -378,6 +378,9 @@ public:
     // True if reading for recovery which could possibly reading only a subset
     // of the available shards.
     bool for_recovery;
+    // True once extra shards were requested because the first ones
+    // were slower than expected, @see hedge_read_op
+    bool hedged = false;
 
     ZTracer::Trace trace;
 
@@ -386,6 +389,7 @@ public:
 
     map<hobject_t, set<pg_shard_t>> obj_to_source;
     map<pg_shard_t, set<hobject_t> > source_to_obj;
+    map<pg_shard_t, utime_t> sent_stamp;
 
     void dump(Formatter *f) const;
 
@@ -434,6 +438,41 @@ public:
     const hobject_t &hoid,
     ReadOp &rop);
 
+  /**
+   * Hedged client reads
+   *
+   * Client reads only ask the shards needed to decode.  The latency
+   * of the replies of each shard is tracked in shard_latency and, if
+   * osd_read_ec_hedge is set, a client read which did not complete
+   * within the osd_read_ec_hedge_percentile latency of the slowest
+   * shard it reads from asks as many other shards as are still
+   * missing.  The read completes with the first shards allowing to
+   * decode, later replies are dropped.
+   */
+  struct shard_latency_t {
+    static const unsigned min_samples = 8;
+    static const unsigned max_samples = 32;
+    vector<double> samples;
+    unsigned next = 0;
+    mutable double cached_percentile = 0;
+    mutable double cached_p = -1;
+
+    void add(double latency) {
+      if (samples.size() < max_samples) {
+	samples.push_back(latency);
+      } else {
+	samples[next] = latency;
+	next = (next + 1) % max_samples;
+      }
+      cached_p = -1;
+    }
+    /// latency below which p% of the recent samples are
+    double get_percentile(double p) const;
+  };
+  map<pg_shard_t, shard_latency_t> shard_latency;
+  void schedule_read_hedge(ReadOp &rop);
+  void hedge_read_op(ceph_tid_t tid);
+
 
   /**
    * Client writes
@@ -270,6 +270,11 @@ OSDService::OSDService(OSD *osd) :
   scrub_sleep_lock("OSDService::scrub_sleep_lock"),
   scrub_sleep_timer(
     osd->client_messenger->cct, scrub_sleep_lock, false /* relax locking */),
+  scrub_budget("scrub_budget", "OSDService::scrub_budget::lock"),
+  snap_trim_budget("snap_trim_budget", "OSDService::snap_trim_budget::lock"),
+  read_hedge_lock("OSDService::read_hedge_lock"),
+  read_hedge_timer(
+    osd->client_messenger->cct, read_hedge_lock, false /* relax locking */),
   snap_reserver(&reserver_finisher,
 		cct->_conf->osd_max_trimming_pgs),
   recovery_lock("OSDService::recovery_lock"),
@@ -557,6 +562,11 @@ void OSDService::shutdown()
     scrub_sleep_timer.shutdown();
   }
 
+  {
+    Mutex::Locker l(read_hedge_lock);
+    read_hedge_timer.shutdown();
+  }
+
   osdmap = OSDMapRef();
   next_osdmap = OSDMapRef();
 }
@@ -574,6 +584,7 @@ void OSDService::init()
   agent_timer.init();
   snap_sleep_timer.init();
   scrub_sleep_timer.init();
+  read_hedge_timer.init();
 
   agent_thread.create("osd_srv_agent");
 
@@ -981,6 +992,7 @@ bool OSDService::check_osdmap_full(const set<pg_shard_t> &missing_on)
 
 void OSDService::send_message_osd_cluster(int peer, Message *m, epoch_t from_epoch)
 {
+  osd->flush_peering_messages_to(peer);
   OSDMapRef next_map = get_nextmap_reserved();
   // service map is always newer/newest
   assert(from_epoch <= next_map->get_epoch());
@@ -1000,6 +1012,8 @@ void OSDService::send_message_osd_cluster(int peer, Message *m, epoch_t from_epo
 
 ConnectionRef OSDService::get_con_osd_cluster(int peer, epoch_t from_epoch)
 {
+  // callers send on the connection right away
+  osd->flush_peering_messages_to(peer);
   OSDMapRef next_map = get_nextmap_reserved();
   // service map is always newer/newest
   assert(from_epoch <= next_map->get_epoch());
@@ -1860,6 +1874,44 @@ int OSD::peek_meta(ObjectStore *store, std::string& magic,
 }
 
 
+double AdaptiveBudget::charge(
+  CephContext *cct, PerfCounters *logger,
+  uint64_t units, uint64_t max_rate,
+  double latency_target, double interval, int rate_counter)
+{
+  if (!max_rate)
+    return 0;
+
+  Mutex::Locker l(lock);
+  utime_t now = ceph_clock_now();
+  if (rate <= 0 || rate > max_rate)
+    rate = max_rate;
+
+  // halve the rate while clients see high latency, otherwise creep back up
+  if ((double)(now - sample_stamp) >= interval) {
+    pair<uint64_t,uint64_t> lat = logger->get_tavg_ms(l_osd_op_lat);
+    if (latency_target > 0 && lat.first > lat_sample.first) {
+      double avg = (double)(lat.second - lat_sample.second) /
+	(lat.first - lat_sample.first) / 1000.0;
+      if (avg > latency_target) {
+	rate = MAX(rate / 2, max_rate / 16.0);
+      } else {
+	rate = MIN(rate + max_rate / 10.0, (double)max_rate);
+      }
+      ldout(cct, 20) << name << " client op lat " << avg << "s target "
+		     << latency_target << ", rate now " << rate << dendl;
+    }
+    lat_sample = lat;
+    sample_stamp = now;
+    logger->set(rate_counter, rate);
+  }
+
+  if (next < now)
+    next = now;
+  next += (double)units / rate;
+  return next - now;
+}
+
 #undef dout_prefix
 #define dout_prefix _prefix(_dout, whoami, get_osdmap_epoch())
 
@@ -1970,6 +2022,9 @@ OSD::OSD(CephContext *cct_, ObjectStore *store_,
                                            cct->_conf->osd_op_history_duration);
   op_tracker.set_history_slow_op_size_and_threshold(cct->_conf->osd_op_history_slow_op_size,
                                                     cct->_conf->osd_op_history_slow_op_threshold);
+  rx_buffer_pool = ceph::aligned_buffer_pool::create(
+    cct->_conf->osd_rx_buffer_pool_chunk_size,
+    cct->_conf->osd_rx_buffer_pool_max_cached);
 #ifdef WITH_BLKIN
   std::stringstream ss;
   ss << "osd." << whoami;
@@ -2029,6 +2084,43 @@ public:
   }
 };
 
+void OSD::mark_boot_phase(const string& phase)
+{
+  Mutex::Locker l(boot_timeline_lock);
+  utime_t now = ceph_clock_now();
+  dout(10) << __func__ << " " << phase;
+  if (!boot_timeline.empty())
+    *_dout << " (+" << (now - boot_timeline.back().second) << ")";
+  *_dout << dendl;
+  boot_timeline.push_back(make_pair(phase, now));
+}
+
+void OSD::start_boot_timeline(const string& phase)
+{
+  {
+    Mutex::Locker l(boot_timeline_lock);
+    boot_timeline.clear();
+  }
+  mark_boot_phase(phase);
+}
+
+void OSD::dump_boot_timeline(Formatter *f)
+{
+  Mutex::Locker l(boot_timeline_lock);
+  f->open_array_section("boot_timeline");
+  for (auto p = boot_timeline.begin(); p != boot_timeline.end(); ++p) {
+    f->open_object_section("phase");
+    f->dump_string("phase", p->first);
+    f->dump_stream("stamp") << p->second;
+    f->dump_float("elapsed", p->second - boot_timeline.front().second);
+    if (p != boot_timeline.begin()) {
+      f->dump_float("duration", p->second - std::prev(p)->second);
+    }
+    f->close_section();
+  }
+  f->close_section();
+}
+
 bool OSD::asok_command(string admin_command, cmdmap_t& cmdmap, string format,
 		       ostream& ss)
 {
@@ -2046,6 +2138,8 @@ bool OSD::asok_command(string admin_command, cmdmap_t& cmdmap, string format,
       f->dump_unsigned("num_pgs", pg_map.size());
     }
     f->close_section();
+  } else if (admin_command == "dump_boot_timeline") {
+    dump_boot_timeline(f);
   } else if (admin_command == "flush_journal") {
     store->flush_journal();
   } else if (admin_command == "dump_ops_in_flight" ||
@@ -2333,6 +2427,8 @@ int OSD::init()
   if (is_stopping())
     return 0;
 
+  start_boot_timeline("init");
+
   tick_timer.init();
   tick_timer_without_osd_lock.init();
   service.recovery_request_timer.init();
@@ -2351,6 +2447,7 @@ int OSD::init()
     derr << "OSD:init: unable to mount object store" << dendl;
     return r;
   }
+  mark_boot_phase("mount");
 
   enable_disable_fuse(false);
 
@@ -2622,6 +2719,7 @@ int OSD::init()
   peering_wq.drain();
 
   dout(0) << "done with init, starting boot process" << dendl;
+  mark_boot_phase("init_done");
 
   // subscribe to any pg creations
   monc->sub_want("osd_pg_creates", last_pg_create_epoch, 0);
@@ -2656,6 +2754,10 @@ void OSD::final_init()
   int r = admin_socket->register_command("status", "status", asok_hook,
 					 "high-level status of OSD");
   assert(r == 0);
+  r = admin_socket->register_command("dump_boot_timeline",
+				     "dump_boot_timeline", asok_hook,
+				     "show how long each phase of OSD startup took");
+  assert(r == 0);
   r = admin_socket->register_command("flush_journal", "flush_journal",
                                      asok_hook,
                                      "flush the journal to permanent store");
@@ -3106,6 +3208,55 @@ void OSD::create_logger()
   osd_plb.add_u64_counter(
     l_osd_pg_biginfo, "osd_pg_biginfo", "PG updated its biginfo attr");
 
+  // Batch size axis configuration for peering histograms, values are pgs
+  PerfHistogramCommon::axis_config_d peering_hist_y_axis_config{
+    "Batch size (pgs)",
+    PerfHistogramCommon::SCALE_LOG2, ///< Batch size in logarithmic scale
+    0,                               ///< Start at 0
+    1,                               ///< Quantization unit is 1 pg
+    12,                              ///< Enough to cover any sane batch size
+  };
+  osd_plb.add_u64_counter_histogram(
+    l_osd_peering_advance_lat_hist, "peering_advance_latency_histogram",
+    op_hist_x_axis_config, peering_hist_y_axis_config,
+    "Histogram of time spent advancing pgs to the current map + batch size");
+  osd_plb.add_u64_counter_histogram(
+    l_osd_peering_handle_lat_hist, "peering_handle_latency_histogram",
+    op_hist_x_axis_config, peering_hist_y_axis_config,
+    "Histogram of time spent handling peering events + batch size");
+  osd_plb.add_u64_counter_histogram(
+    l_osd_peering_dispatch_lat_hist, "peering_dispatch_latency_histogram",
+    op_hist_x_axis_config, peering_hist_y_axis_config,
+    "Histogram of time spent queueing peering transactions + batch size");
+  osd_plb.add_u64_counter(
+    l_osd_peering_msg, "peering_msg",
+    "Batched peering messages (notify, query, info) sent");
+  osd_plb.add_u64_counter(
+    l_osd_peering_msg_pgs, "peering_msg_pgs",
+    "PG entries carried by batched peering messages");
+
+  osd_plb.add_time_avg(
+    l_osd_ec_sub_read_lat, "ec_subop_read_latency",
+    "EC client read latency of a single shard");
+  osd_plb.add_u64_counter(
+    l_osd_ec_read_hedged, "ec_read_hedged",
+    "EC client reads which asked extra shards because of slow ones");
+
+  osd_plb.add_u64_counter(
+    l_osd_recovery_small_objects, "recovery_small_objects",
+    "Small objects recovered in batches sharing one recovery op");
+
+  osd_plb.add_u64(
+    l_osd_scrub_io_rate, "scrub_io_rate",
+    "Current deep scrub read budget (bytes/sec)");
+  osd_plb.add_u64_counter(
+    l_osd_scrub_io_bytes, "scrub_io_bytes",
+    "Bytes read by deep scrub");
+
+  osd_plb.add_u64(
+    l_osd_snap_trim_rate, "snap_trim_rate",
+    "Current snap trim budget (objects/sec)");
+
   logger = osd_plb.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
 }
@@ -3206,6 +3357,7 @@ int OSD::shutdown()
 
   // unregister commands
   cct->get_admin_socket()->unregister_command("status");
+  cct->get_admin_socket()->unregister_command("dump_boot_timeline");
   cct->get_admin_socket()->unregister_command("flush_journal");
   cct->get_admin_socket()->unregister_command("dump_ops_in_flight");
   cct->get_admin_socket()->unregister_command("ops");
@@ -3249,6 +3401,7 @@ int OSD::shutdown()
   peering_tp.drain();
   peering_wq.clear();
   peering_tp.stop();
+  maybe_flush_peering_messages(true);  // we are stopping; this drops them
   dout(10) << "osd tp stopped" << dendl;
 
   osd_op_tp.drain();
@@ -3785,6 +3938,7 @@ void OSD::load_pgs()
 {
   assert(osd_lock.is_locked());
   dout(0) << "load_pgs" << dendl;
+  mark_boot_phase("load_pgs_start");
   {
     RWLock::RLocker l(pg_map_lock);
     assert(pg_map.empty());
@@ -3798,6 +3952,8 @@ void OSD::load_pgs()
 
   bool has_upgraded = false;
 
+  // first pass: instantiate the pgs (and the maps they need), in order
+  vector<pair<PG*, bufferlist> > loading;
   for (vector<coll_t>::iterator it = ls.begin();
        it != ls.end();
        ++it) {
@@ -3855,9 +4011,49 @@ void OSD::load_pgs()
     // there can be no waiters here, so we don't call wake_pg_waiters
 
     pg->ch = store->open_collection(pg->coll);
+    pg->unlock();
+
+    loading.push_back(make_pair(pg, bufferlist()));
+    loading.back().second.claim(bl);
+  }
+  mark_boot_phase("load_pgs_opened");
+
+  // second pass: read pg state and log.  this is where the time goes
+  // (info, log and missing all come from omap), and each pg only touches
+  // its own collection, so spread it across a thread pool.
+  int num_threads = cct->_conf->osd_load_pgs_threads;
+  if (num_threads > 1 && loading.size() > 1) {
+    dout(10) << __func__ << " reading " << loading.size() << " pgs with "
+	     << num_threads << " threads" << dendl;
+    ThreadPool load_tp(cct, "OSD::load_tp", "tp_osd_load", num_threads);
+    ContextWQ load_wq("OSD::load_wq", 0, &load_tp);
+    load_tp.start();
+    for (auto& p : loading) {
+      PG *pg = p.first;
+      bufferlist *bl = &p.second;
+      load_wq.queue(new FunctionContext([this, pg, bl](int r) {
+	    pg->lock();
+	    pg->read_state(store, *bl);
+	    pg->unlock();
+	  }));
+    }
+    load_wq.drain();
+    load_tp.stop();
+  } else {
+    for (auto& p : loading) {
+      p.first->lock();
+      p.first->read_state(store, p.second);
+      p.first->unlock();
+    }
+  }
+  mark_boot_phase("load_pgs_read");
 
-    // read pg state, log
-    pg->read_state(store, bl);
+  // third pass: everything that touches shared osd state, in the
+  // original collection order
+  for (auto& p : loading) {
+    PG *pg = p.first;
+    spg_t pgid = pg->info.pgid;
+    pg->lock();
 
     if (pg->must_upgrade()) {
       if (!pg->can_upgrade()) {
@@ -3924,6 +4120,7 @@ void OSD::load_pgs()
   }
 
   build_past_intervals_parallel();
+  mark_boot_phase("load_pgs_done");
 }
 
 
@@ -5004,6 +5201,9 @@ void OSD::tick_without_osd_lock()
   logger->set(l_osd_cached_crc_adjusted, buffer::get_cached_crc_adjusted());
   logger->set(l_osd_missed_crc, buffer::get_missed_crc());
 
+  // don't let peering messages sit behind a busy peering queue forever
+  maybe_flush_peering_messages(false);
+
   // osd_lock is not being held, which means the OSD state
   // might change when doing the monitor report
   if (is_active() || is_waiting_for_healthy()) {
@@ -5692,6 +5892,7 @@ bool OSD::_is_healthy()
 void OSD::_send_boot()
 {
   dout(10) << "_send_boot" << dendl;
+  mark_boot_phase("boot_sent");
   entity_addr_t cluster_addr = cluster_messenger->get_myaddr();
   Connection *local_connection = cluster_messenger->get_loopback_connection().get();
   if (cluster_addr.is_blank_ip()) {
@@ -6793,6 +6994,26 @@ void OSD::ms_fast_dispatch(Message *m)
   OID_EVENT_TRACE_WITH_MSG(m, "MS_FAST_DISPATCH_END", false); 
 }
 
+bool OSD::ms_get_rx_buffer(const ceph_msg_header &header, bufferlist *data)
+{
+  // only write payloads, which go on to the ObjectStore
+  switch (le16_to_cpu(header.type)) {
+  case CEPH_MSG_OSD_OP:
+  case MSG_OSD_REPOP:
+  case MSG_OSD_EC_WRITE:
+  case MSG_OSD_PG_PUSH:
+    break;
+  default:
+    return false;
+  }
+  unsigned data_len = le32_to_cpu(header.data_len);
+  if (!cct->_conf->osd_rx_buffer_pool ||
+      data_len < cct->_conf->osd_rx_buffer_pool_min_len)
+    return false;
+  rx_buffer_pool->fill(data, data_len, le32_to_cpu(header.data_off));
+  return true;
+}
+
 void OSD::ms_fast_preprocess(Message *m)
 {
   if (m->get_connection()->get_peer_type() == CEPH_ENTITY_TYPE_OSD) {
@@ -7651,6 +7872,7 @@ void OSD::_committed_osd_maps(epoch_t first, epoch_t last, MOSDMap *m)
     if (is_booting()) {
       dout(1) << "state: booting -> active" << dendl;
       set_state(STATE_ACTIVE);
+      mark_boot_phase("active");
 
       // set incarnation so that osd_reqid_t's we generate for our
       // objecter requests are unique across restarts.
@@ -7824,8 +8046,11 @@ void OSD::_committed_osd_maps(epoch_t first, epoch_t last, MOSDMap *m)
     else
       start_boot();
   }
-  else if (do_restart)
+  else if (do_restart) {
+    // we were marked down; time the boot that follows on its own
+    start_boot_timeline("restart");
     start_boot();
+  }
 
 }
 
@@ -9171,6 +9396,54 @@ void OSDService::finish_recovery_op(PG *pg, const hobject_t& soid, bool dequeue)
   _maybe_queue_recovery();
 }
 
+double OSDService::get_scrub_budget_delay(uint64_t bytes)
+{
+  logger->inc(l_osd_scrub_io_bytes, bytes);
+  return scrub_budget.charge(
+    cct, logger, bytes,
+    store->is_rotational() ?
+      cct->_conf->osd_scrub_io_budget_hdd :
+      cct->_conf->osd_scrub_io_budget_ssd,
+    cct->_conf->osd_scrub_client_latency_target,
+    cct->_conf->osd_scrub_io_budget_interval,
+    l_osd_scrub_io_rate);
+}
+
+double OSDService::get_snap_trim_budget_delay(uint64_t objects)
+{
+  return snap_trim_budget.charge(
+    cct, logger, objects,
+    store->is_rotational() ?
+      cct->_conf->osd_snap_trim_rate_hdd :
+      cct->_conf->osd_snap_trim_rate_ssd,
+    cct->_conf->osd_snap_trim_client_latency_target,
+    cct->_conf->osd_snap_trim_io_budget_interval,
+    l_osd_snap_trim_rate);
+}
+
+void OSDService::start_recovery_batch(PG *pg)
+{
+  Mutex::Locker l(recovery_lock);
+  dout(10) << "start_recovery_batch " << *pg
+	   << " (" << recovery_ops_active << "/"
+	   << cct->_conf->osd_recovery_max_active << " rops)"
+	   << dendl;
+  recovery_ops_active++;
+}
+
+void OSDService::finish_recovery_batch(PG *pg, bool dequeue)
+{
+  Mutex::Locker l(recovery_lock);
+  dout(10) << "finish_recovery_batch " << *pg
+	   << " dequeue=" << dequeue
+	   << " (" << recovery_ops_active << "/"
+	   << cct->_conf->osd_recovery_max_active << " rops)"
+	   << dendl;
+  assert(recovery_ops_active > 0);
+  recovery_ops_active--;
+  _maybe_queue_recovery();
+}
+
 bool OSDService::is_recovery_active()
 {
   if (recovery_ops_active > 0)
@@ -9291,6 +9564,7 @@ void OSD::process_peering_events(
   OSDMapRef curmap;
   PG::RecoveryCtx rctx = create_context();
   rctx.handle = &handle;
+  utime_t advance_lat, handle_lat, dispatch_lat;
   for (list<PG*>::const_iterator i = pgs.begin();
        i != pgs.end();
        ++i) {
@@ -9302,34 +9576,167 @@ void OSD::process_peering_events(
       pg->unlock();
       continue;
     }
+    utime_t start = ceph_clock_now();
     if (!advance_pg(curmap->get_epoch(), pg, handle, &rctx, &split_pgs)) {
       // we need to requeue the PG explicitly since we didn't actually
       // handle an event
       peering_wq.queue(pg);
+      advance_lat += ceph_clock_now() - start;
     } else {
+      utime_t advanced = ceph_clock_now();
+      advance_lat += advanced - start;
       assert(!pg->peering_queue.empty());
       PG::CephPeeringEvtRef evt = pg->peering_queue.front();
       pg->peering_queue.pop_front();
       pg->handle_peering_event(evt, &rctx);
+      handle_lat += ceph_clock_now() - advanced;
     }
     need_up_thru = pg->need_up_thru || need_up_thru;
     same_interval_since = MAX(pg->info.history.same_interval_since,
 			      same_interval_since);
+    start = ceph_clock_now();
     pg->write_if_dirty(*rctx.transaction);
     if (!split_pgs.empty()) {
       rctx.on_applied->add(new C_CompleteSplits(this, split_pgs));
       split_pgs.clear();
     }
     dispatch_context_transaction(rctx, pg, &handle);
+    dispatch_lat += ceph_clock_now() - start;
     pg->unlock();
   }
   if (need_up_thru)
     queue_want_up_thru(same_interval_since);
+  if (curmap) {
+    queue_peering_messages(rctx, curmap);
+  }
   dispatch_context(rctx, 0, curmap, &handle);
+  maybe_flush_peering_messages(false);
+
+  logger->hinc(l_osd_peering_advance_lat_hist, advance_lat.to_nsec(),
+	       pgs.size());
+  logger->hinc(l_osd_peering_handle_lat_hist, handle_lat.to_nsec(),
+	       pgs.size());
+  logger->hinc(l_osd_peering_dispatch_lat_hist, dispatch_lat.to_nsec(),
+	       pgs.size());
 
   service.send_pg_temp();
 }
 
+/*
+ * Move the messages generated by a peering batch into the per-epoch
+ * accumulator, flushing whatever was pending against an older map first.
+ */
+void OSD::queue_peering_messages(PG::RecoveryCtx &ctx, OSDMapRef curmap)
+{
+  Mutex::Locker l(peering_msg_lock);
+  if (peering_msg_map &&
+      peering_msg_map->get_epoch() != curmap->get_epoch()) {
+    _flush_peering_messages();
+  }
+  // MOSDPGQuery holds one query per pg; if a pg already has one
+  // pending for the same peer, send that first rather than replace it
+  for (auto& p : *ctx.query_map) {
+    auto pending = peering_msg_queries.find(p.first);
+    if (pending == peering_msg_queries.end())
+      continue;
+    bool conflict = false;
+    for (auto& q : p.second) {
+      if (pending->second.count(q.first)) {
+	conflict = true;
+	break;
+      }
+    }
+    if (conflict) {
+      _flush_peering_messages();
+      break;
+    }
+  }
+  for (auto& p : *ctx.notify_list) {
+    auto& v = peering_msg_notifies[p.first];
+    peering_msg_pgs += p.second.size();
+    v.insert(v.end(), p.second.begin(), p.second.end());
+  }
+  for (auto& p : *ctx.query_map) {
+    auto& m = peering_msg_queries[p.first];
+    peering_msg_pgs += p.second.size();
+    m.insert(p.second.begin(), p.second.end());
+  }
+  for (auto& p : *ctx.info_map) {
+    auto& v = peering_msg_infos[p.first];
+    peering_msg_pgs += p.second.size();
+    v.insert(v.end(), p.second.begin(), p.second.end());
+  }
+  ctx.notify_list->clear();
+  ctx.query_map->clear();
+  ctx.info_map->clear();
+  if (peering_msg_pgs && !peering_msg_map) {
+    peering_msg_map = curmap;
+    peering_msg_since = ceph_clock_now();
+  }
+  peering_msg_pending = peering_msg_pgs > 0;
+}
+
+/*
+ * Send the accumulated peering messages once nothing else is queued
+ * behind them, once enough pgs have piled up, or once the oldest has
+ * waited osd_peering_msg_batch_max_delay.
+ */
+void OSD::maybe_flush_peering_messages(bool force)
+{
+  Mutex::Locker l(peering_msg_lock);
+  if (!peering_msg_map)
+    return;
+  if (!force &&
+      peering_msg_pgs < cct->_conf->osd_peering_msg_batch_max_pgs &&
+      ceph_clock_now() - peering_msg_since <
+        cct->_conf->osd_peering_msg_batch_max_delay &&
+      !peering_wq.empty()) {
+    dout(20) << __func__ << " holding " << peering_msg_pgs << " pgs" << dendl;
+    return;
+  }
+  _flush_peering_messages();
+}
+
+void OSD::_flush_peering_messages()
+{
+  assert(peering_msg_lock.is_locked());
+  if (!peering_msg_map)
+    return;
+  dout(10) << __func__ << " " << peering_msg_pgs << " pgs at epoch "
+	   << peering_msg_map->get_epoch() << dendl;
+  if (service.get_osdmap()->is_up(whoami) &&
+      is_active()) {
+    logger->inc(l_osd_peering_msg,
+		peering_msg_notifies.size() +
+		peering_msg_queries.size() +
+		peering_msg_infos.size());
+    logger->inc(l_osd_peering_msg_pgs, peering_msg_pgs);
+    do_notifies(peering_msg_notifies, peering_msg_map);
+    do_queries(peering_msg_queries, peering_msg_map);
+    do_infos(peering_msg_infos, peering_msg_map);
+  }
+  peering_msg_notifies.clear();
+  peering_msg_queries.clear();
+  peering_msg_infos.clear();
+  peering_msg_pgs = 0;
+  peering_msg_pending = false;
+  peering_msg_map.reset();
+}
+
+void OSD::flush_peering_messages_to(int peer)
+{
+  // the flush itself sends through get_con_osd_cluster
+  if (!peering_msg_pending || peering_msg_lock.is_locked_by_me())
+    return;
+  Mutex::Locker l(peering_msg_lock);
+  if (peering_msg_notifies.count(peer) ||
+      peering_msg_queries.count(peer) ||
+      peering_msg_infos.count(peer)) {
+    dout(20) << __func__ << " osd." << peer << dendl;
+    _flush_peering_messages();
+  }
+}
+
 // --------------------------------
 
 const char** OSD::get_tracked_conf_keys() const
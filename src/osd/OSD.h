@@ -56,6 +56,7 @@ using namespace std;
 #include "messages/MOSDOp.h"
 #include "include/Spinlock.h"
 #include "common/EventTrace.h"
+#include "common/aligned_buffer_pool.h"
 
 #define CEPH_OSD_PROTOCOL    10 /* cluster internal */
 
@@ -170,6 +171,22 @@ enum {
   l_osd_pg_fastinfo,
   l_osd_pg_biginfo,
 
+  l_osd_peering_advance_lat_hist,
+  l_osd_peering_handle_lat_hist,
+  l_osd_peering_dispatch_lat_hist,
+  l_osd_peering_msg,
+  l_osd_peering_msg_pgs,
+
+  l_osd_ec_sub_read_lat,
+  l_osd_ec_read_hedged,
+
+  l_osd_recovery_small_objects,
+
+  l_osd_scrub_io_rate,
+  l_osd_scrub_io_bytes,
+
+  l_osd_snap_trim_rate,
+
   l_osd_last,
 };
 
@@ -454,6 +471,33 @@ public:
   epoch_t get_map_epoch() const { return map_epoch; }
 };
 
+/**
+ * AdaptiveBudget - rate limit for background work, shared by all pgs
+ *
+ * Work is charged after it is done, and the caller waits for the
+ * returned delay before doing more.  All callers share one virtual
+ * clock, so concurrent pgs split the rate.  Every interval the rate is
+ * halved (down to 1/16 of max_rate) if client op latency was above the
+ * target, and otherwise grows back by 1/10 of max_rate.
+ */
+class AdaptiveBudget {
+  const char *name;
+  Mutex lock;
+  double rate = 0;           ///< current allowance, units/sec
+  utime_t next;              ///< when work so far is paid for
+  utime_t sample_stamp;
+  pair<uint64_t,uint64_t> lat_sample; ///< client op lat (count, ms)
+
+public:
+  AdaptiveBudget(const char *name, const char *lock_name)
+    : name(name), lock(lock_name) {}
+
+  /// charge units of work; @return seconds to wait before doing more
+  double charge(CephContext *cct, PerfCounters *logger,
+		uint64_t units, uint64_t max_rate,
+		double latency_target, double interval, int rate_counter);
+};
+
 class OSDService {
 public:
   OSD *osd;
@@ -966,6 +1010,19 @@ public:
   Mutex scrub_sleep_lock;
   SafeTimer scrub_sleep_timer;
 
+  // deep scrub read budget, shared by all pgs
+  AdaptiveBudget scrub_budget;
+  /// account for bytes of scrub reads; returns how long to wait before more
+  double get_scrub_budget_delay(uint64_t bytes);
+
+  // snap trim budget, shared by all pgs
+  AdaptiveBudget snap_trim_budget;
+  /// account for trimmed objects; returns how long to wait before more
+  double get_snap_trim_budget_delay(uint64_t objects);
+
+  Mutex read_hedge_lock;
+  SafeTimer read_hedge_timer;
+
   AsyncReserver<spg_t> snap_reserver;
   void queue_for_snap_trim(PG *pg);
 
@@ -1011,6 +1068,9 @@ private:
 public:
   void start_recovery_op(PG *pg, const hobject_t& soid);
   void finish_recovery_op(PG *pg, const hobject_t& soid, bool dequeue);
+  // one recovery op shared by a batch of small objects
+  void start_recovery_batch(PG *pg);
+  void finish_recovery_batch(PG *pg, bool dequeue);
   bool is_recovery_active();
   void release_reserved_pushes(uint64_t pushes) {
     Mutex::Locker l(recovery_lock);
@@ -1473,6 +1533,18 @@ public:
     return state == STATE_WAITING_FOR_HEALTHY;
   }
 
+  // -- boot timeline --
+private:
+  Mutex boot_timeline_lock = {"OSD::boot_timeline_lock"};
+  vector<pair<string, utime_t> > boot_timeline;  ///< phases reached, in order
+
+public:
+  /// note that we reached a boot phase (see dump_boot_timeline asok)
+  void mark_boot_phase(const string& phase);
+  /// drop the previous timeline and start a new one at phase
+  void start_boot_timeline(const string& phase);
+  void dump_boot_timeline(Formatter *f);
+
 private:
 
   ThreadPool peering_tp;
@@ -1956,12 +2028,39 @@ private:
     void _clear() override {
       assert(peering_queue.empty());
     }
+    bool empty() {
+      lock();
+      bool r = _empty();
+      unlock();
+      return r;
+    }
   } peering_wq;
 
   void process_peering_events(
     const list<PG*> &pg,
     ThreadPool::TPHandle &handle);
 
+  // -- peering message batching --
+  /*
+   * Notifies, queries and infos generated by PeeringWQ batches are
+   * accumulated here and sent as one message of each kind per peer
+   * per epoch, instead of one set per batch.
+   */
+  Mutex peering_msg_lock = {"OSD::peering_msg_lock"};
+  OSDMapRef peering_msg_map;   ///< map the pending messages were built against
+  utime_t peering_msg_since;   ///< when the oldest pending message was queued
+  unsigned peering_msg_pgs = 0; ///< pg entries pending, across all peers
+  std::atomic<bool> peering_msg_pending = {false}; ///< peering_msg_pgs > 0
+  map<int, vector<pair<pg_notify_t, PastIntervals> > > peering_msg_notifies;
+  map<int, map<spg_t, pg_query_t> > peering_msg_queries;
+  map<int, vector<pair<pg_notify_t, PastIntervals> > > peering_msg_infos;
+
+  void queue_peering_messages(PG::RecoveryCtx &ctx, OSDMapRef curmap);
+  void maybe_flush_peering_messages(bool force);
+  void _flush_peering_messages();
+  /// send what is pending before anything else goes directly to peer
+  void flush_peering_messages_to(int peer);
+
   friend class PG;
   friend class PrimaryLogPG;
 
@@ -2396,6 +2495,9 @@ protected:
   }
   void ms_fast_dispatch(Message *m) override;
   void ms_fast_preprocess(Message *m) override;
+  bool ms_get_rx_buffer(const ceph_msg_header &header,
+			bufferlist *data) override;
+  std::shared_ptr<ceph::aligned_buffer_pool> rx_buffer_pool;
   bool ms_dispatch(Message *m) override;
   bool ms_get_authorizer(int dest_type, AuthAuthorizer **authorizer, bool force_new) override;
   bool ms_verify_authorizer(Connection *con, int peer_type,
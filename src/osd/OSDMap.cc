@@ -2094,11 +2094,13 @@ void OSDMap::pg_to_raw_up(pg_t pg, vector<int> *up, int *primary) const
 void OSDMap::_pg_to_up_acting_osds(
   const pg_t& pg, vector<int> *up, int *up_primary,
   vector<int> *acting, int *acting_primary,
-  bool raw_pg_to_pg) const
+  bool raw_pg_to_pg, vector<int> *raw_out) const
 {
   const pg_pool_t *pool = get_pg_pool(pg.pool());
   if (!pool ||
       (!raw_pg_to_pg && pg.ps() >= pool->get_pg_num())) {
+    if (raw_out)
+      raw_out->clear();
     if (up)
       up->clear();
     if (up_primary)
@@ -2116,7 +2118,7 @@ void OSDMap::_pg_to_up_acting_osds(
   int _acting_primary;
   ps_t pps;
   _get_temp_osds(*pool, pg, &_acting, &_acting_primary);
-  if (_acting.empty() || up || up_primary) {
+  if (_acting.empty() || up || up_primary || raw_out) {
     _pg_to_raw_osds(*pool, pg, &raw, &pps);
     _apply_remap(*pool, pg, &raw);
     _raw_to_up_osds(*pool, raw, &_up);
@@ -2133,6 +2135,8 @@ void OSDMap::_pg_to_up_acting_osds(
       up->swap(_up);
     if (up_primary)
       *up_primary = _up_primary;
+    if (raw_out)
+      raw_out->swap(raw);
   }
 
   if (acting)
@@ -556,6 +556,7 @@ private:
   ceph::shared_ptr<CrushWrapper> crush;       // hierarchical map
 
   friend class OSDMonitor;
+  friend class OSDMapMapping;
 
  public:
   OSDMap() : epoch(0), 
@@ -1025,10 +1026,12 @@ private:
 
   /**
    *  map to up and acting. Fills in whatever fields are non-NULL.
+   *  If raw is non-NULL it gets the crush output with upmaps applied.
    */
   void _pg_to_up_acting_osds(const pg_t& pg, vector<int> *up, int *up_primary,
                              vector<int> *acting, int *acting_primary,
-			     bool raw_pg_to_pg = true) const;
+			     bool raw_pg_to_pg = true,
+			     vector<int> *raw = nullptr) const;
 
 public:
   /***
@@ -1066,6 +1069,17 @@ public:
     int up_primary, acting_primary;
     pg_to_up_acting_osds(pg, &up, &up_primary, &acting, &acting_primary);
   }
+  /**
+   * as above, but also return the raw (crush + upmap) set the up set
+   * was derived from.  Each of these pointers must be non-NULL.
+   */
+  void pg_to_raw_up_acting_osds(pg_t pg, vector<int> *raw,
+				vector<int> *up, int *up_primary,
+				vector<int> *acting,
+				int *acting_primary) const {
+    _pg_to_up_acting_osds(pg, up, up_primary, acting, acting_primary,
+			  true, raw);
+  }
   bool pg_is_ec(pg_t pg) const {
     auto i = pools.find(pg.pool());
     assert(i != pools.end());
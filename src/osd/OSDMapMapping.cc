@@ -10,9 +10,12 @@
 
 MEMPOOL_DEFINE_OBJECT_FACTORY(OSDMapMapping, osdmapmapping,
 			      osdmap_mapping);
+MEMPOOL_DEFINE_OBJECT_FACTORY(OSDMapMappingCache, osdmapmappingcache,
+			      osdmap_mapping);
 
 // ensure that we have a PoolMappings for each pool and that
-// the dimensions (pg_num and size) match up.
+// the dimensions (pg_num and size) match up.  pools that are new or
+// whose placement inputs changed are added to dirty_pools.
 void OSDMapMapping::_init_mappings(const OSDMap& osdmap)
 {
   num_pgs = 0;
@@ -23,6 +26,7 @@ void OSDMapMapping::_init_mappings(const OSDMap& osdmap)
     while (q != pools.end() && q->first < p.first) {
       q = pools.erase(q);
     }
+    uint64_t hashpspool = p.second.has_flag(pg_pool_t::FLAG_HASHPSPOOL);
     if (q != pools.end() && q->first == p.first) {
       if (q->second.pg_num != p.second.get_pg_num() ||
 	  q->second.size != p.second.get_size()) {
@@ -30,12 +34,24 @@ void OSDMapMapping::_init_mappings(const OSDMap& osdmap)
 	q = pools.erase(q);
       } else {
 	// keep it
+	if (q->second.pgp_num != p.second.get_pgp_num() ||
+	    q->second.crush_ruleset != p.second.get_crush_ruleset() ||
+	    q->second.hashpspool != hashpspool) {
+	  q->second.pgp_num = p.second.get_pgp_num();
+	  q->second.crush_ruleset = p.second.get_crush_ruleset();
+	  q->second.hashpspool = hashpspool;
+	  dirty_pools.insert(p.first);
+	}
 	++q;
 	continue;
       }
     }
-    pools.emplace(p.first, PoolMapping(p.second.get_size(),
-				       p.second.get_pg_num()));
+    auto r = pools.emplace(p.first, PoolMapping(p.second.get_size(),
+						p.second.get_pg_num()));
+    r.first->second.pgp_num = p.second.get_pgp_num();
+    r.first->second.crush_ruleset = p.second.get_crush_ruleset();
+    r.first->second.hashpspool = hashpspool;
+    dirty_pools.insert(p.first);
   }
   pools.erase(q, pools.end());
   assert(pools.size() == osdmap.get_pools().size());
@@ -51,6 +67,240 @@ void OSDMapMapping::update(const OSDMap& osdmap)
   //_dump();  // for debugging
 }
 
+void OSDMapMapping::update_incremental(const OSDMap& osdmap)
+{
+  _start(osdmap);
+  if (!_can_update_incrementally(osdmap)) {
+    for (auto& p : osdmap.get_pools()) {
+      _update_range(osdmap, p.first, 0, p.second.get_pg_num());
+    }
+  } else {
+    std::map<int64_t,std::vector<unsigned>> pgs;
+    _get_dirty(osdmap, &pgs);
+    for (auto& p : pgs) {
+      _update_pgs(osdmap, p.first, p.second);
+    }
+  }
+  _finish(osdmap);
+}
+
+bool OSDMapMapping::get_incremental_changes(
+  const OSDMap& osdmap,
+  const OSDMap::Incremental& inc,
+  std::set<pg_t> *pgs,
+  std::set<int> *osds,
+  std::set<int64_t> *pools)
+{
+  if (inc.epoch != osdmap.get_epoch() ||
+      inc.fullmap.length() ||
+      inc.crush.length() ||
+      inc.new_max_osd >= 0) {
+    // a new crush map or max_osd can move anything
+    return false;
+  }
+
+  // per-pg overrides only affect their own pg
+  for (auto& p : inc.new_pg_temp) {
+    pgs->insert(p.first);
+  }
+  for (auto& p : inc.new_primary_temp) {
+    pgs->insert(p.first);
+  }
+  for (auto& p : inc.new_pg_upmap) {
+    pgs->insert(p.first);
+  }
+  pgs->insert(inc.old_pg_upmap.begin(), inc.old_pg_upmap.end());
+  for (auto& p : inc.new_pg_upmap_items) {
+    pgs->insert(p.first);
+  }
+  pgs->insert(inc.old_pg_upmap_items.begin(), inc.old_pg_upmap_items.end());
+
+  // osds whose state, address or primary affinity changed can only
+  // affect pgs they already appear in (raw, up or acting), or whose
+  // pg_temp/primary_temp names them.
+  std::set<int> reweighted;  // may also change the crush result
+  for (auto& p : inc.new_state) {
+    osds->insert(p.first);
+    if (p.second & CEPH_OSD_EXISTS) {
+      reweighted.insert(p.first);
+    }
+  }
+  for (auto& p : inc.new_up_client) {
+    osds->insert(p.first);
+  }
+  for (auto& p : inc.new_primary_affinity) {
+    osds->insert(p.first);
+  }
+  for (auto& p : inc.new_weight) {
+    osds->insert(p.first);
+    reweighted.insert(p.first);
+  }
+  if (osds->empty()) {
+    return true;
+  }
+
+  if (!reweighted.empty()) {
+    // any pg of a pool whose rule can reach a reweighted osd may move
+    std::map<int,bool> rule_hit;
+    for (auto& p : osdmap.get_pools()) {
+      int ruleno = osdmap.crush->find_rule(p.second.get_crush_ruleset(),
+					   p.second.get_type(),
+					   p.second.get_size());
+      if (ruleno < 0) {
+	continue;
+      }
+      auto r = rule_hit.find(ruleno);
+      if (r == rule_hit.end()) {
+	map<int,float> wm;
+	osdmap.crush->get_rule_weight_osd_map(ruleno, &wm);
+	bool hit = false;
+	for (auto o : reweighted) {
+	  if (wm.count(o)) {
+	    hit = true;
+	    break;
+	  }
+	}
+	r = rule_hit.emplace(ruleno, hit).first;
+      }
+      if (r->second) {
+	pools->insert(p.first);
+      }
+    }
+  }
+
+  for (auto& p : *osdmap.pg_temp) {
+    for (auto o : p.second) {
+      if (osds->count(o)) {
+	pgs->insert(p.first);
+	break;
+      }
+    }
+  }
+  for (auto& p : *osdmap.primary_temp) {
+    if (osds->count(p.second)) {
+      pgs->insert(p.first);
+    }
+  }
+  // upmap targets are ignored while they are marked out
+  for (auto& p : osdmap.pg_upmap) {
+    for (auto o : p.second) {
+      if (osds->count(o)) {
+	pgs->insert(p.first);
+	break;
+      }
+    }
+  }
+  for (auto& p : osdmap.pg_upmap_items) {
+    for (auto& q : p.second) {
+      if (osds->count(q.second)) {
+	pgs->insert(p.first);
+	break;
+      }
+    }
+  }
+  return true;
+}
+
+void OSDMapMapping::note_incremental(const OSDMap& osdmap,
+				     const OSDMap::Incremental& inc)
+{
+  if (need_full) {
+    return;
+  }
+  std::set<pg_t> pgs;
+  std::set<int> osds;
+  std::set<int64_t> moved_pools;
+  if (inc.epoch != noted_epoch + 1 ||
+      !get_incremental_changes(osdmap, inc, &pgs, &osds, &moved_pools)) {
+    need_full = true;
+    return;
+  }
+  noted_epoch = inc.epoch;
+
+  // pool changes are picked up by _init_mappings()
+  dirty_pools.insert(moved_pools.begin(), moved_pools.end());
+  for (auto& pgid : pgs) {
+    _mark_dirty(pgid);
+  }
+  if (osds.empty()) {
+    return;
+  }
+  for (auto& p : pools) {
+    if (dirty_pools.count(p.first)) {
+      continue;
+    }
+    for (unsigned ps = 0; ps < p.second.pg_num; ++ps) {
+      for (auto o : osds) {
+	if (p.second.references(ps, o)) {
+	  _mark_dirty(pg_t(ps, p.first));
+	  break;
+	}
+      }
+    }
+  }
+}
+
+void OSDMapMapping::_get_dirty(
+  const OSDMap& osdmap,
+  std::map<int64_t,std::vector<unsigned>> *pgs) const
+{
+  for (auto& p : pools) {
+    if (dirty_pools.count(p.first)) {
+      auto& v = (*pgs)[p.first];
+      v.resize(p.second.pg_num);
+      for (unsigned ps = 0; ps < p.second.pg_num; ++ps) {
+	v[ps] = ps;
+      }
+      continue;
+    }
+    auto q = dirty_pgs.find(p.first);
+    if (q == dirty_pgs.end()) {
+      continue;
+    }
+    auto& v = (*pgs)[p.first];
+    for (auto ps : q->second) {
+      if (ps >= p.second.pg_num) {
+	break;
+      }
+      v.push_back(ps);
+    }
+  }
+}
+
+unsigned OSDMapMapping::check(const OSDMap& osdmap, std::ostream *ss) const
+{
+  unsigned bad = 0;
+  for (auto& p : osdmap.get_pools()) {
+    auto q = pools.find(p.first);
+    if (q == pools.end()) {
+      if (ss) {
+	*ss << "pool " << p.first << " missing\n";
+      }
+      bad += p.second.get_pg_num();
+      continue;
+    }
+    for (unsigned ps = 0; ps < p.second.get_pg_num(); ++ps) {
+      pg_t pgid(ps, p.first);
+      vector<int> up, acting, up2, acting2;
+      int up_primary, acting_primary, up_primary2, acting_primary2;
+      osdmap.pg_to_up_acting_osds(pgid, &up, &up_primary,
+				  &acting, &acting_primary);
+      get(pgid, &up2, &up_primary2, &acting2, &acting_primary2);
+      if (up != up2 || up_primary != up_primary2 ||
+	  acting != acting2 || acting_primary != acting_primary2) {
+	if (ss) {
+	  *ss << pgid << " up " << up << "/" << up_primary
+	      << " acting " << acting << "/" << acting_primary
+	      << " but mapping has up " << up2 << "/" << up_primary2
+	      << " acting " << acting2 << "/" << acting_primary2 << "\n";
+	}
+	++bad;
+      }
+    }
+  }
+  return bad;
+}
+
 void OSDMapMapping::update(const OSDMap& osdmap, pg_t pgid)
 {
   _update_range(osdmap, pgid.pool(), pgid.ps(), pgid.ps() + 1);
@@ -72,12 +322,12 @@ void OSDMapMapping::_build_rmap(const OSDMap& osdmap)
       pgid.set_ps(ps);
       int32_t *row = &p.second.table[p.second.row_size() * ps];
       for (int i = 0; i < row[2]; ++i) {
-	if (row[4 + i] != CRUSH_ITEM_NONE) {
-	  acting_rmap[row[4 + i]].push_back(pgid);
+	if (row[5 + i] != CRUSH_ITEM_NONE) {
+	  acting_rmap[row[5 + i]].push_back(pgid);
 	}
       }
       //for (int i = 0; i < row[3]; ++i) {
-      //up_rmap[row[4 + p.second.size + i]].push_back(pgid);
+      //up_rmap[row[5 + p.second.size + i]].push_back(pgid);
       //}
     }
   }
@@ -87,6 +337,18 @@ void OSDMapMapping::_finish(const OSDMap& osdmap)
 {
   _build_rmap(osdmap);
   epoch = osdmap.get_epoch();
+  if (check_cct && !need_full) {
+    ostringstream ss;
+    if (check(osdmap, &ss)) {
+      lderr(check_cct) << __func__ << " incremental mapping e" << epoch
+		       << " differs from full mapping:\n" << ss.str() << dendl;
+      ceph_abort_msg(check_cct, "incremental pg mapping is wrong");
+    }
+  }
+  need_full = false;
+  noted_epoch = epoch;
+  dirty_pools.clear();
+  dirty_pgs.clear();
 }
 
 void OSDMapMapping::_dump()
@@ -112,14 +374,131 @@ void OSDMapMapping::_update_range(
   assert(pg_begin <= pg_end);
   assert(pg_end <= i->second.pg_num);
   for (unsigned ps = pg_begin; ps < pg_end; ++ps) {
-    vector<int> up, acting;
+    vector<int> raw, up, acting;
+    int up_primary, acting_primary;
+    osdmap.pg_to_raw_up_acting_osds(
+      pg_t(ps, pool),
+      &raw, &up, &up_primary, &acting, &acting_primary);
+    i->second.set(ps, raw, up, up_primary, acting, acting_primary);
+  }
+}
+
+void OSDMapMapping::_update_pgs(
+  const OSDMap& osdmap,
+  int64_t pool,
+  const std::vector<unsigned>& pss)
+{
+  auto i = pools.find(pool);
+  assert(i != pools.end());
+  for (auto ps : pss) {
+    assert(ps < i->second.pg_num);
+    vector<int> raw, up, acting;
     int up_primary, acting_primary;
-    osdmap.pg_to_up_acting_osds(
+    osdmap.pg_to_raw_up_acting_osds(
       pg_t(ps, pool),
-      &up, &up_primary, &acting, &acting_primary);
-    i->second.set(ps, std::move(up), up_primary,
-		  std::move(acting), acting_primary);
+      &raw, &up, &up_primary, &acting, &acting_primary);
+    i->second.set(ps, raw, up, up_primary, acting, acting_primary);
+  }
+}
+
+// ---------------------------
+
+void OSDMapMappingCache::get(
+  const OSDMap& osdmap,
+  pg_t pgid,
+  std::vector<int> *up,
+  int *up_primary,
+  std::vector<int> *acting,
+  int *acting_primary)
+{
+  Shard& shard = _get_shard(pgid);
+  std::lock_guard<std::mutex> l(shard.lock);
+  if (shard.epoch != osdmap.get_epoch()) {
+    // we missed an incremental (or got a full map)
+    shard.pgs.clear();
+    shard.epoch = osdmap.get_epoch();
+  }
+  auto p = shard.pgs.find(pgid);
+  if (p == shard.pgs.end()) {
+    if (shard.pgs.size() >= max_per_shard) {
+      shard.pgs.clear();
+    }
+    vector<int> raw;
+    osdmap.pg_to_raw_up_acting_osds(pgid, &raw, up, up_primary,
+				    acting, acting_primary);
+    Entry& e = shard.pgs[pgid];
+    e.up_primary = *up_primary;
+    e.acting_primary = *acting_primary;
+    e.num_up = up->size();
+    e.num_acting = acting->size();
+    e.osds.reserve(up->size() + acting->size() + raw.size());
+    e.osds.insert(e.osds.end(), up->begin(), up->end());
+    e.osds.insert(e.osds.end(), acting->begin(), acting->end());
+    e.osds.insert(e.osds.end(), raw.begin(), raw.end());
+    return;
   }
+  const Entry& e = p->second;
+  up->assign(e.osds.begin(), e.osds.begin() + e.num_up);
+  acting->assign(e.osds.begin() + e.num_up,
+		 e.osds.begin() + e.num_up + e.num_acting);
+  *up_primary = e.up_primary;
+  *acting_primary = e.acting_primary;
+}
+
+void OSDMapMappingCache::note_incremental(const OSDMap& osdmap,
+					  const OSDMap::Incremental& inc)
+{
+  std::set<pg_t> pgs;
+  std::set<int> osds;
+  std::set<int64_t> moved_pools;
+  bool ok = OSDMapMapping::get_incremental_changes(osdmap, inc, &pgs, &osds,
+						   &moved_pools);
+  for (auto& p : inc.new_pools) {
+    moved_pools.insert(p.first);
+  }
+  moved_pools.insert(inc.old_pools.begin(), inc.old_pools.end());
+  for (auto& shard : shards) {
+    std::lock_guard<std::mutex> l(shard.lock);
+    if (shard.epoch + 1 != inc.epoch || !ok) {
+      shard.pgs.clear();
+      shard.epoch = osdmap.get_epoch();
+      continue;
+    }
+    shard.epoch = inc.epoch;
+    if (pgs.empty() && osds.empty() && moved_pools.empty()) {
+      continue;
+    }
+    for (auto p = shard.pgs.begin(); p != shard.pgs.end(); ) {
+      bool drop = moved_pools.count(p->first.pool()) || pgs.count(p->first);
+      for (auto i = osds.begin(); !drop && i != osds.end(); ++i) {
+	drop = p->second.references(*i);
+      }
+      if (drop) {
+	p = shard.pgs.erase(p);
+      } else {
+	++p;
+      }
+    }
+  }
+}
+
+void OSDMapMappingCache::clear()
+{
+  for (auto& shard : shards) {
+    std::lock_guard<std::mutex> l(shard.lock);
+    shard.pgs.clear();
+    shard.epoch = 0;
+  }
+}
+
+size_t OSDMapMappingCache::size()
+{
+  size_t n = 0;
+  for (auto& shard : shards) {
+    std::lock_guard<std::mutex> l(shard.lock);
+    n += shard.pgs.size();
+  }
+  return n;
 }
 
 // ---------------------------
@@ -146,9 +525,15 @@ void ParallelPGMapper::Job::finish_one()
 
 void ParallelPGMapper::WQ::_process(Item *i, ThreadPool::TPHandle &h)
 {
-  ldout(m->cct, 20) << __func__ << " " << i->job << " " << i->pool
-		    << " [" << i->begin << "," << i->end << ")" << dendl;
-  i->job->process(i->pool, i->begin, i->end);
+  if (!i->pss.empty()) {
+    ldout(m->cct, 20) << __func__ << " " << i->job << " " << i->pool
+		      << " " << i->pss.size() << " pgs" << dendl;
+    i->job->process(i->pool, i->pss);
+  } else {
+    ldout(m->cct, 20) << __func__ << " " << i->job << " " << i->pool
+		      << " [" << i->begin << "," << i->end << ")" << dendl;
+    i->job->process(i->pool, i->begin, i->end);
+  }
   i->job->finish_one();
   delete i;
 }
@@ -167,3 +552,24 @@ void ParallelPGMapper::queue(
     }
   }
 }
+
+void ParallelPGMapper::queue(
+  Job *job,
+  unsigned pgs_per_item,
+  const std::map<int64_t,std::vector<unsigned>>& pgs)
+{
+  // hold a ref so that the job cannot complete while we are queueing
+  // (or, if there is nothing to do, so that it completes right away)
+  job->start_one();
+  for (auto& p : pgs) {
+    for (auto q = p.second.begin(); q != p.second.end(); ) {
+      auto e = q + MIN((size_t)pgs_per_item, (size_t)(p.second.end() - q));
+      job->start_one();
+      wq.queue(new Item(job, p.first, std::vector<unsigned>(q, e)));
+      ldout(cct, 20) << __func__ << " " << job << " " << p.first << " "
+		     << (e - q) << " pgs" << dendl;
+      q = e;
+    }
+  }
+  job->finish_one();
+}
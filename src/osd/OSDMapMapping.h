@@ -7,12 +7,14 @@
 
 #include <vector>
 #include <map>
+#include <set>
+#include <mutex>
+#include <algorithm>
 
 #include "osd/osd_types.h"
+#include "osd/OSDMap.h"
 #include "common/WorkQueue.h"
 
-class OSDMap;
-
 /// work queue to perform work on batches of pgids on multiple CPUs
 class ParallelPGMapper {
 public:
@@ -35,6 +37,13 @@ public:
     virtual void process(int64_t poolid, unsigned ps_begin, unsigned ps_end) = 0;
     virtual void complete() = 0;
 
+    // sparse variant; override if there is something smarter to do
+    virtual void process(int64_t poolid, const std::vector<unsigned>& pss) {
+      for (auto ps : pss) {
+	process(poolid, ps, ps + 1);
+      }
+    }
+
     void set_finish_event(Context *fin) {
       lock.Lock();
       if (shards == 0) {
@@ -102,12 +111,19 @@ protected:
     Job *job;
     int64_t pool;
     unsigned begin, end;
+    std::vector<unsigned> pss;  ///< explicit list of ps (if non-empty)
 
     Item(Job *j, int64_t p, unsigned b, unsigned e)
       : job(j),
 	pool(p),
 	begin(b),
 	end(e) {}
+    Item(Job *j, int64_t p, std::vector<unsigned>&& v)
+      : job(j),
+	pool(p),
+	begin(0),
+	end(0),
+	pss(std::move(v)) {}
   };
   std::deque<Item*> q;
 
@@ -159,6 +175,12 @@ public:
     Job *job,
     unsigned pgs_per_item);
 
+  /// queue only the given pgs (pool -> sorted ps list)
+  void queue(
+    Job *job,
+    unsigned pgs_per_item,
+    const std::map<int64_t,std::vector<unsigned>>& pgs);
+
   void drain() {
     wq.drain();
   }
@@ -178,14 +200,22 @@ private:
     unsigned pg_num = 0;
     mempool::osdmap_mapping::vector<int32_t> table;
 
+    // the remaining pool properties that feed into the mapping; if
+    // any of these change every pg in the pool is remapped
+    unsigned pgp_num = 0;
+    int crush_ruleset = -1;
+    uint64_t hashpspool = 0;
+
     size_t row_size() const {
       return
 	1 + // acting_primary
 	1 + // up_primary
 	1 + // num acting
 	1 + // num up
+	1 + // num raw
 	size + // acting
-	size;  // up
+	size + // up
+	size;  // raw (crush + upmap, before up/down filtering)
     }
 
     PoolMapping(int s, int p)
@@ -209,18 +239,19 @@ private:
       if (acting) {
 	acting->resize(row[2]);
 	for (int i = 0; i < row[2]; ++i) {
-	  (*acting)[i] = row[4 + i];
+	  (*acting)[i] = row[5 + i];
 	}
       }
       if (up) {
 	up->resize(row[3]);
 	for (int i = 0; i < row[3]; ++i) {
-	  (*up)[i] = row[4 + size + i];
+	  (*up)[i] = row[5 + size + i];
 	}
       }
     }
 
     void set(size_t ps,
+	     const std::vector<int>& raw,
 	     const std::vector<int>& up,
 	     int up_primary,
 	     const std::vector<int>& acting,
@@ -230,13 +261,35 @@ private:
       row[1] = up_primary;
       row[2] = acting.size();
       row[3] = up.size();
+      row[4] = MIN(raw.size(), size);
       for (int i = 0; i < row[2]; ++i) {
-	row[4 + i] = acting[i];
+	row[5 + i] = acting[i];
       }
       for (int i = 0; i < row[3]; ++i) {
-	row[4 + size + i] = up[i];
+	row[5 + size + i] = up[i];
+      }
+      for (int i = 0; i < row[4]; ++i) {
+	row[5 + 2 * size + i] = raw[i];
       }
     }
+
+    /// true if the osd appears anywhere in the raw, up or acting set
+    bool references(size_t ps, int osd) const {
+      const int32_t *row = &table[row_size() * ps];
+      for (int i = 0; i < row[2]; ++i) {
+	if (row[5 + i] == osd)
+	  return true;
+      }
+      for (int i = 0; i < row[3]; ++i) {
+	if (row[5 + size + i] == osd)
+	  return true;
+      }
+      for (int i = 0; i < row[4]; ++i) {
+	if (row[5 + 2 * size + i] == osd)
+	  return true;
+      }
+      return false;
+    }
   };
 
   mempool::osdmap_mapping::map<int64_t,PoolMapping> pools;
@@ -246,17 +299,38 @@ private:
   epoch_t epoch;
   uint64_t num_pgs = 0;
 
+  // incremental update state.  as long as every incremental since the
+  // last completed update has been passed to note_incremental(), the
+  // next update only needs to remap the pgs collected here.
+  bool need_full = true;      ///< next update must remap everything
+  epoch_t noted_epoch = 0;    ///< last epoch accounted for in dirty_*
+  std::set<int64_t> dirty_pools;                   ///< remap whole pool
+  std::map<int64_t,std::set<unsigned>> dirty_pgs;  ///< pool -> ps
+  CephContext *check_cct = nullptr;  ///< verify incremental updates
+
   void _init_mappings(const OSDMap& osdmap);
   void _update_range(
     const OSDMap& map,
     int64_t pool,
     unsigned pg_begin, unsigned pg_end);
+  void _update_pgs(
+    const OSDMap& map,
+    int64_t pool,
+    const std::vector<unsigned>& pss);
 
   void _build_rmap(const OSDMap& osdmap);
 
   void _start(const OSDMap& osdmap) {
     _init_mappings(osdmap);
   }
+  bool _can_update_incrementally(const OSDMap& osdmap) const {
+    return !need_full && noted_epoch == osdmap.get_epoch();
+  }
+  void _get_dirty(const OSDMap& osdmap,
+		  std::map<int64_t,std::vector<unsigned>> *pgs) const;
+  void _mark_dirty(pg_t pgid) {
+    dirty_pgs[pgid.pool()].insert(pgid.ps());
+  }
   void _finish(const OSDMap& osdmap);
 
   void _dump();
@@ -265,13 +339,22 @@ private:
 
   struct MappingJob : public ParallelPGMapper::Job {
     OSDMapMapping *mapping;
+    bool incremental = false;
+    std::map<int64_t,std::vector<unsigned>> pgs;  ///< if incremental
     MappingJob(const OSDMap *osdmap, OSDMapMapping *m)
       : Job(osdmap), mapping(m) {
       mapping->_start(*osdmap);
+      if (mapping->_can_update_incrementally(*osdmap)) {
+	incremental = true;
+	mapping->_get_dirty(*osdmap, &pgs);
+      }
     }
     void process(int64_t pool, unsigned ps_begin, unsigned ps_end) override {
       mapping->_update_range(*osdmap, pool, ps_begin, ps_end);
     }
+    void process(int64_t pool, const std::vector<unsigned>& pss) override {
+      mapping->_update_pgs(*osdmap, pool, pss);
+    }
     void complete() override {
       mapping->_finish(*osdmap);
     }
@@ -300,15 +383,69 @@ public:
   }
   */
 
+  /**
+   * Record which pgs an incremental may have remapped.
+   *
+   * @param map the OSDMap *after* inc has been applied to it
+   *
+   * If this is called for every incremental since the last update
+   * completed, the next start_update() or update_incremental() only
+   * remaps the affected pgs instead of every pg in the cluster.  Any
+   * gap in the sequence falls back to a full update.
+   */
+  void note_incremental(const OSDMap& map, const OSDMap::Incremental& inc);
+
+  /**
+   * Work out which pg mappings an incremental may have changed.
+   *
+   * @param map the OSDMap *after* inc has been applied to it
+   * @param pgs [out] pgs that may have been remapped
+   * @param osds [out] osds that may change any pg they appear in
+   * @param pools [out] pools whose pgs may all have been remapped
+   * @return false if any pg may have been remapped
+   *
+   * Changes to the pools themselves are left to the caller.
+   */
+  static bool get_incremental_changes(const OSDMap& map,
+				      const OSDMap::Incremental& inc,
+				      std::set<pg_t> *pgs,
+				      std::set<int> *osds,
+				      std::set<int64_t> *pools);
+
+  /// forget pending incremental state; the next update remaps everything
+  void mark_stale() {
+    need_full = true;
+  }
+
+  /// verify each incremental update against a full recompute (slow!)
+  void set_check_incremental(CephContext *cct) {
+    check_cct = cct;
+  }
+
+  /**
+   * Compare the current mapping against a fresh calculation.
+   *
+   * @param ss [out] description of any mismatches
+   * @return number of pgs that differ
+   */
+  unsigned check(const OSDMap& map, std::ostream *ss) const;
+
   void update(const OSDMap& map);
   void update(const OSDMap& map, pg_t pgid);
 
+  /// synchronous update, remapping only noted pgs if possible
+  void update_incremental(const OSDMap& map);
+
   std::unique_ptr<MappingJob> start_update(
     const OSDMap& map,
     ParallelPGMapper& mapper,
     unsigned pgs_per_item) {
     std::unique_ptr<MappingJob> job(new MappingJob(&map, this));
-    mapper.queue(job.get(), pgs_per_item);
+    if (job->incremental) {
+      mapper.queue(job.get(), pgs_per_item, job->pgs);
+    } else {
+      mapper.queue(job.get(), pgs_per_item);
+    }
     return job;
   }
 
@@ -322,4 +459,63 @@ public:
 };
 
 
+/**
+ * sparse, lazily filled cache of pg mappings
+ *
+ * Clients only ever talk to a small fraction of the pgs in a large
+ * cluster, so rather than precalculating every pg (as OSDMapMapping
+ * does) we remember the mappings we have calculated and drop just
+ * the ones each incremental may have changed.  get() may be called
+ * concurrently; note_incremental() must not race with get().
+ */
+class OSDMapMappingCache {
+public:
+  MEMPOOL_CLASS_HELPERS();
+private:
+  struct Entry {
+    int32_t up_primary = -1;
+    int32_t acting_primary = -1;
+    uint8_t num_up = 0;
+    uint8_t num_acting = 0;
+    mempool::osdmap_mapping::vector<int32_t> osds;  ///< up + acting + raw
+
+    bool references(int osd) const {
+      return std::find(osds.begin(), osds.end(), osd) != osds.end();
+    }
+  };
+
+  struct Shard {
+    std::mutex lock;
+    epoch_t epoch = 0;  ///< entries are valid for this epoch
+    mempool::osdmap_mapping::unordered_map<pg_t,Entry> pgs;
+  };
+
+  static const unsigned num_shards = 16;
+  Shard shards[num_shards];
+  size_t max_per_shard;
+
+  Shard& _get_shard(pg_t pgid) {
+    return shards[std::hash<pg_t>()(pgid) % num_shards];
+  }
+
+public:
+  explicit OSDMapMappingCache(size_t max_pgs)
+    : max_per_shard(MAX(1u, max_pgs / num_shards)) {}
+
+  /// look up (and possibly calculate) the mapping for an actual pgid
+  void get(const OSDMap& map,
+	   pg_t pgid,
+	   std::vector<int> *up,
+	   int *up_primary,
+	   std::vector<int> *acting,
+	   int *acting_primary);
+
+  /// drop entries inc may have changed (map is *after* applying inc)
+  void note_incremental(const OSDMap& map, const OSDMap::Incremental& inc);
+
+  void clear();
+  size_t size();
+};
+
+
 #endif
@@ -2121,9 +2121,10 @@ void PG::_finish_recovery(Context *c)
   unlock();
 }
 
-void PG::start_recovery_op(const hobject_t& soid)
+void PG::start_recovery_op(const hobject_t& soid, bool small)
 {
   dout(10) << "start_recovery_op " << soid
+	   << (small ? " (small)" : "")
 #ifdef DEBUG_RECOVERY_OIDS
 	   << " (" << recovering_oids << ")"
 #endif
@@ -2134,7 +2135,17 @@ void PG::start_recovery_op(const hobject_t& soid)
   assert(recovering_oids.count(soid) == 0);
   recovering_oids.insert(soid);
 #endif
-  osd->start_recovery_op(this, soid);
+  if (small) {
+    // small objects are charged to the osd a batch at a time
+    uint64_t batch = MAX(1, cct->_conf->osd_recovery_small_object_batch);
+    small_recovering.insert(soid);
+    if (small_recovery_charged * batch < small_recovering.size()) {
+      ++small_recovery_charged;
+      osd->start_recovery_batch(this);
+    }
+  } else {
+    osd->start_recovery_op(this, soid);
+  }
 }
 
 void PG::finish_recovery_op(const hobject_t& soid, bool dequeue)
@@ -2150,13 +2161,35 @@ void PG::finish_recovery_op(const hobject_t& soid, bool dequeue)
   assert(recovering_oids.count(soid));
   recovering_oids.erase(soid);
 #endif
-  osd->finish_recovery_op(this, soid, dequeue);
+  auto p = small_recovering.find(soid);
+  if (p != small_recovering.end()) {
+    small_recovering.erase(p);
+    osd->logger->inc(l_osd_recovery_small_objects);
+    uint64_t batch = MAX(1, cct->_conf->osd_recovery_small_object_batch);
+    if (small_recovery_charged > 0 &&
+	(small_recovery_charged - 1) * batch >= small_recovering.size()) {
+      --small_recovery_charged;
+      osd->finish_recovery_batch(this, dequeue);
+    }
+  } else {
+    osd->finish_recovery_op(this, soid, dequeue);
+  }
 
   if (!dequeue) {
     queue_recovery();
   }
 }
 
+bool PG::is_small_recovery(const ObjectContextRef& obc) const
+{
+  uint64_t max_size = cct->_conf->osd_recovery_small_object_size;
+  return max_size &&
+    cct->_conf->osd_recovery_small_object_batch > 1 &&
+    obc &&
+    obc->obs.oi.size <= max_size &&
+    !obc->obs.oi.is_omap();
+}
+
 void PG::split_into(pg_t child_pgid, PG *child, unsigned split_bits)
 {
   child->update_snap_mapper_bits(split_bits);
@@ -2391,9 +2424,17 @@ void PG::clear_recovery_state()
   while (recovery_ops_active > 0) {
 #ifdef DEBUG_RECOVERY_OIDS
     soid = *recovering_oids.begin();
+#else
+    soid = small_recovering.empty() ? hobject_t() : *small_recovering.begin();
 #endif
     finish_recovery_op(soid, true);
   }
+  assert(small_recovering.empty());
+  // osd_recovery_small_object_batch may have changed under us
+  while (small_recovery_charged > 0) {
+    --small_recovery_charged;
+    osd->finish_recovery_batch(this, true);
+  }
 
   backfill_targets.clear();
   backfill_info.clear();
@@ -4201,12 +4242,21 @@ void PG::replica_scrub(
  */
 void PG::scrub(epoch_t queued, ThreadPool::TPHandle &handle)
 {
-  if (cct->_conf->osd_scrub_sleep > 0 &&
-      (scrubber.state == PG::Scrubber::NEW_CHUNK ||
+  double sleep = 0;
+  if ((scrubber.state == PG::Scrubber::NEW_CHUNK ||
        scrubber.state == PG::Scrubber::INACTIVE) &&
-       scrubber.needs_sleep) {
+      scrubber.needs_sleep) {
+    sleep = cct->_conf->osd_scrub_sleep;
+    if (scrubber.chunk_bytes) {
+      // pay for the last chunk's reads out of the osd's scrub budget
+      sleep = MAX(sleep, osd->get_scrub_budget_delay(scrubber.chunk_bytes));
+      scrubber.chunk_bytes = 0;
+    }
+  }
+  if (sleep > 0) {
     ceph_assert(!scrubber.sleeping);
-    dout(20) << __func__ << " state is INACTIVE|NEW_CHUNK, sleeping" << dendl;
+    dout(20) << __func__ << " state is INACTIVE|NEW_CHUNK, sleeping "
+	     << sleep << dendl;
 
     // Do an async sleep so we don't block the op queue
     OSDService *osds = osd;
@@ -4234,8 +4284,7 @@ void PG::scrub(epoch_t queued, ThreadPool::TPHandle &handle)
           pg->unlock();
         });
     Mutex::Locker l(osd->scrub_sleep_lock);
-    osd->scrub_sleep_timer.add_event_after(cct->_conf->osd_scrub_sleep,
-                                           scrub_requeue_callback);
+    osd->scrub_sleep_timer.add_event_after(sleep, scrub_requeue_callback);
     scrubber.sleeping = true;
     scrubber.sleep_start = ceph_clock_now();
     return;
@@ -4547,6 +4596,11 @@ void PG::chunky_scrub(ThreadPool::TPHandle &handle)
           return;
         }
 
+        if (scrubber.deep) {
+	  for (auto& p : scrubber.primary_scrubmap.objects)
+	    scrubber.chunk_bytes += p.second.size;
+	}
+
         --scrubber.waiting_on;
         scrubber.waiting_on_whom.erase(pg_whoami);
 
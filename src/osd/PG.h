@@ -560,6 +560,8 @@ public:
   bool recovery_queued;
 
   int recovery_ops_active;
+  set<hobject_t> small_recovering;      ///< small objects being recovered
+  unsigned small_recovery_charged = 0;  ///< osd recovery ops held for them
   set<pg_shard_t> waiting_on_backfill;
 #ifdef DEBUG_RECOVERY_OIDS
   set<hobject_t> recovering_oids;
@@ -1146,8 +1148,10 @@ public:
   void clear_recovery_state();
   virtual void _clear_recovery_state() = 0;
   virtual void check_recovery_sources(const OSDMapRef& newmap) = 0;
-  void start_recovery_op(const hobject_t& soid);
+  void start_recovery_op(const hobject_t& soid, bool small=false);
   void finish_recovery_op(const hobject_t& soid, bool dequeue=false);
+  /// true if obc can be recovered as part of a batch of small objects
+  bool is_small_recovery(const ObjectContextRef& obc) const;
 
   void split_into(pg_t child_pgid, PG *child, unsigned split_bits);
   virtual void _split_into(pg_t child_pgid, PG *child, unsigned split_bits) = 0;
@@ -1205,6 +1209,7 @@ public:
     bool sleeping = false;
     bool needs_sleep = true;
     utime_t sleep_start;
+    uint64_t chunk_bytes = 0;  ///< deep scrub bytes read, not yet budgeted
 
     // flags to indicate explicitly requested scrubs (by admin)
     bool must_scrub, must_deep_scrub, must_repair;
@@ -1323,6 +1328,7 @@ public:
       sleeping = false;
       needs_sleep = true;
       sleep_start = utime_t();
+      chunk_bytes = 0;
     }
 
     void create_results(const hobject_t& obj);
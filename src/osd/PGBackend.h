@@ -145,6 +145,12 @@ typedef ceph::shared_ptr<const OSDMap> OSDMapRef;
        const = 0;
 
      virtual const pg_missing_tracker_t &get_local_missing() const = 0;
+     /// digest of peer's stale copy of oid, if we fetched one for backfill
+     virtual const object_block_digest_t *get_peer_block_digest(
+       const hobject_t &oid,
+       pg_shard_t peer) const {
+       return nullptr;
+     }
      virtual const map<pg_shard_t, pg_missing_t> &get_shard_missing()
        const = 0;
      virtual boost::optional<const pg_missing_const_i &> maybe_get_shard_missing(
@@ -232,6 +238,9 @@ typedef ceph::shared_ptr<const OSDMap> OSDMapRef;
      virtual void schedule_recovery_work(
        GenContext<ThreadPool::TPHandle&> *c) = 0;
 
+     /// run c with the pg locked after delay seconds, unless the pg reset
+     virtual void schedule_read_hedge(double delay, Context *c) = 0;
+
      virtual pg_shard_t whoami_shard() const = 0;
      int whoami() const {
        return whoami_shard().osd;
@@ -560,6 +569,14 @@ typedef ceph::shared_ptr<const OSDMap> OSDMapRef;
      uint32_t seed,
      ScrubMap::object &o,
      ThreadPool::TPHandle &handle) = 0;
+   /// digest the local copy of poid in blocks of block_size bytes
+   virtual int be_block_digest(
+     const hobject_t &poid,
+     uint32_t block_size,
+     object_block_digest_t *digest,
+     ThreadPool::TPHandle *handle = nullptr) {
+     return -EOPNOTSUPP;
+   }
 
    static PGBackend *build_pg_backend(
      const pg_pool_t &pool,
@@ -38,6 +38,8 @@ void PGLog::IndexedLog::split_out_child(
 {
   unindex();
   *target = pg_log_t::split_out_child(child_pgid, split_bits);
+  // dups carry no object, so both halves keep all of them
+  target->dups = dups;
   index();
   target->index();
   reset_rollback_info_trimmed_to_riter();
@@ -46,7 +48,9 @@ void PGLog::IndexedLog::split_out_child(
 void PGLog::IndexedLog::trim(
   CephContext* cct,
   eversion_t s,
-  set<eversion_t> *trimmed)
+  set<eversion_t> *trimmed,
+  set<string> *trimmed_dups,
+  eversion_t *write_from_dups)
 {
   if (complete_to != log.end() &&
       complete_to->version <= s) {
@@ -67,6 +71,16 @@ void PGLog::IndexedLog::trim(
 
     unindex(e);         // remove from index,
 
+    // remember the reqid past the tail for dup detection
+    if (write_from_dups && e.reqid_is_indexed() &&
+	cct->_conf->osd_pg_log_dups_tracked > 0) {
+      if (e.version < *write_from_dups)
+	*write_from_dups = e.version;
+      dups.push_back(pg_log_dup_t(e));
+      if (indexed_data & PGLOG_INDEXED_DUPS)
+	dup_index[e.reqid] = &(dups.back());
+    }
+
     if (rollback_info_trimmed_to_riter == log.rend() ||
 	e.version == rollback_info_trimmed_to_riter->version) {
       log.pop_front();
@@ -76,6 +90,20 @@ void PGLog::IndexedLog::trim(
     }
   }
 
+  while (write_from_dups &&
+	 dups.size() > cct->_conf->osd_pg_log_dups_tracked) {
+    pg_log_dup_t &d = dups.front();
+    generic_dout(20) << "trim dup " << d << dendl;
+    if (trimmed_dups)
+      trimmed_dups->insert(d.get_key_name());
+    if (indexed_data & PGLOG_INDEXED_DUPS) {
+      auto i = dup_index.find(d.reqid);
+      if (i != dup_index.end() && i->second == &d)
+	dup_index.erase(i);
+    }
+    dups.pop_front();
+  }
+
   // raise tail?
   if (tail < s)
     tail = s;
@@ -105,6 +133,8 @@ void PGLog::clear() {
   log.clear();
   log_keys_debug.clear();
   undirty();
+  // the dups are gone from memory; don't leave their keys behind
+  dirty_to_dups = eversion_t::max();
 }
 
 void PGLog::clear_info_log(
@@ -124,7 +154,7 @@ void PGLog::trim(
     assert(trim_to <= info.last_complete);
 
     dout(10) << "trim " << log << " to " << trim_to << dendl;
-    log.trim(cct, trim_to, &trimmed);
+    log.trim(cct, trim_to, &trimmed, &trimmed_dups, &write_from_dups);
     info.log_tail = log.tail;
   }
 }
@@ -446,6 +476,9 @@ void PGLog::write_log_and_missing(
 	     << ", dirty_from: " << dirty_from
 	     << ", writeout_from: " << writeout_from
 	     << ", trimmed: " << trimmed
+	     << ", dirty_to_dups: " << dirty_to_dups
+	     << ", write_from_dups: " << write_from_dups
+	     << ", trimmed_dups: " << trimmed_dups
 	     << ", clear_divergent_priors: " << clear_divergent_priors
 	     << dendl;
     _write_log_and_missing(
@@ -454,6 +487,9 @@ void PGLog::write_log_and_missing(
       dirty_from,
       writeout_from,
       trimmed,
+      dirty_to_dups,
+      write_from_dups,
+      trimmed_dups,
       missing,
       !touched_log,
       require_rollback,
@@ -495,6 +531,9 @@ void PGLog::write_log_and_missing(
     eversion_t(),
     eversion_t(),
     set<eversion_t>(),
+    eversion_t::max(),
+    eversion_t(),
+    set<string>(),
     missing,
     true, require_rollback, false, 0);
 }
@@ -598,13 +637,16 @@ void PGLog::_write_log_and_missing(
   eversion_t dirty_from,
   eversion_t writeout_from,
   const set<eversion_t> &trimmed,
+  eversion_t dirty_to_dups,
+  eversion_t write_from_dups,
+  const set<string> &trimmed_dups,
   const pg_missing_tracker_t &missing,
   bool touch_log,
   bool require_rollback,
   bool clear_divergent_priors,
   set<string> *log_keys_debug
   ) {
-  set<string> to_remove;
+  set<string> to_remove(trimmed_dups);
   for (set<eversion_t>::const_iterator i = trimmed.begin();
        i != trimmed.end();
        ++i) {
@@ -660,6 +702,23 @@ void PGLog::_write_log_and_missing(
     }
   }
 
+  if (dirty_to_dups != eversion_t()) {
+    // dup keys sort after all log entry keys, so this leaves those alone
+    pg_log_dup_t min, dirty_to;
+    dirty_to.version = dirty_to_dups;
+    t.omap_rmkeyrange(
+      coll, log_oid,
+      min.get_key_name(), dirty_to.get_key_name());
+  }
+  // dups are appended in version order, so only the tail needs writing
+  for (auto p = log.dups.rbegin();
+       p != log.dups.rend() && p->version >= write_from_dups;
+       ++p) {
+    bufferlist bl;
+    ::encode(*p, bl);
+    (*km)[p->get_key_name()].claim(bl);
+  }
+
   if (clear_divergent_priors) {
     //dout(10) << "write_log_and_missing: writing divergent_priors" << dendl;
     to_remove.insert("divergent_priors");
@@ -27,7 +27,8 @@ using namespace std;
 #define PGLOG_INDEXED_OBJECTS          (1 << 0)
 #define PGLOG_INDEXED_CALLER_OPS       (1 << 1)
 #define PGLOG_INDEXED_EXTRA_CALLER_OPS (1 << 2)
-#define PGLOG_INDEXED_ALL              (PGLOG_INDEXED_OBJECTS | PGLOG_INDEXED_CALLER_OPS | PGLOG_INDEXED_EXTRA_CALLER_OPS)
+#define PGLOG_INDEXED_DUPS             (1 << 3)
+#define PGLOG_INDEXED_ALL              (PGLOG_INDEXED_OBJECTS | PGLOG_INDEXED_CALLER_OPS | PGLOG_INDEXED_EXTRA_CALLER_OPS | PGLOG_INDEXED_DUPS)
 
 class CephContext;
 
@@ -83,6 +84,10 @@ public:
     mutable ceph::unordered_map<osd_reqid_t,pg_log_entry_t*> caller_ops;
     mutable ceph::unordered_multimap<osd_reqid_t,pg_log_entry_t*> extra_caller_ops;
 
+    /// index into dups, which are bounded by osd_pg_log_dups_tracked and
+    /// persisted as "dup_" keys in the pgmeta omap
+    mutable ceph::unordered_map<osd_reqid_t,pg_log_dup_t*> dup_index;
+
     // recovery pointers
     list<pg_log_entry_t>::iterator complete_to; // not inclusive of referenced item
     version_t last_requested = 0;               // last object requested by primary
@@ -207,7 +212,12 @@ public:
       assert(rollback_info_trimmed_to == head);
       assert(rollback_info_trimmed_to_riter == log.rbegin());
 
+      // trimmed reqids stay valid dups regardless of whose log we
+      // adopt; keep ours if o comes from a peer that does not send any
+      auto old_dups = std::move(dups);
       *this = IndexedLog(o);
+      if (dups.empty())
+	dups = std::move(old_dups);
 
       skip_can_rollback_to_to_head();
       index();
@@ -296,6 +306,18 @@ public:
 	}
 	assert(0 == "in extra_caller_ops but not extra_reqids");
       }
+
+      // finally, the reqids already trimmed out of the log
+      if (!(indexed_data & PGLOG_INDEXED_DUPS)) {
+        index_dups();
+      }
+      auto q = dup_index.find(r);
+      if (q != dup_index.end()) {
+	*version = q->second->version;
+	*user_version = q->second->user_version;
+	*return_code = q->second->return_code;
+	return true;
+      }
       return false;
     }
 
@@ -333,6 +355,8 @@ public:
 	caller_ops.clear();
       if (to_index & PGLOG_INDEXED_EXTRA_CALLER_OPS)
 	extra_caller_ops.clear();
+      if (to_index & PGLOG_INDEXED_DUPS)
+	dup_index.clear();
 
       for (list<pg_log_entry_t>::const_iterator i = log.begin();
 	   i != log.end();
@@ -358,6 +382,12 @@ public:
 	  }
 	}
       }
+
+      if (to_index & PGLOG_INDEXED_DUPS) {
+	for (auto i = dups.begin(); i != dups.end(); ++i) {
+	  dup_index[i->reqid] = const_cast<pg_log_dup_t*>(&(*i));
+	}
+      }
         
       indexed_data |= to_index;
     }
@@ -374,6 +404,10 @@ public:
       index(PGLOG_INDEXED_EXTRA_CALLER_OPS);
     }
 
+    void index_dups() const {
+      index(PGLOG_INDEXED_DUPS);
+    }
+
     void index(pg_log_entry_t& e) {
       if ((indexed_data & PGLOG_INDEXED_OBJECTS) && e.object_is_indexed()) {
         if (objects.count(e.soid) == 0 ||
@@ -398,6 +432,7 @@ public:
       objects.clear();
       caller_ops.clear();
       extra_caller_ops.clear();
+      dup_index.clear();
       indexed_data = 0;
     }
     void unindex(pg_log_entry_t& e) {
@@ -476,7 +511,9 @@ public:
     void trim(
       CephContext* cct,
       eversion_t s,
-      set<eversion_t> *trimmed);
+      set<eversion_t> *trimmed,
+      set<string> *trimmed_dups = nullptr,
+      eversion_t *write_from_dups = nullptr);
 
     ostream& print(ostream& out) const;
   };
@@ -492,6 +529,9 @@ protected:
   eversion_t dirty_from;       ///< must clear/writeout all keys >= dirty_from
   eversion_t writeout_from;    ///< must writout keys >= writeout_from
   set<eversion_t> trimmed;     ///< must clear keys in trimmed
+  eversion_t dirty_to_dups;    ///< must clear all dup keys < dirty_to_dups
+  eversion_t write_from_dups;  ///< must write dups >= write_from_dups
+  set<string> trimmed_dups;    ///< must clear dup keys in trimmed_dups
   CephContext *cct;
   bool pg_log_debug;
   /// Log is clean on [dirty_to, dirty_from)
@@ -517,13 +557,22 @@ public:
       (dirty_from != eversion_t::max()) ||
       (writeout_from != eversion_t::max()) ||
       !(trimmed.empty()) ||
+      (dirty_to_dups != eversion_t()) ||
+      (write_from_dups != eversion_t::max()) ||
+      !(trimmed_dups.empty()) ||
       !missing.is_clean();
   }
   void mark_log_for_rewrite() {
     mark_dirty_to(eversion_t::max());
     mark_dirty_from(eversion_t());
+    mark_dups_for_rewrite();
     touched_log = false;
   }
+  /// drop every dup key on disk and write out the ones in memory
+  void mark_dups_for_rewrite() {
+    dirty_to_dups = eversion_t::max();
+    write_from_dups = eversion_t();
+  }
 protected:
 
   /// DEBUG
@@ -549,7 +598,10 @@ protected:
     dirty_from = eversion_t::max();
     touched_log = true;
     trimmed.clear();
+    trimmed_dups.clear();
     writeout_from = eversion_t::max();
+    dirty_to_dups = eversion_t();
+    write_from_dups = eversion_t::max();
     check();
     missing.flush();
   }
@@ -559,6 +611,8 @@ public:
     prefix_provider(dpp),
     dirty_from(eversion_t::max()),
     writeout_from(eversion_t::max()),
+    dirty_to_dups(eversion_t()),
+    write_from_dups(eversion_t::max()),
     cct(cct),
     pg_log_debug(!(cct && !(cct->_conf->osd_debug_pg_log_writeout))),
     touched_log(false),
@@ -648,6 +702,7 @@ public:
     log.claim_log_and_clear_rollback_info(o);
     missing.clear();
     mark_dirty_to(eversion_t::max());
+    mark_dups_for_rewrite();
   }
 
   void split_into(
@@ -657,6 +712,7 @@ public:
     log.split_out_child(child_pgid, split_bits, &opg_log->log);
     missing.split_into(child_pgid, split_bits, &(opg_log->missing));
     opg_log->mark_dirty_to(eversion_t::max());
+    opg_log->mark_dups_for_rewrite();
     mark_dirty_to(eversion_t::max());
   }
 
@@ -1084,6 +1140,9 @@ public:
     eversion_t dirty_from,
     eversion_t writeout_from,
     const set<eversion_t> &trimmed,
+    eversion_t dirty_to_dups,
+    eversion_t write_from_dups,
+    const set<string> &trimmed_dups,
     const pg_missing_tracker_t &missing,
     bool touch_log,
     bool require_rollback,
@@ -1137,6 +1196,7 @@ public:
     map<eversion_t, hobject_t> divergent_priors;
     bool has_divergent_priors = false;
     list<pg_log_entry_t> entries;
+    mempool::osd_pglog::list<pg_log_dup_t> dups;
     if (p) {
       for (p->seek_to_first(); p->valid() ; p->next(false)) {
 	// non-log pgmeta_oid keys are prefixed with _; skip those
@@ -1158,6 +1218,13 @@ public:
 	  pair<hobject_t, pg_missing_item> p;
 	  ::decode(p, bp);
 	  missing.add(p.first, p.second.need, p.second.have);
+	} else if (p->key().substr(0, 4) == string("dup_")) {
+	  pg_log_dup_t dup;
+	  ::decode(dup, bp);
+	  if (!dups.empty()) {
+	    assert(dups.back().version < dup.version);
+	  }
+	  dups.push_back(dup);
 	} else {
 	  pg_log_entry_t e;
 	  e.decode_with_checksum(bp);
@@ -1179,6 +1246,10 @@ public:
       on_disk_can_rollback_to,
       on_disk_rollback_info_trimmed_to,
       std::move(entries));
+    log.dups = std::move(dups);
+    log.index(PGLOG_INDEXED_DUPS);
+    ldpp_dout(dpp, 20) << "read_log_and_missing " << log.dups.size()
+		       << " dups" << dendl;
 
     if (has_divergent_priors || debug_verify_stored_missing) {
       // build missing
@@ -500,6 +500,12 @@ void PrimaryLogPG::schedule_recovery_work(
   osd->recovery_gen_wq.queue(c);
 }
 
+void PrimaryLogPG::schedule_read_hedge(double delay, Context *c)
+{
+  Mutex::Locker l(osd->read_hedge_lock);
+  osd->read_hedge_timer.add_event_after(delay, bless_context(c));
+}
+
 void PrimaryLogPG::send_message_osd_cluster(
   int peer, Message *m, epoch_t from_epoch)
 {
@@ -3538,9 +3544,93 @@ void PrimaryLogPG::do_scan(
       }
     }
     break;
+
+  case MOSDPGScan::OP_SCAN_GET_BLOCK_DIGEST:
+    {
+      object_block_digest_t digest;
+      bufferlist bv;
+      int r = pgbackend->objects_get_attr(m->begin, OI_ATTR, &bv);
+      if (r >= 0) {
+	object_info_t oi(bv);
+	r = pgbackend->be_block_digest(
+	  m->begin, cct->_conf->osd_backfill_delta_block_size, &digest,
+	  &handle);
+	digest.version = oi.version;
+      }
+      if (r < 0) {
+	dout(10) << __func__ << " no block digest for " << m->begin
+		 << ": " << cpp_strerror(r) << dendl;
+	digest = object_block_digest_t();
+      }
+      MOSDPGScan *reply = new MOSDPGScan(
+	MOSDPGScan::OP_SCAN_BLOCK_DIGEST,
+	pg_whoami,
+	get_osdmap()->get_epoch(), m->query_epoch,
+	spg_t(info.pgid.pgid, get_primary().shard), m->begin, m->end);
+      ::encode(digest, reply->get_data());
+      osd->send_message_osd_cluster(reply, m->get_connection());
+    }
+    break;
+
+  case MOSDPGScan::OP_SCAN_BLOCK_DIGEST:
+    {
+      pg_shard_t from = m->from;
+      assert(is_backfill_targets(from));
+
+      object_block_digest_t digest;
+      bufferlist::iterator p = const_cast<bufferlist&>(m->get_data()).begin();
+      ::decode(digest, p);
+
+      // only useful if it is still the copy we decided to replace
+      BackfillInterval& pbi = peer_backfill_info[from];
+      auto i = pbi.objects.find(m->begin);
+      if (i == pbi.objects.end() || i->second != digest.version) {
+	dout(10) << __func__ << " ignoring " << digest << " of " << m->begin
+		 << " from " << from << dendl;
+	digest = object_block_digest_t();
+      }
+      backfill_block_digests[m->begin][from] = std::move(digest);
+
+      if (waiting_on_backfill.erase(from)) {
+	if (waiting_on_backfill.empty())
+	  finish_recovery_op(hobject_t::get_max());
+      }
+    }
+    break;
   }
 }
 
+bool PrimaryLogPG::request_backfill_block_digests(
+  ObjectContextRef obc,
+  const vector<pg_shard_t> &peers)
+{
+  const hobject_t& soid = obc->obs.oi.soid;
+  // pre-luminous osds drop the digest scan ops
+  if (!cct->_conf->osd_backfill_delta ||
+      get_osdmap()->require_osd_release < CEPH_RELEASE_LUMINOUS ||
+      !pool.info.is_replicated() ||
+      !soid.is_head() ||
+      obc->obs.oi.size < MAX(1, cct->_conf->osd_backfill_delta_min_size) ||
+      cct->_conf->osd_backfill_delta_block_size == 0)
+    return false;
+
+  auto& digests = backfill_block_digests[soid];
+  for (auto& peer : peers) {
+    if (digests.count(peer))
+      continue;
+    dout(10) << __func__ << " " << soid << " from " << peer << dendl;
+    epoch_t e = get_osdmap()->get_epoch();
+    MOSDPGScan *m = new MOSDPGScan(
+      MOSDPGScan::OP_SCAN_GET_BLOCK_DIGEST, pg_whoami, e, last_peering_reset,
+      spg_t(info.pgid.pgid, peer.shard),
+      soid, soid);
+    osd->send_message_osd_cluster(peer.osd, m, e);
+    assert(waiting_on_backfill.find(peer) == waiting_on_backfill.end());
+    waiting_on_backfill.insert(peer);
+  }
+  return !waiting_on_backfill.empty();
+}
+
 void PrimaryLogPG::do_backfill(OpRequestRef op)
 {
   const MOSDPGBackfill *m = static_cast<const MOSDPGBackfill*>(op->get_req());
@@ -10847,6 +10937,7 @@ void PrimaryLogPG::_clear_recovery_state()
   }
   assert(backfills_in_flight.empty());
   pending_backfill_updates.clear();
+  backfill_block_digests.clear();
   assert(recovering.empty());
   pgbackend->clear_recovery_state();
 }
@@ -11298,7 +11389,7 @@ int PrimaryLogPG::prep_object_replica_pushes(
 	     << dendl;
   }
 
-  start_recovery_op(soid);
+  start_recovery_op(soid, is_small_recovery(obc));
   assert(!recovering.count(soid));
   recovering.insert(make_pair(soid, obc));
 
@@ -11322,6 +11413,9 @@ uint64_t PrimaryLogPG::recover_replicas(uint64_t max, ThreadPool::TPHandle &hand
 {
   dout(10) << __func__ << "(" << max << ")" << dendl;
   uint64_t started = 0;
+  // small objects are counted against max a batch at a time
+  uint64_t small_batch = MAX(1, cct->_conf->osd_recovery_small_object_batch);
+  uint64_t small_started = 0;
 
   PGBackend::RecoveryHandle *h = pgbackend->open_recovery_op();
 
@@ -11387,8 +11481,14 @@ uint64_t PrimaryLogPG::recover_replicas(uint64_t max, ThreadPool::TPHandle &hand
 
       dout(10) << __func__ << ": recover_object_replicas(" << soid << ")" << dendl;
       map<hobject_t,pg_missing_item>::const_iterator r = m.get_items().find(soid);
-      started += prep_object_replica_pushes(soid, r->second.need,
-					    h);
+      if (!prep_object_replica_pushes(soid, r->second.need, h))
+	continue;
+      if (small_recovering.count(soid)) {
+	if (small_started++ % small_batch == 0)
+	  ++started;
+      } else {
+	++started;
+      }
     }
   }
 
@@ -11487,6 +11587,7 @@ uint64_t PrimaryLogPG::recover_backfill(
 
     backfills_in_flight.clear();
     pending_backfill_updates.clear();
+    backfill_block_digests.clear();
   }
 
   for (set<pg_shard_t>::iterator i = backfill_targets.begin();
@@ -11505,6 +11606,8 @@ uint64_t PrimaryLogPG::recover_backfill(
   update_range(&backfill_info, handle);
 
   unsigned ops = 0;
+  uint64_t small_batch = MAX(1, cct->_conf->osd_recovery_small_object_batch);
+  uint64_t small_pushes = 0;
   vector<boost::tuple<hobject_t, eversion_t,
                       ObjectContextRef, vector<pg_shard_t> > > to_push;
   vector<boost::tuple<hobject_t, eversion_t, pg_shard_t> > to_remove;
@@ -11683,6 +11786,13 @@ uint64_t PrimaryLogPG::recover_backfill(
       if (!need_ver_targs.empty() || !missing_targs.empty()) {
 	ObjectContextRef obc = get_object_context(backfill_info.begin, false);
 	assert(obc);
+	if (!need_ver_targs.empty() &&
+	    request_backfill_block_digests(obc, need_ver_targs)) {
+	  // come back to this object once the digests arrive, like a scan
+	  ops++;
+	  start_recovery_op(hobject_t::get_max());
+	  break;
+	}
 	if (obc->get_recovery_read()) {
 	  if (!need_ver_targs.empty()) {
 	    dout(20) << " BACKFILL replacing " << check
@@ -11697,11 +11807,13 @@ uint64_t PrimaryLogPG::recover_backfill(
 	  vector<pg_shard_t> all_push = need_ver_targs;
 	  all_push.insert(all_push.end(), missing_targs.begin(), missing_targs.end());
 
+	  // Count all simultaneous pushes of the same object as a single op,
+	  // and small objects as a single op per batch
+	  if (!is_small_recovery(obc) || small_pushes++ % small_batch == 0)
+	    ops++;
 	  to_push.push_back(
 	    boost::tuple<hobject_t, eversion_t, ObjectContextRef, vector<pg_shard_t> >
 	    (backfill_info.begin, obj_v, obc, all_push));
-	  // Count all simultaneous pushes of the same object as a single op
-	  ops++;
 	} else {
 	  *work_started = true;
 	  dout(20) << "backfill blocking on " << backfill_info.begin
@@ -11895,7 +12007,7 @@ void PrimaryLogPG::prep_backfill_object_push(
 
   assert(!recovering.count(oid));
 
-  start_recovery_op(oid);
+  start_recovery_op(oid, is_small_recovery(obc));
   recovering.insert(make_pair(oid, obc));
 
   // We need to take the read_lock here in order to flush in-progress writes
@@ -11907,6 +12019,7 @@ void PrimaryLogPG::prep_backfill_object_push(
     obc,
     h);
   obc->ondisk_read_unlock();
+  backfill_block_digests.erase(oid);
 }
 
 void PrimaryLogPG::update_range(
@@ -13982,6 +14095,7 @@ boost::statechart::result PrimaryLogPG::AwaitAsyncWork::react(const DoSnapWork&)
     }
 
     in_flight.insert(object);
+    ++context<Trimming>().trimmed;
     ctx->register_on_success(
       [pg, object, &in_flight]() {
 	assert(in_flight.find(object) != in_flight.end());
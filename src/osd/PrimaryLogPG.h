@@ -322,6 +322,17 @@ public:
   const pg_missing_tracker_t &get_local_missing() const override {
     return pg_log.get_missing();
   }
+  const object_block_digest_t *get_peer_block_digest(
+    const hobject_t &oid,
+    pg_shard_t peer) const override {
+    auto i = backfill_block_digests.find(oid);
+    if (i == backfill_block_digests.end())
+      return nullptr;
+    auto j = i->second.find(peer);
+    if (j == i->second.end() || j->second.empty())
+      return nullptr;
+    return &j->second;
+  }
   const PGLog &get_log() const override {
     return pg_log;
   }
@@ -422,6 +433,8 @@ public:
   void schedule_recovery_work(
     GenContext<ThreadPool::TPHandle&> *c) override;
 
+  void schedule_read_hedge(double delay, Context *c) override;
+
   pg_shard_t whoami_shard() const override {
     return pg_whoami;
   }
@@ -1010,6 +1023,11 @@ protected:
   set<hobject_t> backfills_in_flight;
   map<hobject_t, pg_stat_t> pending_backfill_updates;
 
+  /// digests of backfill targets' stale copies (osd_backfill_delta)
+  map<hobject_t, map<pg_shard_t, object_block_digest_t>> backfill_block_digests;
+  bool request_backfill_block_digests(
+    ObjectContextRef obc, const vector<pg_shard_t> &peers);
+
   void dump_recovery_info(Formatter *f) const override {
     f->open_array_section("backfill_targets");
     for (set<pg_shard_t>::const_iterator p = backfill_targets.begin();
@@ -1497,6 +1515,7 @@ private:
 
     set<hobject_t> in_flight;
     snapid_t snap_to_trim;
+    unsigned trimmed = 0;  ///< objects trimmed since the last WaitTrimTimer
 
     explicit Trimming(my_context ctx)
       : my_base(ctx),
@@ -1540,11 +1559,15 @@ private:
 	}
       };
       auto *pg = context< SnapTrimmer >().pg;
-      if (pg->cct->_conf->osd_snap_trim_sleep > 0) {
+      // pay for the last round against the osd-wide trim rate
+      double sleep = MAX(
+	pg->cct->_conf->osd_snap_trim_sleep,
+	pg->osd->get_snap_trim_budget_delay(context<Trimming>().trimmed));
+      context<Trimming>().trimmed = 0;
+      if (sleep > 0) {
 	wakeup = new OnTimer{pg, pg->get_osdmap()->get_epoch()};
 	Mutex::Locker l(pg->osd->snap_sleep_lock);
-	pg->osd->snap_sleep_timer.add_event_after(
-	  pg->cct->_conf->osd_snap_trim_sleep, wakeup);
+	pg->osd->snap_sleep_timer.add_event_after(sleep, wakeup);
       } else {
 	post_event(SnapTrimTimerReady());
       }
@@ -12,6 +12,7 @@
  *
  */
 #include "common/errno.h"
+#include "common/ceph_crypto.h"
 #include "ReplicatedBackend.h"
 #include "messages/MOSDOp.h"
 #include "messages/MOSDSubOp.h"
@@ -699,6 +700,43 @@ void ReplicatedBackend::do_repop_reply(OpRequestRef op)
   }
 }
 
+int ReplicatedBackend::be_block_digest(
+  const hobject_t &poid,
+  uint32_t block_size,
+  object_block_digest_t *digest,
+  ThreadPool::TPHandle *handle)
+{
+  assert(block_size > 0);
+  ghobject_t goid(poid, ghobject_t::NO_GEN,
+		  get_parent()->whoami_shard().shard);
+  struct stat st;
+  int r = store->stat(ch, goid, &st, true);
+  if (r < 0)
+    return r;
+  digest->size = st.st_size;
+  digest->block_size = block_size;
+  digest->blocks.clear();
+
+  uint32_t fadvise_flags = CEPH_OSD_OP_FLAG_FADVISE_SEQUENTIAL |
+    CEPH_OSD_OP_FLAG_FADVISE_DONTNEED;
+  ceph::crypto::SHA1 sha1;
+  unsigned char fp[CEPH_CRYPTO_SHA1_DIGESTSIZE];
+  for (uint64_t pos = 0; pos < digest->size; pos += block_size) {
+    if (handle)
+      handle->reset_tp_timeout();
+    bufferlist bl;
+    r = store->read(ch, goid, pos, block_size, bl, fadvise_flags, true);
+    if (r < 0)
+      return r;
+    for (auto& p : bl.buffers())
+      sha1.Update((const unsigned char *)p.c_str(), p.length());
+    sha1.Final(fp);
+    digest->blocks.push_back(string((const char *)fp, sizeof(fp)));
+  }
+  dout(10) << __func__ << " " << poid << " " << *digest << dendl;
+  return 0;
+}
+
 void ReplicatedBackend::be_deep_scrub(
   const hobject_t &poid,
   uint32_t seed,
@@ -707,7 +745,8 @@ void ReplicatedBackend::be_deep_scrub(
 {
   dout(10) << __func__ << " " << poid << " seed " 
 	   << std::hex << seed << std::dec << dendl;
-  bufferhash h(seed), oh(seed);
+  uint32_t data_crc = seed;
+  bufferhash oh(seed);
   bufferlist bl, hdrbl;
   int r;
   __u64 pos = 0;
@@ -716,19 +755,16 @@ void ReplicatedBackend::be_deep_scrub(
 
   while (true) {
     handle.reset_tp_timeout();
-    r = store->read(
+    r = store->read_digest(
 	  ch,
 	  ghobject_t(
 	    poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
 	  pos,
-	  cct->_conf->osd_deep_scrub_stride, bl,
+	  cct->_conf->osd_deep_scrub_stride, &data_crc,
 	  fadvise_flags, true);
     if (r <= 0)
       break;
-
-    h << bl;
-    pos += bl.length();
-    bl.clear();
+    pos += r;
   }
   if (r == -EIO) {
     dout(25) << __func__ << "  " << poid << " got "
@@ -736,7 +772,7 @@ void ReplicatedBackend::be_deep_scrub(
     o.read_error = true;
     return;
   }
-  o.digest = h.digest();
+  o.digest = data_crc;
   o.digest_present = true;
 
   bl.clear();
@@ -1476,7 +1512,8 @@ void ReplicatedBackend::prepare_pull(
  */
 void ReplicatedBackend::prep_push_to_replica(
   ObjectContextRef obc, const hobject_t& soid, pg_shard_t peer,
-  PushOp *pop, bool cache_dont_need)
+  PushOp *pop, bool cache_dont_need,
+  object_block_digest_t *local_digest)
 {
   const object_info_t& oi = obc->obs.oi;
   uint64_t size = obc->obs.oi.size;
@@ -1535,6 +1572,16 @@ void ReplicatedBackend::prep_push_to_replica(
       get_parent()->get_shard_info().find(peer)->second.last_backfill,
       data_subset, clone_subsets,
       lock_manager);
+
+    // or on the backfill target's own stale copy?
+    const object_block_digest_t *peer_digest =
+      get_parent()->get_peer_block_digest(soid, peer);
+    if (peer_digest && clone_subsets.empty()) {
+      object_block_digest_t digest;
+      calc_delta_subsets(obc, soid, *peer_digest,
+			 local_digest ? *local_digest : digest,
+			 data_subset, clone_subsets);
+    }
   }
 
   prep_push(
@@ -1608,8 +1655,11 @@ void ReplicatedBackend::submit_push_data(
   const map<string, bufferlist> &omap_entries,
   ObjectStore::Transaction *t)
 {
+  // a delta push reuses extents of the existing copy, so build the new
+  // one beside it
+  bool clone_self = recovery_info.clone_subset.count(recovery_info.soid);
   hobject_t target_oid;
-  if (first && complete) {
+  if (first && complete && !clone_self) {
     target_oid = recovery_info.soid;
   } else {
     target_oid = get_parent()->get_temp_recovery_object(recovery_info.soid,
@@ -1655,10 +1705,21 @@ void ReplicatedBackend::submit_push_data(
     t->setattrs(coll, ghobject_t(target_oid), attrs);
 
   if (complete) {
-    if (!first) {
+    if (target_oid != recovery_info.soid) {
       dout(10) << __func__ << ": Removing oid "
 	       << target_oid << " from the temp collection" << dendl;
       clear_temp_obj(target_oid);
+      if (clone_self) {
+	const interval_set<uint64_t>& same =
+	  recovery_info.clone_subset.at(recovery_info.soid);
+	for (auto q = same.begin(); q != same.end(); ++q) {
+	  dout(15) << " clone_range " << recovery_info.soid << " "
+		   << q.get_start() << "~" << q.get_len() << dendl;
+	  t->clone_range(coll, ghobject_t(recovery_info.soid),
+			 ghobject_t(target_oid),
+			 q.get_start(), q.get_len(), q.get_start());
+	}
+      }
       t->remove(coll, ghobject_t(recovery_info.soid));
       t->collection_move_rename(coll, ghobject_t(target_oid),
 				coll, ghobject_t(recovery_info.soid));
@@ -1676,6 +1737,8 @@ void ReplicatedBackend::submit_push_complete(
 	 recovery_info.clone_subset.begin();
        p != recovery_info.clone_subset.end();
        ++p) {
+    if (p->first == recovery_info.soid)
+      continue;  // cloned in submit_push_data
     for (interval_set<uint64_t>::const_iterator q = p->second.begin();
 	 q != p->second.end();
 	 ++q) {
@@ -1687,6 +1750,45 @@ void ReplicatedBackend::submit_push_complete(
   }
 }
 
+void ReplicatedBackend::calc_delta_subsets(
+  ObjectContextRef obc, const hobject_t& soid,
+  const object_block_digest_t& peer_digest,
+  object_block_digest_t& digest,
+  interval_set<uint64_t>& data_subset,
+  map<hobject_t, interval_set<uint64_t>>& clone_subsets)
+{
+  // digest is shared by all targets of this push; only read it once
+  if (digest.block_size != peer_digest.block_size) {
+    int r = be_block_digest(soid, peer_digest.block_size, &digest);
+    if (r < 0) {
+      dout(10) << __func__ << " " << soid << " got " << cpp_strerror(r)
+	       << ", pushing whole object" << dendl;
+      digest = object_block_digest_t();
+      return;
+    }
+  }
+  assert(digest.size == obc->obs.oi.size);
+
+  interval_set<uint64_t> same;
+  unsigned n = MIN(digest.blocks.size(), peer_digest.blocks.size());
+  for (unsigned i = 0; i < n; ++i) {
+    uint64_t len = digest.block_length(i);
+    if (len == peer_digest.block_length(i) &&
+	digest.blocks[i] == peer_digest.blocks[i])
+      same.union_insert((uint64_t)i * digest.block_size, len);
+  }
+  same.intersection_of(data_subset);
+  if (same.empty())
+    return;
+
+  // the replica builds the new copy from these extents of its old one
+  data_subset.subtract(same);
+  clone_subsets[soid] = same;
+  dout(10) << __func__ << " " << soid << " reusing " << same.size()
+	   << " of " << digest.size << " bytes on the replica, pushing "
+	   << data_subset << dendl;
+}
+
 ObjectRecoveryInfo ReplicatedBackend::recalc_subsets(
   const ObjectRecoveryInfo& recovery_info,
   SnapSetContext *ssc,
@@ -1845,6 +1947,11 @@ void ReplicatedBackend::handle_push(
 
 void ReplicatedBackend::send_pushes(int prio, map<pg_shard_t, vector<PushOp> > &pushes)
 {
+  // a whole small object counts as 1/small_batch of a push, so that
+  // many of them share one message (and one transaction on the replica)
+  uint64_t small_size = cct->_conf->osd_recovery_small_object_size;
+  uint64_t small_batch = MAX(1, cct->_conf->osd_recovery_small_object_batch);
+  uint64_t max_weight = cct->_conf->osd_max_push_objects * small_batch;
   for (map<pg_shard_t, vector<PushOp> >::iterator i = pushes.begin();
        i != pushes.end();
        ++i) {
@@ -1856,7 +1963,7 @@ void ReplicatedBackend::send_pushes(int prio, map<pg_shard_t, vector<PushOp> > &
     vector<PushOp>::iterator j = i->second.begin();
     while (j != i->second.end()) {
       uint64_t cost = 0;
-      uint64_t pushes = 0;
+      uint64_t weight = 0;
       MOSDPGPush *msg = new MOSDPGPush();
       msg->from = get_parent()->whoami_shard();
       msg->pgid = get_parent()->primary_spg_t();
@@ -1866,12 +1973,20 @@ void ReplicatedBackend::send_pushes(int prio, map<pg_shard_t, vector<PushOp> > &
       for (;
            (j != i->second.end() &&
 	    cost < cct->_conf->osd_max_push_cost &&
-	    pushes < cct->_conf->osd_max_push_objects) ;
+	    weight < max_weight) ;
 	   ++j) {
 	dout(20) << __func__ << ": sending push " << *j
 		 << " to osd." << i->first << dendl;
 	cost += j->cost(cct);
-	pushes += 1;
+	if (small_size &&
+	    j->before_progress.first &&
+	    j->after_progress.data_complete &&
+	    j->after_progress.omap_complete &&
+	    j->omap_entries.empty() &&
+	    j->data.length() <= small_size)
+	  weight += 1;
+	else
+	  weight += small_batch;
 	msg->pushes.push_back(*j);
       }
       msg->set_cost(cost);
@@ -2217,6 +2332,7 @@ int ReplicatedBackend::start_pushes(
   RPGHandle *h)
 {
   int pushes = 0;
+  object_block_digest_t local_digest;
   // who needs it?
   assert(get_parent()->get_actingbackfill_shards().size() > 0);
   for (set<pg_shard_t>::iterator i =
@@ -2232,7 +2348,8 @@ int ReplicatedBackend::start_pushes(
       ++pushes;
       h->pushes[peer].push_back(PushOp());
       prep_push_to_replica(obc, soid, peer,
-			   &(h->pushes[peer].back()), h->cache_dont_need);
+			   &(h->pushes[peer].back()), h->cache_dont_need,
+			   &local_digest);
     }
   }
   return pushes;
@@ -299,7 +299,8 @@ private:
     RPGHandle *h);
   void prep_push_to_replica(
     ObjectContextRef obc, const hobject_t& soid, pg_shard_t peer,
-    PushOp *pop, bool cache_dont_need = true);
+    PushOp *pop, bool cache_dont_need = true,
+    object_block_digest_t *local_digest = nullptr);
   void prep_push(
     ObjectContextRef obc,
     const hobject_t& oid, pg_shard_t dest,
@@ -321,6 +322,12 @@ private:
     interval_set<uint64_t>& data_subset,
     map<hobject_t, interval_set<uint64_t>>& clone_subsets,
     ObcLockManager &lock_manager);
+  void calc_delta_subsets(
+    ObjectContextRef obc, const hobject_t& soid,
+    const object_block_digest_t& peer_digest,
+    object_block_digest_t& local_digest,
+    interval_set<uint64_t>& data_subset,
+    map<hobject_t, interval_set<uint64_t>>& clone_subsets);
   ObjectRecoveryInfo recalc_subsets(
     const ObjectRecoveryInfo& recovery_info,
     SnapSetContext *ssc,
@@ -436,6 +443,11 @@ private:
     uint32_t seed,
     ScrubMap::object &o,
     ThreadPool::TPHandle &handle) override;
+  int be_block_digest(
+    const hobject_t &poid,
+    uint32_t block_size,
+    object_block_digest_t *digest,
+    ThreadPool::TPHandle *handle = nullptr) override;
   uint64_t be_get_ondisk_size(uint64_t logical_size) override { return logical_size; }
 };
 
@@ -51,6 +51,25 @@ int OSDriver::get_next(
   }
 }
 
+int OSDriver::get_next_batch(
+  const std::string &key,
+  unsigned max,
+  std::vector<pair<std::string, bufferlist> > *out)
+{
+  ObjectMap::ObjectMapIterator iter =
+    os->get_omap_iterator(cid, hoid);
+  if (!iter) {
+    ceph_abort();
+    return -EINVAL;
+  }
+  for (iter->upper_bound(key);
+       iter->valid() && out->size() < max;
+       iter->next()) {
+    out->push_back(make_pair(iter->key(), iter->value()));
+  }
+  return iter->status();
+}
+
 struct Mapping {
   snapid_t snap;
   hobject_t hoid;
@@ -256,26 +275,36 @@ int SnapMapper::get_next_objects_to_trim(
        ++i) {
     string prefix(get_prefix(snap) + *i);
     string pos = prefix;
-    while (out->size() < max) {
-      pair<string, bufferlist> next;
-      r = backend.get_next(pos, &next);
+    bool prefix_done = false;
+    while (out->size() < max && !prefix_done) {
+      // one omap iterator per batch rather than per object
+      vector<pair<string, bufferlist> > batch;
+      unsigned want = max - out->size();
+      r = backend.get_next_batch(pos, want, &batch);
       if (r != 0) {
 	break; // Done
       }
 
-      if (next.first.substr(0, prefix.size()) !=
-	  prefix) {
-	break; // Done with this prefix
-      }
+      for (auto &next : batch) {
+	if (next.first.substr(0, prefix.size()) !=
+	    prefix) {
+	  prefix_done = true;
+	  break; // Done with this prefix
+	}
 
-      assert(is_mapping(next.first));
+	assert(is_mapping(next.first));
 
-      pair<snapid_t, hobject_t> next_decoded(from_raw(next));
-      assert(next_decoded.first == snap);
-      assert(check(next_decoded.second));
+	pair<snapid_t, hobject_t> next_decoded(from_raw(next));
+	assert(next_decoded.first == snap);
+	assert(check(next_decoded.second));
 
-      out->push_back(next_decoded.second);
-      pos = next.first;
+	out->push_back(next_decoded.second);
+	pos = next.first;
+      }
+      if (batch.size() < want && !prefix_done) {
+	r = -ENOENT;
+	break; // Done
+      }
     }
   }
   if (out->size() == 0) {
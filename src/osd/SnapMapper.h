@@ -71,6 +71,10 @@ public:
   int get_next(
     const std::string &key,
     pair<std::string, bufferlist> *next) override;
+  int get_next_batch(
+    const std::string &key,
+    unsigned max,
+    std::vector<pair<std::string, bufferlist> > *out) override;
 };
 
 /**
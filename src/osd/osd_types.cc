@@ -176,21 +176,36 @@ void osd_reqid_t::generate_test_instances(list<osd_reqid_t*>& o)
 
 // -- object_locator_t --
 
-void object_locator_t::encode(bufferlist& bl) const
+template<typename P>
+void object_locator_t::_encode(P& p) const
+{
+  // need to interpret the hash
+  __u8 encode_compat = hash != -1 ? 6 : 3;
+  DENC_START(6, encode_compat, p);
+  denc(pool, p);
+  int32_t preferred = -1;  // tell old code there is no preferred osd (-1).
+  denc(preferred, p);
+  denc(key, p);
+  denc(nspace, p);
+  denc(hash, p);
+  DENC_FINISH(p);
+}
+
+void object_locator_t::bound_encode(size_t& p) const
+{
+  _encode(p);
+}
+
+void object_locator_t::encode(bufferlist::contiguous_appender& p) const
 {
   // verify that nobody's corrupted the locator
   assert(hash == -1 || key.empty());
-  __u8 encode_compat = 3;
-  ENCODE_START(6, encode_compat, bl);
-  ::encode(pool, bl);
-  int32_t preferred = -1;  // tell old code there is no preferred osd (-1).
-  ::encode(preferred, bl);
-  ::encode(key, bl);
-  ::encode(nspace, bl);
-  ::encode(hash, bl);
-  if (hash != -1)
-    encode_compat = MAX(encode_compat, 6); // need to interpret the hash
-  ENCODE_FINISH_NEW_COMPAT(bl, encode_compat);
+  _encode(p);
+}
+
+void object_locator_t::encode(bufferlist& bl) const
+{
+  denc_encode(*this, bl);
 }
 
 void object_locator_t::decode(bufferlist::iterator& p)
@@ -3861,13 +3876,29 @@ void ObjectModDesc::generate_test_instances(list<ObjectModDesc*>& o)
   o.back()->append(1000);
 }
 
+template<typename P>
+void ObjectModDesc::_encode(P& p) const
+{
+  DENC_START(max_required_version, max_required_version, p);
+  denc(can_local_rollback, p);
+  denc(rollback_info_completed, p);
+  denc(bl, p);
+  DENC_FINISH(p);
+}
+
+void ObjectModDesc::bound_encode(size_t& p) const
+{
+  _encode(p);
+}
+
+void ObjectModDesc::encode(bufferlist::contiguous_appender& p) const
+{
+  _encode(p);
+}
+
 void ObjectModDesc::encode(bufferlist &_bl) const
 {
-  ENCODE_START(max_required_version, max_required_version, _bl);
-  ::encode(can_local_rollback, _bl);
-  ::encode(rollback_info_completed, _bl);
-  ::encode(bl, _bl);
-  ENCODE_FINISH(_bl);
+  denc_encode(*this, _bl);
 }
 void ObjectModDesc::decode(bufferlist::iterator &_bl)
 {
@@ -3891,7 +3922,7 @@ string pg_log_entry_t::get_key_name() const
 
 void pg_log_entry_t::encode_with_checksum(bufferlist& bl) const
 {
-  bufferlist ebl(sizeof(*this)*2);
+  bufferlist ebl;
   encode(ebl);
   __u32 crc = ebl.crc32c(0);
   ::encode(ebl, bl);
@@ -3910,12 +3941,13 @@ void pg_log_entry_t::decode_with_checksum(bufferlist::iterator& p)
   decode(q);
 }
 
-void pg_log_entry_t::encode(bufferlist &bl) const
+template<typename P>
+void pg_log_entry_t::_encode(P& p) const
 {
-  ENCODE_START(11, 4, bl);
-  ::encode(op, bl);
-  ::encode(soid, bl);
-  ::encode(version, bl);
+  DENC_START(11, 4, p);
+  denc(op, p);
+  denc_encode(soid, p);
+  denc(version, p);
 
   /**
    * Added with reverting_to:
@@ -3925,21 +3957,36 @@ void pg_log_entry_t::encode(bufferlist &bl) const
    * into prior_version as expected.
    */
   if (op == LOST_REVERT)
-    ::encode(reverting_to, bl);
+    denc(reverting_to, p);
   else
-    ::encode(prior_version, bl);
+    denc(prior_version, p);
 
-  ::encode(reqid, bl);
-  ::encode(mtime, bl);
+  denc(reqid, p);
+  denc(mtime, p);
   if (op == LOST_REVERT)
-    ::encode(prior_version, bl);
-  ::encode(snaps, bl);
-  ::encode(user_version, bl);
-  ::encode(mod_desc, bl);
-  ::encode(extra_reqids, bl);
+    denc(prior_version, p);
+  denc(snaps, p);
+  denc(user_version, p);
+  denc_encode(mod_desc, p);
+  denc(extra_reqids, p);
   if (op == ERROR)
-    ::encode(return_code, bl);
-  ENCODE_FINISH(bl);
+    denc(return_code, p);
+  DENC_FINISH(p);
+}
+
+void pg_log_entry_t::bound_encode(size_t& p) const
+{
+  _encode(p);
+}
+
+void pg_log_entry_t::encode(bufferlist::contiguous_appender& p) const
+{
+  _encode(p);
+}
+
+void pg_log_entry_t::encode(bufferlist &bl) const
+{
+  denc_encode(*this, bl);
 }
 
 void pg_log_entry_t::decode(bufferlist::iterator &bl)
@@ -4074,6 +4121,62 @@ ostream& operator<<(ostream& out, const pg_log_entry_t& e)
 }
 
 
+// -- pg_log_dup_t --
+
+string pg_log_dup_t::get_key_name() const
+{
+  return "dup_" + version.get_key_name();
+}
+
+void pg_log_dup_t::encode(bufferlist &bl) const
+{
+  ENCODE_START(1, 1, bl);
+  ::encode(reqid, bl);
+  ::encode(version, bl);
+  ::encode(user_version, bl);
+  ::encode(return_code, bl);
+  ENCODE_FINISH(bl);
+}
+
+void pg_log_dup_t::decode(bufferlist::iterator &bl)
+{
+  DECODE_START(1, bl);
+  ::decode(reqid, bl);
+  ::decode(version, bl);
+  ::decode(user_version, bl);
+  ::decode(return_code, bl);
+  DECODE_FINISH(bl);
+}
+
+void pg_log_dup_t::dump(Formatter *f) const
+{
+  f->dump_stream("reqid") << reqid;
+  f->dump_stream("version") << version;
+  f->dump_unsigned("user_version", user_version);
+  f->dump_int("return_code", return_code);
+}
+
+void pg_log_dup_t::generate_test_instances(list<pg_log_dup_t*>& o)
+{
+  o.push_back(new pg_log_dup_t());
+  o.push_back(new pg_log_dup_t(eversion_t(1,2),
+			       1,
+			       osd_reqid_t(entity_name_t::CLIENT(777), 8, 999),
+			       0));
+  o.push_back(new pg_log_dup_t(eversion_t(1,2),
+			       2,
+			       osd_reqid_t(entity_name_t::CLIENT(777), 8, 999),
+			       -ENOENT));
+}
+
+ostream& operator<<(ostream& out, const pg_log_dup_t& e)
+{
+  return out << "log_dup(reqid=" << e.reqid
+	     << " v=" << e.version << " uv=" << e.user_version
+	     << " rc=" << e.return_code << ")";
+}
+
+
 // -- pg_log_t --
 
 // out: pg_log_t that only has entries that apply to import_pgid using curmap
@@ -4114,18 +4217,19 @@ void pg_log_t::filter_log(spg_t import_pgid, const OSDMap &curmap,
 
 void pg_log_t::encode(bufferlist& bl) const
 {
-  ENCODE_START(6, 3, bl);
+  ENCODE_START(7, 3, bl);
   ::encode(head, bl);
   ::encode(tail, bl);
   ::encode(log, bl);
   ::encode(can_rollback_to, bl);
   ::encode(rollback_info_trimmed_to, bl);
+  ::encode(dups, bl);
   ENCODE_FINISH(bl);
 }
  
 void pg_log_t::decode(bufferlist::iterator &bl, int64_t pool)
 {
-  DECODE_START_LEGACY_COMPAT_LEN(6, 3, 3, bl);
+  DECODE_START_LEGACY_COMPAT_LEN(7, 3, 3, bl);
   ::decode(head, bl);
   ::decode(tail, bl);
   if (struct_v < 2) {
@@ -4140,6 +4244,9 @@ void pg_log_t::decode(bufferlist::iterator &bl, int64_t pool)
     ::decode(rollback_info_trimmed_to, bl);
   else
     rollback_info_trimmed_to = tail;
+
+  if (struct_v >= 7)
+    ::decode(dups, bl);
   DECODE_FINISH(bl);
 
   // handle hobject_t format change
@@ -4164,6 +4271,13 @@ void pg_log_t::dump(Formatter *f) const
     f->close_section();
   }
   f->close_section();
+  f->open_array_section("dups");
+  for (const auto& entry : dups) {
+    f->open_object_section("entry");
+    entry.dump(f);
+    f->close_section();
+  }
+  f->close_section();
 }
 
 void pg_log_t::generate_test_instances(list<pg_log_t*>& o)
@@ -4178,6 +4292,10 @@ void pg_log_t::generate_test_instances(list<pg_log_t*>& o)
   pg_log_entry_t::generate_test_instances(e);
   for (list<pg_log_entry_t*>::iterator p = e.begin(); p != e.end(); ++p)
     o.back()->log.push_back(**p);
+  list<pg_log_dup_t*> d;
+  pg_log_dup_t::generate_test_instances(d);
+  for (auto p : d)
+    o.back()->dups.push_back(*p);
 }
 
 void pg_log_t::copy_after(const pg_log_t &other, eversion_t v) 
@@ -4937,19 +5055,35 @@ void watch_info_t::generate_test_instances(list<watch_info_t*>& o)
 
 // -- object_manifest_t --
 
-void object_manifest_t::encode(bufferlist& bl) const
+template<typename P>
+void object_manifest_t::_encode(P& p) const
 {
-  ENCODE_START(1, 1, bl);
-  ::encode(type, bl);
+  DENC_START(1, 1, p);
+  denc(type, p);
   switch (type) {
     case TYPE_NONE: break;
     case TYPE_REDIRECT: 
-      ::encode(redirect_target, bl);
+      denc_encode(redirect_target, p);
       break;
     default:
       ceph_abort();
   }
-  ENCODE_FINISH(bl);
+  DENC_FINISH(p);
+}
+
+void object_manifest_t::bound_encode(size_t& p) const
+{
+  _encode(p);
+}
+
+void object_manifest_t::encode(bufferlist::contiguous_appender& p) const
+{
+  _encode(p);
+}
+
+void object_manifest_t::encode(bufferlist& bl) const
+{
+  denc_encode(*this, bl);
 }
 
 void object_manifest_t::decode(bufferlist::iterator& bl)
@@ -5016,51 +5150,87 @@ ps_t object_info_t::legacy_object_locator_to_ps(const object_t &oid,
   return ps;
 }
 
-void object_info_t::encode(bufferlist& bl, uint64_t features) const
+// splice something encoded the old way into a contiguous encoding
+static void denc_splice(const bufferlist& bl, size_t& p)
+{
+  p += bl.length();
+}
+
+static void denc_splice(const bufferlist& bl,
+			bufferlist::contiguous_appender& p)
+{
+  p.append(bl);
+}
+
+template<typename P>
+void object_info_t::_encode(P& p, const bufferlist& old_watchers_bl,
+			    const bufferlist& watchers_bl,
+			    uint64_t features) const
 {
   object_locator_t myoloc(soid);
-  map<entity_name_t, watch_info_t> old_watchers;
-  for (map<pair<uint64_t, entity_name_t>, watch_info_t>::const_iterator i =
-	 watchers.begin();
-       i != watchers.end();
-       ++i) {
-    old_watchers.insert(make_pair(i->first.second, i->second));
-  }
-  ENCODE_START(17, 8, bl);
-  ::encode(soid, bl);
-  ::encode(myoloc, bl);	//Retained for compatibility
-  ::encode((__u32)0, bl); // was category, no longer used
-  ::encode(version, bl);
-  ::encode(prior_version, bl);
-  ::encode(last_reqid, bl);
-  ::encode(size, bl);
-  ::encode(mtime, bl);
+  DENC_START(17, 8, p);
+  denc_encode(soid, p);
+  denc_encode(myoloc, p);	//Retained for compatibility
+  denc((__u32)0, p); // was category, no longer used
+  denc(version, p);
+  denc(prior_version, p);
+  denc(last_reqid, p);
+  denc(size, p);
+  denc(mtime, p);
   if (soid.snap == CEPH_NOSNAP)
-    ::encode(osd_reqid_t(), bl);  // used to be wrlock_by
+    denc(osd_reqid_t(), p);  // used to be wrlock_by
   else
-    ::encode(legacy_snaps, bl);
-  ::encode(truncate_seq, bl);
-  ::encode(truncate_size, bl);
-  ::encode(is_lost(), bl);
-  ::encode(old_watchers, bl, features);
+    denc(legacy_snaps, p);
+  denc(truncate_seq, p);
+  denc(truncate_size, p);
+  denc(is_lost(), p);
+  if (watchers.empty())
+    denc((__u32)0, p);
+  else
+    denc_splice(old_watchers_bl, p);
   /* shenanigans to avoid breaking backwards compatibility in the disk format.
    * When we can, switch this out for simply putting the version_t on disk. */
   eversion_t user_eversion(0, user_version);
-  ::encode(user_eversion, bl);
-  ::encode(test_flag(FLAG_USES_TMAP), bl);
-  ::encode(watchers, bl, features);
+  denc(user_eversion, p);
+  denc(test_flag(FLAG_USES_TMAP), p);
+  if (watchers.empty())
+    denc((__u32)0, p);
+  else
+    denc_splice(watchers_bl, p);
   __u32 _flags = flags;
-  ::encode(_flags, bl);
-  ::encode(local_mtime, bl);
-  ::encode(data_digest, bl);
-  ::encode(omap_digest, bl);
-  ::encode(expected_object_size, bl);
-  ::encode(expected_write_size, bl);
-  ::encode(alloc_hint_flags, bl);
+  denc(_flags, p);
+  denc(local_mtime, p);
+  denc(data_digest, p);
+  denc(omap_digest, p);
+  denc(expected_object_size, p);
+  denc(expected_write_size, p);
+  denc(alloc_hint_flags, p);
   if (has_manifest()) {
-    ::encode(manifest, bl);
+    denc_encode(manifest, p);
   }
-  ENCODE_FINISH(bl);
+  DENC_FINISH(p);
+}
+
+void object_info_t::encode(bufferlist& bl, uint64_t features) const
+{
+  // watch_info_t has no contiguous encoding; encode the (rare) watchers
+  // the old way and splice them in.
+  bufferlist old_watchers_bl, watchers_bl;
+  if (!watchers.empty()) {
+    map<entity_name_t, watch_info_t> old_watchers;
+    for (map<pair<uint64_t, entity_name_t>, watch_info_t>::const_iterator i =
+	   watchers.begin();
+	 i != watchers.end();
+	 ++i) {
+      old_watchers.insert(make_pair(i->first.second, i->second));
+    }
+    ::encode(old_watchers, old_watchers_bl, features);
+    ::encode(watchers, watchers_bl, features);
+  }
+  size_t len = 0;
+  _encode(len, old_watchers_bl, watchers_bl, features);
+  auto p = bl.get_contiguous_appender(len);
+  _encode(p, old_watchers_bl, watchers_bl, features);
 }
 
 void object_info_t::decode(bufferlist::iterator& bl)
@@ -5362,6 +5532,55 @@ void ObjectRecoveryInfo::dump(Formatter *f) const
   f->dump_stream("clone_subset") << clone_subset;
 }
 
+// -- object_block_digest_t --
+
+void object_block_digest_t::encode(bufferlist &bl) const
+{
+  ENCODE_START(1, 1, bl);
+  ::encode(version, bl);
+  ::encode(size, bl);
+  ::encode(block_size, bl);
+  ::encode(blocks, bl);
+  ENCODE_FINISH(bl);
+}
+
+void object_block_digest_t::decode(bufferlist::iterator &bl)
+{
+  DECODE_START(1, bl);
+  ::decode(version, bl);
+  ::decode(size, bl);
+  ::decode(block_size, bl);
+  ::decode(blocks, bl);
+  DECODE_FINISH(bl);
+}
+
+void object_block_digest_t::dump(Formatter *f) const
+{
+  f->dump_stream("version") << version;
+  f->dump_unsigned("size", size);
+  f->dump_unsigned("block_size", block_size);
+  f->dump_unsigned("num_blocks", blocks.size());
+}
+
+void object_block_digest_t::generate_test_instances(
+  list<object_block_digest_t*>& o)
+{
+  o.push_back(new object_block_digest_t);
+  o.push_back(new object_block_digest_t);
+  o.back()->version = eversion_t(3, 10);
+  o.back()->size = 6000;
+  o.back()->block_size = 4096;
+  o.back()->blocks.push_back(string(20, 'a'));
+  o.back()->blocks.push_back(string(20, 'b'));
+}
+
+ostream& operator<<(ostream& out, const object_block_digest_t& d)
+{
+  return out << "block_digest(" << d.version
+	     << " size " << d.size
+	     << " " << d.blocks.size() << "x" << d.block_size << ")";
+}
+
 ostream& operator<<(ostream& out, const ObjectRecoveryInfo &inf)
 {
   return inf.print(out);
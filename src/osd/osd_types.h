@@ -124,7 +124,7 @@ struct osd_reqid_t {
   void dump(Formatter *f) const;
   static void generate_test_instances(list<osd_reqid_t*>& o);
 };
-WRITE_CLASS_DENC(osd_reqid_t)
+WRITE_CLASS_DENC_BOUNDED(osd_reqid_t)
 
 
 
@@ -242,9 +242,16 @@ struct object_locator_t {
   }
 
   void encode(bufferlist& bl) const;
+  void bound_encode(size_t& p) const;
+  void encode(bufferlist::contiguous_appender& p) const;
   void decode(bufferlist::iterator& p);
   void dump(Formatter *f) const;
   static void generate_test_instances(list<object_locator_t*>& o);
+
+private:
+  DENC_HELPERS
+  template<typename P>
+  void _encode(P& p) const;
 };
 WRITE_CLASS_ENCODER(object_locator_t)
 
@@ -822,8 +829,14 @@ public:
     bufferlist::iterator p = bl.begin();
     decode(p);
   }
+
+  DENC(eversion_t, v, p) {
+    denc(v.version, p);
+    denc(v.epoch, p);
+  }
 };
 WRITE_CLASS_ENCODER(eversion_t)
+WRITE_CLASS_DENC_BOUNDED(eversion_t)
 
 inline bool operator==(const eversion_t& l, const eversion_t& r) {
   return (l.epoch == r.epoch) && (l.version == r.version);
@@ -3248,9 +3261,16 @@ public:
       bl.rebuild();
   }
   void encode(bufferlist &bl) const;
+  void bound_encode(size_t& p) const;
+  void encode(bufferlist::contiguous_appender& p) const;
   void decode(bufferlist::iterator &bl);
   void dump(Formatter *f) const;
   static void generate_test_instances(list<ObjectModDesc*>& o);
+
+private:
+  DENC_HELPERS
+  template<typename P>
+  void _encode(P& p) const;
 };
 WRITE_CLASS_ENCODER(ObjectModDesc)
 
@@ -3382,15 +3402,54 @@ struct pg_log_entry_t {
   void decode_with_checksum(bufferlist::iterator& p);
 
   void encode(bufferlist &bl) const;
+  void bound_encode(size_t& p) const;
+  void encode(bufferlist::contiguous_appender& p) const;
   void decode(bufferlist::iterator &bl);
   void dump(Formatter *f) const;
   static void generate_test_instances(list<pg_log_entry_t*>& o);
 
+private:
+  DENC_HELPERS
+  template<typename P>
+  void _encode(P& p) const;
 };
 WRITE_CLASS_ENCODER(pg_log_entry_t)
 
 ostream& operator<<(ostream& out, const pg_log_entry_t& e);
 
+/**
+ * pg_log_dup_t - compact record of a request trimmed out of the pg log
+ *
+ * Kept (in memory and in the pgmeta omap under "dup_" keys) for a
+ * bounded number of requests past the log tail so that dup detection
+ * does not depend on the length of the log itself.
+ */
+struct pg_log_dup_t {
+  osd_reqid_t reqid;  // caller+tid to uniquely identify request
+  eversion_t version;
+  version_t user_version; // the user version for this entry
+  int32_t return_code; // only stored for ERRORs for dup detection
+
+  pg_log_dup_t()
+    : user_version(0), return_code(0) {}
+  explicit pg_log_dup_t(const pg_log_entry_t& entry)
+    : reqid(entry.reqid), version(entry.version),
+      user_version(entry.user_version), return_code(entry.return_code) {}
+  pg_log_dup_t(const eversion_t& v, version_t uv,
+	       const osd_reqid_t& rid, int return_code)
+    : reqid(rid), version(v), user_version(uv),
+      return_code(return_code) {}
+
+  string get_key_name() const;
+  void encode(bufferlist &bl) const;
+  void decode(bufferlist::iterator &bl);
+  void dump(Formatter *f) const;
+  static void generate_test_instances(list<pg_log_dup_t*>& o);
+};
+WRITE_CLASS_ENCODER(pg_log_dup_t)
+
+ostream& operator<<(ostream& out, const pg_log_dup_t& e);
+
 
 
 /**
@@ -3418,7 +3477,10 @@ protected:
 
 public:
   mempool::osd_pglog::list<pg_log_entry_t> log;  // the actual log.
-  
+
+  // reqids trimmed out of log, oldest first, kept for dup detection
+  mempool::osd_pglog::list<pg_log_dup_t> dups;
+
   pg_log_t() = default;
   pg_log_t(const eversion_t &last_update,
 	   const eversion_t &log_tail,
@@ -3444,6 +3506,7 @@ public:
     eversion_t z;
     rollback_info_trimmed_to = can_rollback_to = head = tail = z;
     log.clear();
+    dups.clear();
   }
 
   eversion_t get_rollback_info_trimmed_to() const {
@@ -4456,9 +4519,16 @@ struct object_manifest_t {
   }
   static void generate_test_instances(list<object_manifest_t*>& o);
   void encode(bufferlist &bl) const;
+  void bound_encode(size_t& p) const;
+  void encode(bufferlist::contiguous_appender& p) const;
   void decode(bufferlist::iterator &bl);
   void dump(Formatter *f) const;
   friend ostream& operator<<(ostream& out, const object_info_t& oi);
+
+private:
+  DENC_HELPERS
+  template<typename P>
+  void _encode(P& p) const;
 };
 WRITE_CLASS_ENCODER(object_manifest_t)
 ostream& operator<<(ostream& out, const object_manifest_t& oi);
@@ -4624,6 +4694,12 @@ struct object_info_t {
   explicit object_info_t(bufferlist& bl) {
     decode(bl);
   }
+
+private:
+  DENC_HELPERS
+  template<typename P>
+  void _encode(P& p, const bufferlist& old_watchers_bl,
+	       const bufferlist& watchers_bl, uint64_t features) const;
 };
 WRITE_CLASS_ENCODER_FEATURES(object_info_t)
 
@@ -4632,6 +4708,33 @@ ostream& operator<<(ostream& out, const object_info_t& oi);
 
 
 // Object recovery
+
+/**
+ * object_block_digest_t - per-block digest of a shard's copy of an object
+ *
+ * Lets backfill push only the blocks of a stale copy that differ.
+ */
+struct object_block_digest_t {
+  eversion_t version;     ///< version of the digested copy
+  uint64_t size = 0;      ///< object size
+  uint32_t block_size = 0;
+  vector<string> blocks;  ///< sha1 of each block
+
+  bool empty() const {
+    return blocks.empty();
+  }
+  uint64_t block_length(unsigned i) const {
+    return MIN((uint64_t)block_size, size - (uint64_t)i * block_size);
+  }
+
+  void encode(bufferlist &bl) const;
+  void decode(bufferlist::iterator &bl);
+  void dump(Formatter *f) const;
+  static void generate_test_instances(list<object_block_digest_t*>& o);
+};
+WRITE_CLASS_ENCODER(object_block_digest_t)
+ostream& operator<<(ostream& out, const object_block_digest_t& d);
+
 struct ObjectRecoveryInfo {
   hobject_t soid;
   eversion_t version;
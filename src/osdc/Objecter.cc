@@ -1182,6 +1182,7 @@ void Objecter::handle_osd_map(MOSDMap *m)
 			<< dendl;
 	  OSDMap::Incremental inc(m->incremental_maps[e]);
 	  osdmap->apply_incremental(inc);
+	  pg_mapping_cache.note_incremental(*osdmap, inc);
 
           emit_blacklist_events(inc);
 
@@ -1515,7 +1516,7 @@ int Objecter::pool_snap_list(int64_t poolid, vector<uint64_t> *snaps)
 }
 
 // sl may be unlocked.
-void Objecter::_check_op_pool_dne(Op *op, unique_lock *sl)
+void Objecter::_check_op_pool_dne(Op *op, OSDSession::unique_lock *sl)
 {
   // rwlock is locked unique
 
@@ -2260,6 +2261,22 @@ void Objecter::op_submit(Op *op, ceph_tid_t *ptid, int *ctx_budget)
   _op_submit_with_budget(op, rl, ptid, ctx_budget);
 }
 
+void Objecter::op_submit_batch(const vector<pair<Op*,ceph_tid_t*>>& ops)
+{
+  shunique_lock rl(rwlock, ceph::acquire_shared);
+  for (auto& p : ops) {
+    ceph_tid_t tid = 0;
+    p.first->trace.event("op submit");
+    _op_submit_with_budget(p.first, rl, p.second ? p.second : &tid);
+    if (rl.owns_lock()) {
+      // _op_submit needed the lock exclusively (e.g., to open a
+      // session); don't hold it that way for the rest of the batch
+      rl.unlock();
+      rl.lock_shared();
+    }
+  }
+}
+
 void Objecter::_op_submit_with_budget(Op *op, shunique_lock& sul,
 				      ceph_tid_t *ptid,
 				      int *ctx_budget)
@@ -2818,8 +2835,13 @@ int Objecter::_calc_target(op_target_t *t, Connection *con, bool any_change)
   unsigned pg_num = pi->get_pg_num();
   int up_primary, acting_primary;
   vector<int> up, acting;
-  osdmap->pg_to_up_acting_osds(pgid, &up, &up_primary,
-			       &acting, &acting_primary);
+  if (cct->_conf->objecter_pg_mapping_cache_size) {
+    pg_mapping_cache.get(*osdmap, osdmap->raw_pg_to_pg(pgid), &up, &up_primary,
+			 &acting, &acting_primary);
+  } else {
+    osdmap->pg_to_up_acting_osds(pgid, &up, &up_primary,
+				 &acting, &acting_primary);
+  }
   bool sort_bitwise = osdmap->test_flag(CEPH_OSDMAP_SORTBITWISE);
   unsigned prev_seed = ceph_stable_mod(pgid.ps(), t->pg_num, t->pg_num_mask);
   pg_t prev_pgid(prev_seed, pgid.pool());
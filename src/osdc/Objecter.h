@@ -34,11 +34,13 @@
 #include "common/ceph_time.h"
 #include "common/ceph_timer.h"
 #include "common/Finisher.h"
+#include "common/sharded_shared_mutex.h"
 #include "common/shunique_lock.h"
 #include "common/zipkin_trace.h"
 
 #include "messages/MOSDOp.h"
 #include "osd/OSDMap.h"
+#include "osd/OSDMapMapping.h"
 
 using namespace std;
 
@@ -1188,6 +1190,7 @@ public:
   ZTracer::Endpoint trace_endpoint;
 private:
   OSDMap    *osdmap;
+  OSDMapMappingCache pg_mapping_cache;  ///< pgs we have mapped this epoch
 public:
   using Dispatcher::cct;
   std::multimap<string,string> crush_location;
@@ -1221,7 +1224,9 @@ private:
   version_t last_seen_osdmap_version;
   version_t last_seen_pgmap_version;
 
-  mutable boost::shared_mutex rwlock;
+  // taken shared by every op submission and reply; sharded so that
+  // concurrent submitters do not contend on a single cache line.
+  mutable ceph::sharded_shared_mutex rwlock;
   using lock_guard = std::unique_lock<decltype(rwlock)>;
   using unique_lock = std::unique_lock<decltype(rwlock)>;
   using shared_lock = boost::shared_lock<decltype(rwlock)>;
@@ -1931,7 +1936,7 @@ public:
   }
 
 private:
-  void _check_op_pool_dne(Op *op, unique_lock *sl);
+  void _check_op_pool_dne(Op *op, OSDSession::unique_lock *sl);
   void _send_op_map_check(Op *op);
   void _op_cancel_map_check(Op *op);
   void _check_linger_pool_dne(LingerOp *op, bool *need_unregister);
@@ -1997,6 +2002,7 @@ private:
     Dispatcher(cct_), messenger(m), monc(mc), finisher(fin),
     trace_endpoint("0.0.0.0", 0, "Objecter"),
     osdmap(new OSDMap),
+    pg_mapping_cache(cct->_conf->objecter_pg_mapping_cache_size),
     max_linger_id(0),
     keep_balanced_budget(false), honor_osdmap_full(true), osdmap_full_try(false),
     blacklist_events_enabled(false),
@@ -2125,6 +2131,8 @@ private:
   // public interface
 public:
   void op_submit(Op *op, ceph_tid_t *ptid = NULL, int *ctx_budget = NULL);
+  /// submit several independent ops, taking rwlock only once
+  void op_submit_batch(const vector<pair<Op*,ceph_tid_t*>>& ops);
   bool is_active() {
     shared_lock l(rwlock);
     return !((!inflight_ops) && linger_ops.empty() &&
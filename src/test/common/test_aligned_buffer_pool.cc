@@ -0,0 +1,96 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "common/aligned_buffer_pool.h"
+
+#include "gtest/gtest.h"
+
+using ceph::aligned_buffer_pool;
+
+TEST(AlignedBufferPool, Fill) {
+  auto pool = aligned_buffer_pool::create(64 << 10, 1 << 20);
+  bufferlist bl;
+  // 100 byte unaligned head, 200000 bytes of pages, 300 byte tail
+  unsigned off = CEPH_PAGE_SIZE - 100;
+  unsigned len = 100 + (200000 & CEPH_PAGE_MASK) + 300;
+  pool->fill(&bl, len, off);
+  ASSERT_EQ(len, bl.length());
+
+  auto& bufs = bl.buffers();
+  ASSERT_EQ(100u, bufs.front().length());
+  ASSERT_EQ(300u, bufs.back().length());
+  unsigned n = 0;
+  for (auto& p : bufs) {
+    if (n++ == 0 || n == bufs.size())
+      continue;
+    ASSERT_TRUE(p.is_page_aligned());
+    ASSERT_TRUE(p.is_n_page_sized());
+    ASSERT_LE(p.length(), pool->get_chunk_size());
+  }
+}
+
+TEST(AlignedBufferPool, Reuse) {
+  auto pool = aligned_buffer_pool::create(64 << 10, 1 << 20);
+  const char *first;
+  {
+    bufferlist bl;
+    pool->fill(&bl, 64 << 10, 0);
+    ASSERT_EQ(1u, bl.buffers().size());
+    first = bl.buffers().front().c_str();
+  }
+  bufferlist bl;
+  pool->fill(&bl, 64 << 10, 0);
+  ASSERT_EQ(first, bl.buffers().front().c_str());
+}
+
+TEST(AlignedBufferPool, MaxCached) {
+  auto pool = aligned_buffer_pool::create(64 << 10, 64 << 10);
+  std::set<const char*> chunks;
+  {
+    bufferlist bl;
+    pool->fill(&bl, 128 << 10, 0);
+    ASSERT_EQ(2u, bl.buffers().size());
+    for (auto& p : bl.buffers())
+      chunks.insert(p.c_str());
+  }
+  // only one chunk was kept
+  bufferlist a, b;
+  pool->fill(&a, 64 << 10, 0);
+  ASSERT_EQ(1u, chunks.count(a.buffers().front().c_str()));
+  pool->fill(&b, 64 << 10, 0);
+  ASSERT_NE(a.buffers().front().c_str(), b.buffers().front().c_str());
+}
+
+TEST(AlignedBufferPool, PartialChunk) {
+  auto pool = aligned_buffer_pool::create(64 << 10, 1 << 20);
+  bufferlist bl;
+  pool->fill(&bl, (64 << 10) + CEPH_PAGE_SIZE, 0);
+  ASSERT_EQ(2u, bl.buffers().size());
+  // the remainder does not pin a whole chunk
+  ASSERT_EQ((unsigned)CEPH_PAGE_SIZE, bl.buffers().back().raw_length());
+  ASSERT_TRUE(bl.buffers().back().is_page_aligned());
+}
+
+TEST(AlignedBufferPool, Mempool) {
+  size_t before = mempool::unittest_1::allocated_bytes();
+  auto pool = aligned_buffer_pool::create(64 << 10, 1 << 20,
+					  mempool::mempool_unittest_1);
+  {
+    bufferlist bl;
+    pool->fill(&bl, 128 << 10, 0);
+    ASSERT_EQ(before + (128 << 10), mempool::unittest_1::allocated_bytes());
+  }
+  // cached chunks still count
+  ASSERT_EQ(before + (128 << 10), mempool::unittest_1::allocated_bytes());
+  pool.reset();
+  ASSERT_EQ(before, mempool::unittest_1::allocated_bytes());
+}
+
+TEST(AlignedBufferPool, OutlivesPool) {
+  auto pool = aligned_buffer_pool::create(64 << 10, 1 << 20);
+  bufferlist bl;
+  pool->fill(&bl, 64 << 10, 0);
+  pool.reset();
+  memset(bl.c_str(), 0xab, bl.length());
+  bl.clear();
+}
@@ -0,0 +1,149 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/thread/shared_mutex.hpp>
+
+#include "common/sharded_shared_mutex.h"
+#include "common/shunique_lock.h"
+
+#include "gtest/gtest.h"
+
+typedef ceph::sharded_shared_mutex mutex_t;
+
+static bool test_try_lock(mutex_t* sm) {
+  if (!sm->try_lock())
+    return false;
+  sm->unlock();
+  return true;
+}
+
+static bool test_try_lock_shared(mutex_t* sm) {
+  if (!sm->try_lock_shared())
+    return false;
+  sm->unlock_shared();
+  return true;
+}
+
+TEST(ShardedSharedMutex, Exclusive) {
+  mutex_t sm;
+  sm.lock();
+  ASSERT_FALSE(std::async(std::launch::async, test_try_lock, &sm).get());
+  ASSERT_FALSE(std::async(std::launch::async, test_try_lock_shared, &sm).get());
+  sm.unlock();
+  ASSERT_TRUE(std::async(std::launch::async, test_try_lock, &sm).get());
+  ASSERT_TRUE(std::async(std::launch::async, test_try_lock_shared, &sm).get());
+}
+
+TEST(ShardedSharedMutex, Shared) {
+  mutex_t sm;
+  sm.lock_shared();
+  ASSERT_FALSE(std::async(std::launch::async, test_try_lock, &sm).get());
+  ASSERT_TRUE(std::async(std::launch::async, test_try_lock_shared, &sm).get());
+  sm.unlock_shared();
+  ASSERT_TRUE(std::async(std::launch::async, test_try_lock, &sm).get());
+}
+
+TEST(ShardedSharedMutex, WriterWaitsForReaders) {
+  mutex_t sm;
+  sm.lock_shared();
+  std::atomic<bool> locked = {false};
+  std::thread t([&] {
+      sm.lock();
+      locked = true;
+      sm.unlock();
+    });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_FALSE(locked);
+  sm.unlock_shared();
+  t.join();
+  ASSERT_TRUE(locked);
+}
+
+TEST(ShardedSharedMutex, Shunique) {
+  mutex_t sm;
+  ceph::shunique_lock<mutex_t> l(sm, ceph::acquire_shared);
+  ASSERT_TRUE(l.owns_lock_shared());
+  l.unlock();
+  l.lock();
+  ASSERT_TRUE(l.owns_lock());
+  ASSERT_FALSE(std::async(std::launch::async, test_try_lock_shared, &sm).get());
+}
+
+TEST(ShardedSharedMutex, Stress) {
+  mutex_t sm;
+  // writers keep a == b; readers must never see them differ
+  uint64_t a = 0, b = 0;
+  std::atomic<bool> stop = {false};
+  std::atomic<uint64_t> bad = {0}, reads = {0};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&] {
+	while (!stop) {
+	  ceph::shunique_lock<mutex_t> l(sm, ceph::acquire_shared);
+	  if (a != b)
+	    ++bad;
+	  ++reads;
+	}
+      });
+  }
+  for (int i = 0; i < 2; ++i) {
+    threads.emplace_back([&] {
+	while (!stop) {
+	  std::unique_lock<mutex_t> l(sm);
+	  ++a;
+	  std::this_thread::yield();
+	  ++b;
+	}
+      });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  stop = true;
+  for (auto& t : threads)
+    t.join();
+  ASSERT_EQ(0u, bad);
+  ASSERT_EQ(a, b);
+  ASSERT_LT(0u, a);
+  ASSERT_LT(0u, reads);
+}
+
+// not a pass/fail test; shows how shared acquisition scales with
+// threads compared to boost::shared_mutex.
+template<typename Mutex>
+static uint64_t shared_lock_rate(unsigned nthreads) {
+  Mutex m;
+  std::atomic<bool> stop = {false};
+  std::atomic<uint64_t> total = {0};
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < nthreads; ++i) {
+    threads.emplace_back([&] {
+	uint64_t n = 0;
+	while (!stop) {
+	  m.lock_shared();
+	  m.unlock_shared();
+	  ++n;
+	}
+	total += n;
+      });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  stop = true;
+  for (auto& t : threads)
+    t.join();
+  return total * 5;
+}
+
+TEST(ShardedSharedMutex, Scaling) {
+  unsigned max = std::max(2u, std::min(16u, std::thread::hardware_concurrency()));
+  for (unsigned n = 1; n <= max; n *= 2) {
+    std::cout << n << " threads: boost::shared_mutex "
+	      << shared_lock_rate<boost::shared_mutex>(n)
+	      << " locks/s, sharded_shared_mutex "
+	      << shared_lock_rate<mutex_t>(n) << " locks/s" << std::endl;
+  }
+}
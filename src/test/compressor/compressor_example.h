@@ -48,6 +48,13 @@ public:
     p.copy(MIN(p.get_remaining(), compressed_len), out);
     return 0;
   }
+  int decompress(bufferlist::iterator &p, size_t compressed_len, bufferlist &out,
+		 size_t max_len) override
+  {
+    if (MIN(p.get_remaining(), compressed_len) > max_len)
+      return -EMSGSIZE;
+    return decompress(p, compressed_len, out);
+  }
 };
 
 #endif
@@ -156,6 +156,29 @@ TEST_P(CompressorTest, big_round_trip_file)
 #endif
 
 
+TEST_P(CompressorTest, decompress_max_len)
+{
+  bufferlist orig;
+  orig.append_zero(1024*1024);
+  bufferlist compressed;
+  int r = compressor->compress(orig, compressed);
+  ASSERT_EQ(0, r);
+  {
+    bufferlist decompressed;
+    bufferlist::iterator p = compressed.begin();
+    r = compressor->decompress(p, compressed.length(), decompressed,
+			       orig.length());
+    ASSERT_EQ(0, r);
+    ASSERT_TRUE(decompressed.contents_equal(orig));
+  }
+  {
+    bufferlist decompressed;
+    bufferlist::iterator p = compressed.begin();
+    r = compressor->decompress(p, compressed.length(), decompressed, 4096);
+    ASSERT_EQ(-EMSGSIZE, r);
+  }
+}
+
 TEST_P(CompressorTest, compress_decompress)
 {
   const char* test = "This is test text";
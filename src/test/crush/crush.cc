@@ -639,3 +639,59 @@ TEST(CRUSH, straw2_reweight) {
     cout << "     vs " << estddev << std::endl;
   }
 }
+
+TEST(CRUSH, do_rule_batch) {
+  // a straw2 bucket larger than the chunk hashed at once by
+  // bucket_straw2_choose, with a few zero weights
+  int n = 100;
+  int items[n];
+  int weights[n];
+  for (int i = 0; i < n; ++i) {
+    items[i] = i;
+    weights[i] = (i % 7 == 3) ? 0 : 0x10000 * (1 + i % 5);
+  }
+
+  std::unique_ptr<CrushWrapper> c(new CrushWrapper);
+  c->set_type_name(1, "root");
+  c->set_type_name(0, "osd");
+  c->set_max_devices(n);
+  int root;
+  crush_bucket *b = crush_make_bucket(c->get_crush_map(),
+				      CRUSH_BUCKET_STRAW2, CRUSH_HASH_RJENKINS1,
+				      1, n, items, weights);
+  EXPECT_EQ(0, crush_add_bucket(c->get_crush_map(), 0, b, &root));
+  EXPECT_EQ(0, c->set_item_name(root, "root"));
+  int ruleset = c->add_simple_ruleset("rule", "root", "osd",
+				      "firstn", pg_pool_t::TYPE_REPLICATED);
+  EXPECT_EQ(0, ruleset);
+  c->finalize();
+
+  vector<__u32> reweight(n, 0x10000);
+  reweight[5] = 0x8000;
+  vector<int> x;
+  for (int i = 0; i < 1000; ++i)
+    x.push_back(i * 7919);
+  vector<vector<int>> out;
+  c->do_rule_batch(ruleset, x, &out, 3, reweight, 0);
+  ASSERT_EQ(x.size(), out.size());
+  for (unsigned i = 0; i < x.size(); ++i) {
+    vector<int> expected;
+    c->do_rule(ruleset, x[i], expected, 3, reweight, 0);
+    ASSERT_EQ(expected, out[i]);
+    ASSERT_EQ(3u, out[i].size());
+    for (auto osd : out[i])
+      ASSERT_NE(3, osd % 7);
+  }
+
+  // and for rules with several steps
+  std::unique_ptr<CrushWrapper> ci(build_indep_map(g_ceph_context, 3, 3, 3));
+  vector<__u32> weight(ci->get_max_devices(), 0x10000);
+  weight[4] = 0;
+  c.reset();
+  ci->do_rule_batch(0, x, &out, 5, weight, 0);
+  for (unsigned i = 0; i < x.size(); ++i) {
+    vector<int> expected;
+    ci->do_rule(0, x[i], expected, 5, weight, 0);
+    ASSERT_EQ(expected, out[i]);
+  }
+}
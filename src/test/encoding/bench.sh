@@ -0,0 +1,28 @@
+#!/bin/bash -e
+#
+# time encode and decode of the generated test instances of the types
+# on the OSD write path (or of the types given on the command line)
+#
+#   bench.sh [-n iterations] [type ...]
+#
+
+iterations=100000
+if [ "$1" = "-n" ]; then
+    iterations=$2
+    shift 2
+fi
+
+types="$@"
+if [ -z "$types" ]; then
+    types="osd_reqid_t hobject_t object_locator_t pg_log_entry_t object_info_t"
+fi
+
+for type in $types; do
+    num=`ceph-dencoder type $type count_tests`
+    for n in `seq 1 1 $num 2>/dev/null`; do
+	echo -n "$type $n: "
+	ceph-dencoder type $type select_test $n encode_bench $iterations
+	echo -n "$type $n: "
+	ceph-dencoder type $type select_test $n encode decode_bench $iterations
+    done
+done
@@ -19,6 +19,7 @@
 #include "include/encoding.h"
 #include "include/ceph_features.h"
 #include "common/ceph_argparse.h"
+#include "common/ceph_time.h"
 #include "common/Formatter.h"
 #include "common/errno.h"
 #include "msg/Message.h"
@@ -72,6 +73,9 @@ void usage(ostream &out)
   out << "  count_tests         print number of generated test objects (to stdout)\n";
   out << "  select_test <n>     select generated test object as in-memory object\n";
   out << "  is_deterministic    exit w/ success if type encodes deterministically\n";
+  out << "\n";
+  out << "  encode_bench <n>    time <n> encodes of in-memory object\n";
+  out << "  decode_bench <n>    time <n> decodes of encoded data\n";
 }
 struct Dencoder {
   virtual ~Dencoder() {}
@@ -474,6 +478,37 @@ int main(int argc, const char **argv)
 	exit(0);
       else
 	exit(1);
+    } else if (*i == string("encode_bench") ||
+	       *i == string("decode_bench")) {
+      if (!den) {
+	cerr << "must first select type with 'type <name>'" << std::endl;
+	exit(1);
+      }
+      bool encode = (*i == string("encode_bench"));
+      ++i;
+      if (i == args.end()) {
+	cerr << "expecting iteration count" << std::endl;
+	exit(1);
+      }
+      int n = atoi(*i);
+      size_t bytes = 0;
+      auto start = ceph::mono_clock::now();
+      for (int j = 0; j < n && err.empty(); ++j) {
+	if (encode) {
+	  bufferlist bl;
+	  den->encode(bl, features | CEPH_FEATURE_RESERVED);
+	  bytes = bl.length();
+	} else {
+	  err = den->decode(encbl, skip);
+	  bytes = encbl.length() - skip;
+	}
+      }
+      auto elapsed = ceph::mono_clock::now() - start;
+      cout << n << (encode ? " encodes" : " decodes") << " of " << bytes
+	   << " bytes in " << elapsed << " ("
+	   << std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() /
+	      std::max(n, 1)
+	   << " ns each)" << std::endl;
     } else {
       cerr << "unknown option '" << *i << "'" << std::endl;
       exit(1);
@@ -1582,6 +1582,45 @@ TEST(LibRadosAio, RoundTripWriteFullPP) {
   delete my_completion3;
 }
 
+TEST(LibRadosAio, OperateBatchPP) {
+  AioTestDataPP test_data;
+  ASSERT_EQ("", test_data.init());
+  char buf[128];
+  memset(buf, 0xcc, sizeof(buf));
+  bufferlist bl;
+  bl.append(buf, sizeof(buf));
+
+  std::vector<std::string> oids = {"foo", "bar"};
+  std::vector<AioCompletion*> cs;
+  std::vector<ObjectWriteOperation*> ops;
+  for (size_t i = 0; i < oids.size(); ++i) {
+    cs.push_back(test_data.m_cluster.aio_create_completion());
+    ops.push_back(new ObjectWriteOperation);
+    ops.back()->write_full(bl);
+  }
+
+  // mismatched lengths are rejected before anything is submitted
+  std::vector<ObjectWriteOperation*> short_ops(ops.begin(), ops.end() - 1);
+  ASSERT_EQ(-EINVAL, test_data.m_ioctx.aio_operate_batch(oids, cs,
+							 short_ops, 0));
+
+  ASSERT_EQ(0, test_data.m_ioctx.aio_operate_batch(oids, cs, ops, 0));
+  for (size_t i = 0; i < oids.size(); ++i) {
+    {
+      TestAlarm alarm;
+      ASSERT_EQ(0, cs[i]->wait_for_complete());
+    }
+    ASSERT_EQ(0, cs[i]->get_return_value());
+    cs[i]->release();
+    delete ops[i];
+
+    bufferlist bl2;
+    ASSERT_EQ((int)sizeof(buf), test_data.m_ioctx.read(oids[i], bl2,
+						       sizeof(buf), 0));
+    ASSERT_EQ(0, memcmp(buf, bl2.c_str(), sizeof(buf)));
+  }
+}
+
 //using ObjectWriteOperation/ObjectReadOperation with iohint
 TEST(LibRadosAio, RoundTripWriteFullPP2)
 {
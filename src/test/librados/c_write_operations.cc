@@ -43,6 +43,45 @@ TEST(LibRadosCWriteOps, assertExists) {
   ASSERT_EQ(0, destroy_one_pool(pool_name, &cluster));
 }
 
+TEST(LibRadosCWriteOps, OperateBatch) {
+  rados_t cluster;
+  rados_ioctx_t ioctx;
+  std::string pool_name = get_temp_pool_name();
+  ASSERT_EQ("", create_one_pool(pool_name, &cluster));
+  rados_ioctx_create(cluster, pool_name.c_str(), &ioctx);
+
+  const size_t n = 16;
+  rados_write_op_t ops[n];
+  rados_completion_t completions[n];
+  std::string names[n];
+  const char *oids[n];
+  for (size_t i = 0; i < n; ++i) {
+    names[i] = "batch" + std::to_string(i);
+    oids[i] = names[i].c_str();
+    ops[i] = rados_create_write_op();
+    ASSERT_TRUE(ops[i]);
+    rados_write_op_write_full(ops[i], oids[i], strlen(oids[i]));
+    ASSERT_EQ(0, rados_aio_create_completion(NULL, NULL, NULL,
+					     &completions[i]));
+  }
+  ASSERT_EQ(0, rados_aio_write_op_operate_batch(n, ops, ioctx, completions,
+						oids, 0));
+  for (size_t i = 0; i < n; ++i) {
+    rados_aio_wait_for_complete(completions[i]);
+    ASSERT_EQ(0, rados_aio_get_return_value(completions[i]));
+    rados_aio_release(completions[i]);
+    rados_release_write_op(ops[i]);
+
+    char buf[32];
+    ASSERT_EQ((int)strlen(oids[i]),
+	      rados_read(ioctx, oids[i], buf, sizeof(buf), 0));
+    ASSERT_EQ(0, memcmp(buf, oids[i], strlen(oids[i])));
+  }
+
+  rados_ioctx_destroy(ioctx);
+  ASSERT_EQ(0, destroy_one_pool(pool_name, &cluster));
+}
+
 TEST(LibRadosCWriteOps, WriteOpAssertVersion) {
   rados_t cluster;
   rados_ioctx_t ioctx;
@@ -18,6 +18,7 @@
 #include <stdint.h>
 #include <string>
 #include <unistd.h>
+#include <sys/resource.h>
 #include <iostream>
 
 using namespace std;
@@ -170,6 +171,15 @@ void usage(const string &name) {
   cerr << "       [ios]: how much messages sent for each client" << std::endl;
   cerr << "       [thinktime]: sleep time when do fast dispatching(match client logic)" << std::endl;
   cerr << "       [msg length]: message data bytes" << std::endl;
+  cerr << "       e.g. --ms_async_zero_copy_send=true to send with MSG_ZEROCOPY" << std::endl;
+}
+
+static double cpu_seconds()
+{
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+    (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1000000.0;
 }
 
 int main(int argc, char **argv)
@@ -207,10 +217,14 @@ int main(int argc, char **argv)
 
   client.ready(concurrent, numjobs, ios, len);
   Cycles::init();
+  double cpu_start = cpu_seconds();
   uint64_t start = Cycles::rdtsc();
   client.start();
   uint64_t stop = Cycles::rdtsc();
+  double cpu = cpu_seconds() - cpu_start;
   cerr << " Total op " << ios << " run time " << Cycles::to_microseconds(stop - start) << "us." << std::endl;
+  cerr << " cpu time " << cpu << "s, "
+       << (cpu * 1000000.0 / ((uint64_t)ios * numjobs)) << "us per op." << std::endl;
 
   return 0;
 }
@@ -22,6 +22,9 @@
 #include "common/Mutex.h"
 #include "common/Cond.h"
 #include "common/ceph_argparse.h"
+#include "common/Throttle.h"
+#include "common/perf_counters.h"
+#include "auth/Auth.h"
 #include "global/global_init.h"
 #include "msg/Dispatcher.h"
 #include "msg/msg_types.h"
@@ -797,6 +800,27 @@ ostream& operator<<(ostream& out, const Payload &pl)
   return out << "reply=" << pl.who << " i = " << pl.seq;
 }
 
+// a fixed cephx session key shared by both ends, so that the payload
+// encryption paths have a key without a monitor handing one out
+static CryptoKey fake_session_key()
+{
+  bufferptr secret(16);
+  for (unsigned i = 0; i < secret.length(); ++i)
+    secret[i] = i;
+  CryptoKey key;
+  key.set_secret(CEPH_CRYPTO_AES, secret, utime_t());
+  return key;
+}
+
+struct FakeAuthorizer : public AuthAuthorizer {
+  FakeAuthorizer() : AuthAuthorizer(CEPH_AUTH_CEPHX) {
+    session_key = fake_session_key();
+  }
+  bool verify_reply(bufferlist::iterator& reply) override {
+    return true;
+  }
+};
+
 class SyntheticDispatcher : public Dispatcher {
  public:
   Mutex lock;
@@ -810,6 +834,8 @@ class SyntheticDispatcher : public Dispatcher {
   atomic<uint64_t> index;
   SyntheticWorkload *workload;
 
+  bool use_session_key = false;
+
   SyntheticDispatcher(bool s, SyntheticWorkload *wl):
       Dispatcher(g_ceph_context), lock("SyntheticDispatcher::lock"), is_server(s), got_new(false),
       got_remote_reset(false), got_connect(false), index(0), workload(wl) {}
@@ -891,9 +917,18 @@ class SyntheticDispatcher : public Dispatcher {
     }
   }
 
+  bool ms_get_authorizer(int dest_type, AuthAuthorizer **a, bool force_new) override {
+    if (!use_session_key)
+      return false;
+    *a = new FakeAuthorizer;
+    return true;
+  }
+
   bool ms_verify_authorizer(Connection *con, int peer_type, int protocol,
                             bufferlist& authorizer, bufferlist& authorizer_reply,
                             bool& isvalid, CryptoKey& session_key) override {
+    if (use_session_key)
+      session_key = fake_session_key();
     isvalid = true;
     return true;
   }
@@ -1110,6 +1145,10 @@ class SyntheticWorkload {
     ASSERT_EQ(available_connections.erase(conn), 1U);
   }
 
+  void use_session_key() {
+    dispatcher.use_session_key = true;
+  }
+
   void print_internal_state(bool detail=false) {
     Mutex::Locker l(lock);
     lderr(g_ceph_context) << "available_connections: " << available_connections.size()
@@ -1220,6 +1259,160 @@ TEST_P(MessengerTest, SyntheticStressTest1) {
   test_msg.wait_for_done();
 }
 
+static uint64_t migrated_connections()
+{
+  uint64_t n = 0;
+  g_ceph_context->get_perfcounters_collection()->with_counters(
+    [&n](const PerfCountersCollection::CounterMap &by_path) {
+      for (auto& i : by_path) {
+        // summed over all AsyncMessenger::Worker-N loggers
+        if (i.first.find(".msgr_migrated_connections") != string::npos)
+          n += i.second->u64;
+      }
+    });
+  return n;
+}
+
+TEST_P(MessengerTest, SyntheticRebalanceTest) {
+  // keep moving connections between async workers under load
+  uint64_t migrated = migrated_connections();
+  g_ceph_context->_conf->set_val("ms_async_rebalance_interval", "0.01");
+  g_ceph_context->_conf->set_val("ms_async_rebalance_threshold", "0");
+  SyntheticWorkload test_msg(16, 32, GetParam(), 100,
+                             Messenger::Policy::lossless_peer_reuse(0),
+                             Messenger::Policy::lossless_peer_reuse(0));
+  for (int i = 0; i < 10; ++i) {
+    if (!(i % 10)) lderr(g_ceph_context) << "seeding connection " << i << dendl;
+    test_msg.generate_connection();
+  }
+  gen_type rng(time(NULL));
+  for (int i = 0; i < 5000; ++i) {
+    if (!(i % 10)) {
+      lderr(g_ceph_context) << "Op " << i << ": " << dendl;
+      test_msg.print_internal_state();
+    }
+    boost::uniform_int<> true_false(0, 99);
+    int val = true_false(rng);
+    if (val > 95) {
+      test_msg.generate_connection();
+    } else if (val > 90) {
+      test_msg.drop_connection();
+    } else if (val > 10) {
+      test_msg.send_message();
+    } else {
+      usleep(rand() % 1000 + 500);
+    }
+  }
+  test_msg.wait_for_done();
+  if (string(GetParam()) == "async+posix")
+    ASSERT_GT(migrated_connections(), migrated);
+  g_ceph_context->_conf->set_val("ms_async_rebalance_interval", "0");
+  g_ceph_context->_conf->set_val("ms_async_rebalance_threshold", "0.25");
+}
+
+TEST_P(MessengerTest, SyntheticCorkTest) {
+  // hold small writes back and coalesce them, across socket failures
+  g_ceph_context->_conf->set_val("ms_async_cork_us", "200");
+  g_ceph_context->_conf->set_val("ms_async_cork_max_bytes", "4096");
+  g_ceph_context->_conf->set_val("ms_inject_socket_failures", "100");
+  SyntheticWorkload test_msg(8, 32, GetParam(), 100,
+                             Messenger::Policy::stateful_server(0),
+                             Messenger::Policy::lossless_client(0));
+  for (int i = 0; i < 20; ++i) {
+    if (!(i % 10)) lderr(g_ceph_context) << "seeding connection " << i << dendl;
+    test_msg.generate_connection();
+  }
+  gen_type rng(time(NULL));
+  for (int i = 0; i < 2000; ++i) {
+    if (!(i % 10)) {
+      lderr(g_ceph_context) << "Op " << i << ": " << dendl;
+      test_msg.print_internal_state();
+    }
+    boost::uniform_int<> true_false(0, 99);
+    int val = true_false(rng);
+    if (val > 95) {
+      test_msg.generate_connection();
+    } else if (val > 90) {
+      test_msg.drop_connection();
+    } else if (val > 5) {
+      test_msg.send_message();
+    } else {
+      usleep(rand() % 1000 + 500);
+    }
+  }
+  test_msg.wait_for_done();
+  g_ceph_context->_conf->set_val("ms_async_cork_us", "0");
+  g_ceph_context->_conf->set_val("ms_async_cork_max_bytes", "65536");
+  g_ceph_context->_conf->set_val("ms_inject_socket_failures", "0");
+}
+
+// run a workload with byte throttled policies, as the osd does with
+// osd_client_message_size_cap; the throttle must come back to zero
+// however the payloads were encoded on the wire
+static void payload_codec_workload(const string& type, bool session_key)
+{
+  Throttle srv_throttle(g_ceph_context, "srv_bytes", 16 << 20);
+  Throttle cli_throttle(g_ceph_context, "cli_bytes", 16 << 20);
+  Messenger::Policy srv_policy = Messenger::Policy::stateful_server(0);
+  Messenger::Policy cli_policy = Messenger::Policy::lossless_client(0);
+  srv_policy.throttler_bytes = &srv_throttle;
+  cli_policy.throttler_bytes = &cli_throttle;
+  {
+    SyntheticWorkload test_msg(8, 32, type, 100, srv_policy, cli_policy);
+    if (session_key)
+      test_msg.use_session_key();
+    for (int i = 0; i < 20; ++i) {
+      if (!(i % 10)) lderr(g_ceph_context) << "seeding connection " << i << dendl;
+      test_msg.generate_connection();
+    }
+    gen_type rng(time(NULL));
+    for (int i = 0; i < 1000; ++i) {
+      if (!(i % 10)) {
+        lderr(g_ceph_context) << "Op " << i << ": " << dendl;
+        test_msg.print_internal_state();
+      }
+      boost::uniform_int<> true_false(0, 99);
+      int val = true_false(rng);
+      if (val > 95) {
+        test_msg.generate_connection();
+      } else if (val > 90) {
+        test_msg.drop_connection();
+      } else if (val > 5) {
+        test_msg.send_message();
+      } else {
+        usleep(rand() % 1000 + 500);
+      }
+    }
+    test_msg.wait_for_done();
+  }
+  ASSERT_EQ(0, srv_throttle.get_current());
+  ASSERT_EQ(0, cli_throttle.get_current());
+}
+
+TEST_P(MessengerTest, SyntheticCompressTest) {
+  // compressed data must survive resends after socket failures
+  g_ceph_context->_conf->set_val("ms_async_compress_algorithm", "zlib");
+  g_ceph_context->_conf->set_val("ms_async_compress_min_size", "1024");
+  g_ceph_context->_conf->set_val("ms_inject_socket_failures", "100");
+  payload_codec_workload(GetParam(), false);
+  g_ceph_context->_conf->set_val("ms_async_compress_algorithm", "none");
+  g_ceph_context->_conf->set_val("ms_async_compress_min_size", "8192");
+  g_ceph_context->_conf->set_val("ms_inject_socket_failures", "0");
+}
+
+TEST_P(MessengerTest, SyntheticEncryptTest) {
+  // encrypted payloads, on their own and on top of compression
+  g_ceph_context->_conf->set_val("ms_async_encrypt", "true");
+  g_ceph_context->_conf->set_val("ms_inject_socket_failures", "100");
+  payload_codec_workload(GetParam(), true);
+  g_ceph_context->_conf->set_val("ms_async_compress_algorithm", "zlib");
+  g_ceph_context->_conf->set_val("ms_async_compress_min_size", "1024");
+  payload_codec_workload(GetParam(), true);
+  g_ceph_context->_conf->set_val("ms_async_compress_algorithm", "none");
+  g_ceph_context->_conf->set_val("ms_async_compress_min_size", "8192");
+  g_ceph_context->_conf->set_val("ms_async_encrypt", "false");
+  g_ceph_context->_conf->set_val("ms_inject_socket_failures", "0");
+}
 
 TEST_P(MessengerTest, SyntheticInjectTest) {
   uint64_t dispatch_throttle_bytes = g_ceph_context->_conf->ms_dispatch_throttle_bytes;
@@ -1494,13 +1687,20 @@ TEST_P(MessengerTest, MarkdownTest) {
   delete server_msgr2;
 }
 
+// CEPH_TEST_MSGR_TYPE tests just that messenger type instead, e.g.
+// async+rdma, which needs a device; see src/test/run-msgr-rdma-tests.sh
+static vector<const char*> messenger_types()
+{
+  const char *type = getenv("CEPH_TEST_MSGR_TYPE");
+  if (type)
+    return {type};
+  return {"async+posix", "simple"};
+}
+
 INSTANTIATE_TEST_CASE_P(
   Messenger,
   MessengerTest,
-  ::testing::Values(
-    "async+posix",
-    "simple"
-  )
+  ::testing::ValuesIn(messenger_types())
 );
 
 #else
@@ -1106,6 +1106,70 @@ TEST_P(StoreTest, CompressionTest) {
   g_ceph_context->_conf->apply_changes(NULL);
 }
 
+TEST_P(StoreTest, ReadDigest) {
+  ObjectStore::Sequencer osr("test");
+  coll_t cid;
+  ghobject_t hoid(hobject_t(sobject_t("Object 1", CEPH_NOSNAP)));
+  int r;
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // some data, a hole, then a partial block
+  bufferlist a, b;
+  for (unsigned i = 0; i < 300000; ++i)
+    a.append((char)rand());
+  for (unsigned i = 0; i < 5000; ++i)
+    b.append((char)rand());
+  uint64_t size = (1 << 20) + b.length();
+  {
+    ObjectStore::Transaction t;
+    t.write(cid, hoid, 0, a.length(), a);
+    t.write(cid, hoid, 1 << 20, b.length(), b);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // make sure we read from disk rather than cache
+  r = store->umount();
+  ASSERT_EQ(0, r);
+  r = store->mount();
+  ASSERT_EQ(0, r);
+
+  ObjectStore::CollectionHandle ch = store->open_collection(cid);
+  vector<pair<uint64_t,uint64_t>> extents = {
+    {0, size}, {100, 300000}, {4096, 4096}, {(1 << 20) - 10, 100},
+    {(1 << 20) + 4000, 10000}, {0, 4 << 20},
+  };
+  for (auto& e : extents) {
+    bufferlist bl;
+    r = store->read(cid, hoid, e.first, e.second, bl);
+    ASSERT_LE(0, r);
+    uint32_t crc = -1;
+    int r2 = store->read_digest(ch, hoid, e.first, e.second, &crc);
+    ASSERT_EQ(r, r2);
+    ASSERT_EQ(bl.crc32c(-1), crc);
+    crc = 1234;
+    r2 = store->read_digest(ch, hoid, e.first, e.second, &crc);
+    ASSERT_EQ(r, r2);
+    ASSERT_EQ(bl.crc32c(1234), crc);
+  }
+  {
+    uint32_t crc = 1234;
+    r = store->read_digest(ch, hoid, size + 10, 10, &crc);
+    ASSERT_EQ(0, r);
+    ASSERT_EQ(1234u, crc);
+  }
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove_collection(cid);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 TEST_P(StoreTest, SimpleObjectTest) {
   ObjectStore::Sequencer osr("test");
   int r;
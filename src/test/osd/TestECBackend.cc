@@ -58,3 +58,23 @@ TEST(ECUtil, stripe_info_t)
             make_pair((uint64_t)0, 2*swidth));
 }
 
+
+TEST(ECBackend, shard_latency_percentile)
+{
+  ECBackend::shard_latency_t l;
+  ASSERT_EQ(0, l.get_percentile(95));
+
+  for (unsigned i = 1; i <= 10; ++i)
+    l.add(i);
+  ASSERT_EQ(10, l.get_percentile(95));
+  ASSERT_EQ(6, l.get_percentile(50));
+  ASSERT_EQ(1, l.get_percentile(0));
+
+  // older samples are replaced once the window is full
+  for (unsigned i = 0; i < ECBackend::shard_latency_t::max_samples; ++i)
+    l.add(100);
+  ASSERT_EQ(ECBackend::shard_latency_t::max_samples, l.samples.size());
+  ASSERT_EQ(100, l.get_percentile(0));
+  l.add(1);
+  ASSERT_EQ(1, l.get_percentile(0));
+}
@@ -435,6 +435,180 @@ TEST_F(OSDMapTest, PrimaryAffinity) {
   }
 }
 
+TEST_F(OSDMapTest, IncrementalMapping) {
+  set_up_map();
+  mapping.update(osdmap);
+  ASSERT_EQ(0u, mapping.check(osdmap, &cerr));
+
+  auto apply = [&](OSDMap::Incremental& inc) {
+    osdmap.apply_incremental(inc);
+    mapping.note_incremental(osdmap, inc);
+    mapping.update_incremental(osdmap);
+    ASSERT_EQ(osdmap.get_epoch(), mapping.get_epoch());
+    ASSERT_EQ(0u, mapping.check(osdmap, &cerr));
+  };
+
+  // mark an osd down, then out, then back up and in
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[1] = CEPH_OSD_UP;
+    apply(inc);
+  }
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_weight[1] = CEPH_OSD_OUT;
+    apply(inc);
+  }
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    entity_addr_t addr;
+    inc.new_state[1] = CEPH_OSD_UP;
+    inc.new_up_client[1] = addr;
+    inc.new_weight[1] = CEPH_OSD_IN;
+    apply(inc);
+  }
+
+  // pg_temp, primary_temp and upmap on a single pg
+  pg_t pgid(0, 0);
+  vector<int> up, acting;
+  osdmap.pg_to_up_acting_osds(pgid, up, acting);
+  ASSERT_FALSE(acting.empty());
+  int spare = -1;
+  for (int o = 0; o < (int)get_num_osds(); ++o) {
+    if (std::find(up.begin(), up.end(), o) == up.end()) {
+      spare = o;
+      break;
+    }
+  }
+  ASSERT_NE(-1, spare);
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_pg_temp[pgid] = mempool::osdmap::vector<int>(
+      acting.rbegin(), acting.rend());
+    inc.new_primary_temp[pgid] = acting.back();
+    apply(inc);
+  }
+  {
+    // an osd named only by pg_temp goes down
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[acting.back()] = CEPH_OSD_UP;
+    apply(inc);
+  }
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_pg_temp[pgid] = mempool::osdmap::vector<int>();
+    inc.new_primary_temp[pgid] = -1;
+    inc.new_state[acting.back()] = CEPH_OSD_UP;
+    inc.new_pg_upmap_items[pgid] =
+      mempool::osdmap::vector<pair<int32_t,int32_t>>(
+	{ make_pair(up[0], spare) });
+    apply(inc);
+  }
+  {
+    // the upmap target is marked out
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_weight[spare] = CEPH_OSD_OUT;
+    apply(inc);
+  }
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.old_pg_upmap_items.insert(pgid);
+    inc.new_weight[spare] = CEPH_OSD_IN;
+    apply(inc);
+  }
+
+  // primary affinity
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_primary_affinity[2] = 0;
+    apply(inc);
+  }
+
+  // pgp_num change moves every pg in the pool
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    const pg_pool_t *pi = osdmap.get_pg_pool(0);
+    pg_pool_t *p = inc.get_new_pool(0, pi);
+    p->set_pgp_num(pi->get_pgp_num() / 2);
+    apply(inc);
+  }
+
+  // a gap in the incrementals forces a full update
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[3] = CEPH_OSD_UP;
+    osdmap.apply_incremental(inc);
+  }
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[3] = CEPH_OSD_UP;
+    apply(inc);
+  }
+}
+
+TEST_F(OSDMapTest, MappingCache) {
+  set_up_map();
+  OSDMapMappingCache cache(4096);
+
+  auto verify = [&]() {
+    for (auto& p : osdmap.get_pools()) {
+      for (unsigned ps = 0; ps < p.second.get_pg_num(); ++ps) {
+	pg_t pgid(ps, p.first);
+	vector<int> up, acting, up2, acting2;
+	int up_primary, acting_primary, up_primary2, acting_primary2;
+	osdmap.pg_to_up_acting_osds(pgid, &up, &up_primary,
+				    &acting, &acting_primary);
+	cache.get(osdmap, pgid, &up2, &up_primary2, &acting2, &acting_primary2);
+	ASSERT_EQ(up, up2);
+	ASSERT_EQ(up_primary, up_primary2);
+	ASSERT_EQ(acting, acting2);
+	ASSERT_EQ(acting_primary, acting_primary2);
+      }
+    }
+  };
+  verify();
+  size_t cached = cache.size();
+  ASSERT_GT(cached, 0u);
+
+  // an unrelated change keeps everything
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_flags = osdmap.get_flags() | CEPH_OSDMAP_NOSCRUB;
+    osdmap.apply_incremental(inc);
+    cache.note_incremental(osdmap, inc);
+    ASSERT_EQ(cached, cache.size());
+    verify();
+  }
+
+  // marking an osd down only drops the pgs it was in
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[0] = CEPH_OSD_UP;
+    osdmap.apply_incremental(inc);
+    cache.note_incremental(osdmap, inc);
+    ASSERT_LT(cache.size(), cached);
+    ASSERT_GT(cache.size(), 0u);
+    verify();
+  }
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_weight[0] = CEPH_OSD_OUT;
+    inc.new_pg_temp[pg_t(1, 1)] = mempool::osdmap::vector<int>({2, 3, 4});
+    osdmap.apply_incremental(inc);
+    cache.note_incremental(osdmap, inc);
+    verify();
+  }
+
+  // a missed incremental flushes on the next lookup
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[0] = CEPH_OSD_UP;
+    inc.new_weight[0] = CEPH_OSD_IN;
+    osdmap.apply_incremental(inc);
+    verify();
+  }
+}
+
 TEST(PGTempMap, basic)
 {
   PGTempMap m;
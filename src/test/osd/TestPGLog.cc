@@ -2066,6 +2066,120 @@ TEST_F(PGLogTest, ErrorNotIndexedByObject) {
   EXPECT_EQ(del.reqid, entry->reqid);
 }
 
+TEST_F(PGLogTest, trim_tracks_dups) {
+  clear();
+  g_ceph_context->_conf->set_val("osd_pg_log_dups_tracked", "2");
+  g_ceph_context->_conf->apply_changes(NULL);
+
+  hobject_t oid(object_t("objname"), "key", 123, 456, 0, "");
+  vector<pg_log_entry_t> entries;
+  for (unsigned i = 1; i <= 5; ++i) {
+    entries.push_back(
+      pg_log_entry_t(pg_log_entry_t::MODIFY, oid, eversion_t(1, i),
+		     eversion_t(1, i - 1), i,
+		     osd_reqid_t(entity_name_t::CLIENT(777), 8, i),
+		     utime_t(1, i), 0));
+    add(entries.back());
+  }
+  log.skip_can_rollback_to_to_head();
+
+  pg_info_t info;
+  info.last_complete = eversion_t(1, 5);
+  undirty();
+  trim(eversion_t(1, 3), info);
+  EXPECT_EQ(2u, log.log.size());
+
+  // only the two most recently trimmed reqids are kept as dups
+  EXPECT_EQ(2u, log.dups.size());
+  EXPECT_EQ(eversion_t(1, 2), log.dups.front().version);
+  EXPECT_EQ(eversion_t(1, 3), log.dups.back().version);
+  EXPECT_EQ(eversion_t(1, 1), write_from_dups);
+  EXPECT_EQ(1u, trimmed_dups.size());
+  EXPECT_TRUE(trimmed_dups.count(pg_log_dup_t(entries[0]).get_key_name()));
+
+  for (auto &entry : entries) {
+    eversion_t replay_version;
+    version_t user_version;
+    int return_code = 0;
+    bool got = log.get_request(
+      entry.reqid, &replay_version, &user_version, &return_code);
+    if (entry.version == eversion_t(1, 1)) {
+      EXPECT_FALSE(got);
+      continue;
+    }
+    EXPECT_TRUE(got);
+    EXPECT_EQ(entry.version, replay_version);
+    EXPECT_EQ(entry.user_version, user_version);
+  }
+
+  // dups are written under their own keys, away from the log entries
+  ObjectStore::Transaction t;
+  map<string,bufferlist> km;
+  write_log_and_missing(t, &km, coll_t(), ghobject_t(), false);
+  EXPECT_TRUE(km.count(log.dups.front().get_key_name()));
+  EXPECT_TRUE(km.count(log.dups.back().get_key_name()));
+  EXPECT_FALSE(is_dirty());
+
+  g_ceph_context->_conf->set_val("osd_pg_log_dups_tracked", "3000");
+  g_ceph_context->_conf->apply_changes(NULL);
+}
+
+TEST_F(PGLogTest, rewrite_clears_stale_dups) {
+  clear();
+  auto count_rmkeyrange = [](ObjectStore::Transaction &t) {
+    unsigned n = 0;
+    for (auto i = t.begin(); i.have_op(); ) {
+      if (i.decode_op()->op == ObjectStore::Transaction::OP_OMAP_RMKEYRANGE)
+	++n;
+    }
+    return n;
+  };
+
+  log.dups.push_back(
+    pg_log_dup_t(eversion_t(1, 1), 1,
+		 osd_reqid_t(entity_name_t::CLIENT(777), 8, 1), 0));
+  log.dups.push_back(
+    pg_log_dup_t(eversion_t(1, 2), 2,
+		 osd_reqid_t(entity_name_t::CLIENT(777), 8, 2), -ENOENT));
+  log.index();
+
+  // dups travel with the log
+  {
+    bufferlist bl;
+    ::encode(static_cast<const pg_log_t&>(log), bl);
+    pg_log_t decoded;
+    bufferlist::iterator p = bl.begin();
+    decoded.decode(p);
+    ASSERT_EQ(2u, decoded.dups.size());
+    EXPECT_EQ(eversion_t(1, 2), decoded.dups.back().version);
+    EXPECT_EQ(-ENOENT, decoded.dups.back().return_code);
+  }
+
+  // a rewrite drops whatever dup keys are on disk and writes ours
+  undirty();
+  mark_log_for_rewrite();
+  {
+    ObjectStore::Transaction t;
+    map<string,bufferlist> km;
+    write_log_and_missing(t, &km, coll_t(), ghobject_t(), false);
+    EXPECT_EQ(2u, count_rmkeyrange(t));  // log entries, then dups
+    EXPECT_TRUE(km.count(log.dups.front().get_key_name()));
+    EXPECT_TRUE(km.count(log.dups.back().get_key_name()));
+  }
+
+  // and so does clearing the log
+  clear();
+  EXPECT_TRUE(is_dirty());
+  {
+    ObjectStore::Transaction t;
+    map<string,bufferlist> km;
+    write_log_and_missing(t, &km, coll_t(), ghobject_t(), false);
+    EXPECT_EQ(1u, count_rmkeyrange(t));
+    EXPECT_TRUE(km.empty());
+  }
+  EXPECT_FALSE(is_dirty());
+}
+
 // Local Variables:
 // compile-command: "cd ../.. ; make unittest_pglog ; ./unittest_pglog --log-to-stderr=true  --debug-osd=20 # --gtest_filter=*.* "
 // End:
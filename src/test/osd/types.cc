@@ -1461,6 +1461,90 @@ TEST(ghobject_t, parse) {
   }
 }
 
+TEST(pg_log_entry_t, encode) {
+  hobject_t oid(object_t("foo"), "", 4, 0x1234, 1, "ns");
+  pg_log_entry_t e(pg_log_entry_t::MODIFY, oid, eversion_t(3, 10),
+		   eversion_t(2, 9), 8,
+		   osd_reqid_t(entity_name_t::CLIENT(777), 8, 999),
+		   utime_t(8, 9), 0);
+  e.extra_reqids.push_back(
+    make_pair(osd_reqid_t(entity_name_t::CLIENT(778), 9, 1000), 7));
+  ::encode(vector<snapid_t>{1, 2, 3}, e.snaps);
+  e.mod_desc.append(4096);
+
+  for (int op : { pg_log_entry_t::MODIFY, pg_log_entry_t::LOST_REVERT,
+	pg_log_entry_t::ERROR }) {
+    e.op = op;
+    e.reverting_to = eversion_t(1, 5);
+    e.return_code = -ENOENT;
+
+    size_t bound = 0;
+    e.bound_encode(bound);
+    bufferlist bl;
+    ::encode(e, bl);
+    ASSERT_GE(bound, bl.length());
+
+    pg_log_entry_t d;
+    bufferlist::iterator p = bl.begin();
+    ::decode(d, p);
+    ASSERT_TRUE(p.end());
+    ASSERT_EQ(e.op, d.op);
+    ASSERT_EQ(e.soid, d.soid);
+    ASSERT_EQ(e.version, d.version);
+    ASSERT_EQ(e.prior_version, d.prior_version);
+    ASSERT_EQ(e.reqid, d.reqid);
+    ASSERT_EQ(e.mtime, d.mtime);
+    ASSERT_EQ(e.user_version, d.user_version);
+    ASSERT_TRUE(e.snaps.contents_equal(d.snaps));
+    ASSERT_EQ(e.extra_reqids, d.extra_reqids);
+    if (op == pg_log_entry_t::LOST_REVERT)
+      ASSERT_EQ(e.reverting_to, d.reverting_to);
+    if (op == pg_log_entry_t::ERROR)
+      ASSERT_EQ(e.return_code, d.return_code);
+
+    bufferlist bl2;
+    ::encode(d, bl2);
+    ASSERT_TRUE(bl.contents_equal(bl2));
+  }
+}
+
+TEST(object_info_t, encode) {
+  object_info_t oi(hobject_t(object_t("foo"), "key", 4, 0x1234, 1, "ns"));
+  oi.version = eversion_t(3, 10);
+  oi.size = 4096;
+  oi.legacy_snaps.push_back(4);
+  oi.set_data_digest(0xdeadbeef);
+  oi.watchers[make_pair(1ull, entity_name_t::CLIENT(2))] =
+    watch_info_t(1, 30, entity_addr_t());
+  oi.set_flag(object_info_t::FLAG_MANIFEST);
+  oi.manifest = object_manifest_t(
+    object_manifest_t::TYPE_REDIRECT,
+    hobject_t(object_t("bar"), "", CEPH_NOSNAP, 0x42, 1, ""));
+
+  for (int i = 0; i < 2; ++i) {
+    bufferlist bl;
+    ::encode(oi, bl, CEPH_FEATURES_ALL);
+    object_info_t d(bl);
+    ASSERT_EQ(oi.soid, d.soid);
+    ASSERT_EQ(oi.version, d.version);
+    ASSERT_EQ(oi.size, d.size);
+    ASSERT_EQ(oi.legacy_snaps, d.legacy_snaps);
+    ASSERT_EQ(oi.data_digest, d.data_digest);
+    ASSERT_EQ(oi.watchers.size(), d.watchers.size());
+    ASSERT_EQ(oi.has_manifest(), d.has_manifest());
+    ASSERT_EQ(oi.manifest.redirect_target, d.manifest.redirect_target);
+
+    bufferlist bl2;
+    ::encode(d, bl2, CEPH_FEATURES_ALL);
+    ASSERT_TRUE(bl.contents_equal(bl2));
+
+    // and again without watchers or manifest
+    oi.watchers.clear();
+    oi.clear_flag(object_info_t::FLAG_MANIFEST);
+    oi.manifest = object_manifest_t();
+  }
+}
+
 TEST(pool_opts_t, invalid_opt) {
   EXPECT_FALSE(pool_opts_t::is_opt_name("INVALID_OPT"));
   PrCtl unset_dumpable;
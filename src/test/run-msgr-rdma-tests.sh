@@ -0,0 +1,34 @@
+#!/bin/bash -ex
+#
+# Run the messenger tests over async+rdma on a soft-RoCE (rxe) device,
+# so no RDMA hardware is needed.  Requires a build with HAVE_RDMA, the
+# rdma_rxe kernel module and root, to create the device and to lift
+# the memlock limit the registered buffers count against.
+#
+# usage: run-msgr-rdma-tests.sh [netdev]
+#
+# this should be run from the src directory in the ceph.git
+
+source $(dirname $0)/detect-build-env-vars.sh
+PATH="$CEPH_BIN:$PATH"
+
+netdev=${1:-$(ip -o -4 route show default | awk '{print $5; exit}')}
+rxe=rxe_$netdev
+
+if ! rdma link show $rxe/1 >/dev/null 2>&1; then
+    modprobe rdma_rxe
+    rdma link add $rxe type rxe netdev $netdev
+fi
+
+# rxe only has the IPv4 mapped GID of the netdev's address, which is
+# rarely at index 0, so tell the stack which one to use
+addr=$(ip -o -4 addr show dev $netdev | awk '{split($4, a, "/"); print a[1]; exit}')
+gid=$(printf '0000:0000:0000:0000:0000:ffff:%02x%02x:%02x%02x' ${addr//./ })
+
+ulimit -l unlimited
+
+CEPH_TEST_MSGR_TYPE=async+rdma ceph_test_msgr \
+    --ms_async_rdma_device_name $rxe \
+    --ms_async_rdma_local_gid $gid
+
+echo OK
@@ -15,6 +15,7 @@
  */
 
 #include <stdio.h>
+#include <thread>
 
 #include "global/global_init.h"
 #include "common/ceph_argparse.h"
@@ -204,6 +205,48 @@ TEST(mempool, test_factory)
    check_usage(mempool::osdmap::id);
 }
 
+struct cached_obj {
+  MEMPOOL_CLASS_HELPERS();
+  int a = 0;
+};
+MEMPOOL_DEFINE_CACHED_OBJECT_FACTORY(cached_obj, cached_obj, unittest_2);
+
+TEST(mempool, cached_factory)
+{
+  size_t before = mempool::unittest_2::allocated_items();
+  cached_obj *o = new cached_obj;
+  void *p = o;
+  delete o;
+  // still accounted while cached, and handed out again
+  EXPECT_EQ(before + 1, mempool::unittest_2::allocated_items());
+  o = new cached_obj;
+  EXPECT_EQ(p, (void*)o);
+  EXPECT_EQ(before + 1, mempool::unittest_2::allocated_items());
+  delete o;
+
+  // freed on another thread, reused here
+  std::vector<cached_obj*> objs;
+  for (int i = 0; i < 1000; ++i) {
+    objs.push_back(new cached_obj);
+  }
+  size_t peak = mempool::unittest_2::allocated_items();
+  std::thread t([&objs] {
+      for (auto o : objs) {
+	delete o;
+      }
+    });
+  t.join();
+  objs.clear();
+  for (int i = 0; i < 1000; ++i) {
+    objs.push_back(new cached_obj);
+  }
+  EXPECT_EQ(peak, mempool::unittest_2::allocated_items());
+  for (auto o : objs) {
+    delete o;
+  }
+  check_usage(mempool::unittest_2::id);
+}
+
 TEST(mempool, vector)
 {
   {
@@ -364,6 +364,33 @@ public:
       cur = next.first;
     }
   }
+  void get_next_batch() {
+    string cur;
+    unsigned max = 1 + random_num();
+    while (true) {
+      vector<pair<string, bufferlist> > got;
+      int r = cache->get_next_batch(cur, max, &got);
+
+      map<string, bufferlist>::iterator i = truth.upper_bound(cur);
+      int r_truth = (i == truth.end()) ? -ENOENT : 0;
+      ASSERT_EQ(r, r_truth);
+      if (r == -ENOENT)
+	break;
+
+      ASSERT_LE(got.size(), max);
+      for (auto &p : got) {
+	ASSERT_TRUE(i != truth.end());
+	ASSERT_EQ(p.first, i->first);
+	assert_bl_eq(p.second, i->second);
+	++i;
+      }
+      if (got.size() < max) {
+	ASSERT_TRUE(i == truth.end());
+	break;
+      }
+      cur = got.back().first;
+    }
+  }
   void SetUp() override {
     driver.reset(new PausyAsyncMap());
     cache.reset(new MapCacher::MapCacher<string, bufferlist>(driver.get()));
@@ -418,7 +445,7 @@ TEST_F(MapCacherTest, Random)
     if (!(i % 50)) {
       std::cout << "On iteration " << i << std::endl;
     }
-    switch (rand() % 4) {
+    switch (rand() % 5) {
     case 0:
       get();
       break;
@@ -431,6 +458,9 @@ TEST_F(MapCacherTest, Random)
     case 3:
       remove();
       break;
+    case 4:
+      get_next_batch();
+      break;
     }
   }
 }